@@ -1,20 +1,59 @@
 Import("env")
 
-try:
-    import gzip
-except:
-    env.Execute("$PYTHONEXE -m pip install gzip")
-    import gzip
+import gzip
+import hashlib
+import mimetypes
+import os
+
+HTML_DIR = "html"
+OUTPUT = "src/WebAssets.hpp"
+# Served for "/" as well as under its own name
+ROOT_DOCUMENT = "form.html"
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".ico": "image/x-icon",
+    ".png": "image/png",
+}
+
+def get_mime_type(path):
+    extension = os.path.splitext(path)[1].lower()
+    if extension in MIME_TYPES:
+        return MIME_TYPES[extension]
+    return mimetypes.guess_type(path)[0] or "application/octet-stream"
 
 def copy_html():
-    compressed_bytes = gzip.compress(open("html/form.html", "r").read().encode('utf-8'))
+    assets = []
+    for directory, _, files in os.walk(HTML_DIR):
+        for name in sorted(files):
+            path = os.path.join(directory, name)
+            data = open(path, "rb").read()
+            # mtime=0 keeps the output the same from build to build
+            compressed = gzip.compress(data, mtime=0)
+            is_gzipped = len(compressed) < len(data)
+            uri = "/" + os.path.relpath(path, HTML_DIR).replace(os.sep, "/")
+            etag = hashlib.sha256(data).hexdigest()[:16]
+            assets.append((uri, get_mime_type(path), etag, is_gzipped, compressed if is_gzipped else data))
+    assets.sort()
 
-    with open("src/WebForm.hpp", "w") as file:
-        file.write(f"#pragma once\n\nconst char gz_compressed_form[{len(compressed_bytes)}] = {{")
-        file.write(', '.join('0x{:02x}'.format(b) for b in compressed_bytes))
-        file.write("};")
+    with open(OUTPUT, "w") as file:
+        file.write("#pragma once\n\n// Generated by copy_html.py from html/, do not edit\n\n#include \"WebAsset.hpp\"\n\n")
+        for index, (_, _, _, _, body) in enumerate(assets):
+            file.write(f"static const uint8_t ASSET_BODY_{index}[{len(body)}] = {{")
+            file.write(', '.join('0x{:02x}'.format(b) for b in body))
+            file.write("};\n")
+        file.write("\nstatic const WebAsset WEB_ASSETS[] = {\n")
+        for index, (uri, mime_type, etag, is_gzipped, _) in enumerate(assets):
+            entry = f"\"{mime_type}\", \"\\\"{etag}\\\"\", {'true' if is_gzipped else 'false'}, ASSET_BODY_{index}, sizeof(ASSET_BODY_{index})}},\n"
+            file.write(f"    {{\"{uri}\", " + entry)
+            if uri == "/" + ROOT_DOCUMENT:
+                file.write("    {\"/\", " + entry)
+        file.write("};\n")
 
 
 copy_html()
 #env.AddPreAction("buildprog", copy_html)
-
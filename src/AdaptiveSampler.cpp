@@ -0,0 +1,194 @@
+#include "AdaptiveSampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "esp_log.h"
+
+static const char* TAG = "AdaptiveSampler";
+
+// A 9-bit conversion takes 93.75ms, leave room for reading back the scratchpads
+static const AdaptiveSampler::Plan NEAR_PLAN = {DS18B20::Resolution_T::RES_9_BIT, std::chrono::milliseconds(125)};
+static const AdaptiveSampler::Plan MID_PLAN = {DS18B20::Resolution_T::RES_11_BIT, std::chrono::milliseconds(1000)};
+static const AdaptiveSampler::Plan FAR_PLAN = {DS18B20::Resolution_T::RES_12_BIT, std::chrono::milliseconds(5000)};
+// Stays under the history's 10s hold so the per-second tier has no gaps
+static const AdaptiveSampler::Plan BACKOFF_PLAN = {DS18B20::Resolution_T::RES_12_BIT, std::chrono::milliseconds(8000)};
+static const AdaptiveSampler::Plan NO_READING_PLAN = {DS18B20::Resolution_T::RES_12_BIT, std::chrono::milliseconds(1000)};
+
+// Distances in 1/16 C
+static constexpr int32_t NEAR_DISTANCE = 1 * 16;
+static constexpr float NEAR_TIME_TO_CROSS_S = 10.f;
+static constexpr int32_t MID_DISTANCE = 5 * 16;
+static constexpr float MID_TIME_TO_CROSS_S = 60.f;
+static constexpr float BACKOFF_TIME_TO_CROSS_S = 1800.f;
+// Predictions are taken this many standard errors early
+static constexpr float CROSSING_ERROR_MARGIN = 2.f;
+static constexpr uint32_t SAMPLES_PER_JITTER_REPORT = 100;
+// How stale the readings of non-alarming sensors (and the pacing itself) may get
+static constexpr int64_t FULL_READ_PERIOD_US = 1000000;
+
+AdaptiveSampler::AdaptiveSampler(const std::shared_ptr<DS18B20BusGroup>& sensors,
+                                 const std::shared_ptr<Alarm>& alarm,
+                                 const std::shared_ptr<DataBinding<TemperatureTrend::Fit>>& trend_binding,
+                                 ConversionScheduler& scheduler,
+                                 SampleCallback on_sample) : _sensors(sensors),
+                                                                 _alarm(alarm),
+                                                                 _trend_binding(trend_binding),
+                                                                 _scheduler(scheduler),
+                                                                 _on_sample(std::move(on_sample)),
+                                                                 _plan(NO_READING_PLAN),
+                                                                 _next_deadline_us(0),
+                                                                 _last_temp(Temperature::Invalid()),
+                                                                 _last_full_read_us(0),
+                                                                 _sensor_thresholds_version(0),
+                                                                 _has_sensor_thresholds(false)
+{
+
+}
+
+void AdaptiveSampler::Start()
+{
+    _next_deadline_us = esp_timer_get_time();
+    _scheduler.ScheduleAt(_next_deadline_us, [this] {
+        Sample();
+    });
+}
+
+AdaptiveSampler::Plan AdaptiveSampler::SelectPlan(Temperature temperature, const TemperatureTrend::Fit& trend, std::pair<Temperature, Temperature> low_high_thresholds, int64_t now_us)
+{
+    if (!temperature.IsValid()) {
+        return NO_READING_PLAN;
+    }
+
+    const int32_t to_low = temperature.GetSixteenths() - low_high_thresholds.first.GetSixteenths();
+    const int32_t to_high = low_high_thresholds.second.GetSixteenths() - temperature.GetSixteenths();
+    const int32_t distance = std::max<int32_t>(0, std::min(to_low, to_high));
+
+    // Earliest plausible crossing of either threshold
+    float time_to_cross = std::numeric_limits<float>::infinity();
+    for (const auto threshold : {low_high_thresholds.first, low_high_thresholds.second}) {
+        const auto crossing = TemperatureTrend::GetCrossing(trend, threshold, now_us);
+        if (crossing.is_approaching) {
+            time_to_cross = std::min(time_to_cross, std::max(crossing.eta_s - CROSSING_ERROR_MARGIN * crossing.error_s, 0.f));
+        }
+    }
+
+    if (distance <= NEAR_DISTANCE || time_to_cross <= NEAR_TIME_TO_CROSS_S) {
+        return NEAR_PLAN;
+    }
+    if (distance <= MID_DISTANCE || time_to_cross <= MID_TIME_TO_CROSS_S) {
+        return MID_PLAN;
+    }
+    // Only back off once there is a trend to trust
+    if (trend.IsValid() && time_to_cross > BACKOFF_TIME_TO_CROSS_S) {
+        return BACKOFF_PLAN;
+    }
+    return FAR_PLAN;
+}
+
+void AdaptiveSampler::Sample()
+{
+    const int64_t sample_time_us = esp_timer_get_time();
+    RecordJitter(sample_time_us - _next_deadline_us);
+
+    UpdateSensorThresholds();
+    _sensors->SetResolution(_plan.resolution);
+
+    const bool is_full_read = !_last_temp.IsValid() || sample_time_us - _last_full_read_us >= FULL_READ_PERIOD_US;
+    auto on_done = [this, is_full_read](DS18B20BusGroup::Sample sample) {
+        HandleSample(sample, is_full_read);
+        ScheduleNext();
+    };
+
+    if (is_full_read) {
+        _sensors->ReadAllAsync(_scheduler, std::move(on_done));
+    } else {
+        _sensors->ReadAlarmingAsync(_scheduler, std::move(on_done));
+    }
+}
+
+void AdaptiveSampler::UpdateSensorThresholds()
+{
+    // Moves with the thresholds and with the user rules
+    const uint32_t version = _alarm->GetVersion();
+    if (_has_sensor_thresholds && version == _sensor_thresholds_version) {
+        return;
+    }
+
+    const auto thresholds = _alarm->GetValue();
+    ESP_LOGI(TAG, "Programming sensor alarm thresholds %d, %d and rule levels", thresholds.first.GetFloorDegrees(), thresholds.second.GetFloorDegrees());
+    // Retried on the next sample if a sensor didn't take it
+    auto alarm = _alarm;
+    _has_sensor_thresholds = _sensors->SetAlarmThresholds([alarm](const DS18B20::RomCode& rom_code) {
+        return alarm->GetSensorBand(AlarmRules::GetSensorId(rom_code));
+    });
+    _sensor_thresholds_version = version;
+}
+
+void AdaptiveSampler::HandleSample(const DS18B20BusGroup::Sample& sample, bool is_full_read)
+{
+    const int64_t sample_time_us = sample.timestamp_us;
+    if (!sample.readings.empty()) {
+        _on_sample(sample);
+    }
+
+    // Only full reads pace the sampling, an alarming-only read may not include the pacing sensor
+    if (!is_full_read) {
+        return;
+    }
+    _last_full_read_us = sample_time_us;
+
+    // Pace on the primary sensor, the one the UI shows
+    const auto* primary = sample.GetPrimary();
+    if (primary == nullptr || !primary->IsValid()) {
+        _last_temp = Temperature::Invalid();
+        _plan = NO_READING_PLAN;
+        return;
+    }
+
+    const Temperature temperature = primary->temperature;
+    _last_temp = temperature;
+
+    const auto trend = _trend_binding->GetValue();
+    const auto new_plan = SelectPlan(temperature, trend, _alarm->GetValue(), sample_time_us);
+    if (!(new_plan == _plan)) {
+        ESP_LOGI(TAG, "%.2fC, %.3fC/s: sampling every %lld ms at %d bits", temperature.ToFloat(), trend.slope_c_per_s,
+                 new_plan.period.count(), new_plan.resolution + 9);
+        _plan = new_plan;
+    }
+}
+
+void AdaptiveSampler::ScheduleNext()
+{
+    _next_deadline_us += std::chrono::duration_cast<std::chrono::microseconds>(_plan.period).count();
+
+    // After an overrun (e.g. switching to a shorter period mid-conversion) start again from now instead of bursting to catch up
+    const int64_t now_us = esp_timer_get_time();
+    if (_next_deadline_us < now_us) {
+        _next_deadline_us = now_us;
+    }
+
+    _scheduler.ScheduleAt(_next_deadline_us, [this] {
+        Sample();
+    });
+}
+
+void AdaptiveSampler::RecordJitter(int64_t jitter_us)
+{
+    std::lock_guard<decltype(_stats_lock)> lock(_stats_lock);
+    _jitter_stats.max_us = std::max(_jitter_stats.max_us, jitter_us);
+    _jitter_stats.total_us += jitter_us;
+    ++_jitter_stats.sample_count;
+
+    if (_jitter_stats.sample_count % SAMPLES_PER_JITTER_REPORT == 0) {
+        ESP_LOGI(TAG, "Sample jitter over %u samples: mean %lld us, max %lld us", _jitter_stats.sample_count,
+                 _jitter_stats.GetMeanUs(), _jitter_stats.max_us);
+    }
+}
+
+AdaptiveSampler::JitterStats AdaptiveSampler::GetJitterStats() const
+{
+    std::lock_guard<decltype(_stats_lock)> lock(_stats_lock);
+    return _jitter_stats;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Alarm.hpp"
+#include "ConversionScheduler.hpp"
+#include "DataBinding.hpp"
+#include "DS18B20BusGroup.hpp"
+#include "TemperatureTrend.hpp"
+
+// Picks the sample period and resolution for every conversion from how close the last reading
+// is to the alarm thresholds and when the TemperatureTrend predicts it will cross one. Far from a
+// threshold it samples slowly at 12 bits so the probe doesn't self-heat, backing off further while
+// the predicted crossing is a long way out, close to one it switches to fast 9-bit conversions.
+// Samples are scheduled on absolute deadlines so the cadence doesn't drift.
+//
+// The thresholds, and the levels of the user rules watching each sensor, are also programmed into
+// the sensors' TH/TL registers. Between full reads only the sensors flagged by Alarm Search are read back.
+class AdaptiveSampler {
+public:
+    struct Plan {
+        DS18B20::Resolution_T resolution;
+        std::chrono::milliseconds period;
+
+        bool operator==(const Plan& other) const {return resolution == other.resolution && period == other.period;}
+    };
+
+    struct JitterStats {
+        int64_t max_us = 0;
+        int64_t total_us = 0;
+        uint32_t sample_count = 0;
+
+        [[nodiscard]] int64_t GetMeanUs() const {return sample_count > 0 ? total_us / sample_count : 0;}
+    };
+
+    using SampleCallback = std::function<void(const DS18B20BusGroup::Sample&)>;
+private:
+    std::shared_ptr<DS18B20BusGroup> _sensors;
+    std::shared_ptr<Alarm> _alarm;
+    std::shared_ptr<DataBinding<TemperatureTrend::Fit>> _trend_binding;
+    ConversionScheduler& _scheduler;
+    SampleCallback _on_sample;
+
+    Plan _plan;
+    int64_t _next_deadline_us;
+    Temperature _last_temp;
+    int64_t _last_full_read_us;
+    uint32_t _sensor_thresholds_version; // Of _alarm, when the sensors were last programmed
+    bool _has_sensor_thresholds;
+
+    mutable std::mutex _stats_lock;
+    JitterStats _jitter_stats;
+
+    void Sample();
+    void UpdateSensorThresholds();
+    void HandleSample(const DS18B20BusGroup::Sample& sample, bool is_full_read);
+    void ScheduleNext();
+    void RecordJitter(int64_t jitter_us);
+public:
+    AdaptiveSampler(const std::shared_ptr<DS18B20BusGroup>& sensors,
+                    const std::shared_ptr<Alarm>& alarm,
+                    const std::shared_ptr<DataBinding<TemperatureTrend::Fit>>& trend_binding,
+                    ConversionScheduler& scheduler,
+                    SampleCallback on_sample);
+
+    void Start();
+
+    [[nodiscard]] JitterStats GetJitterStats() const;
+
+    // The trend is expected to already include temperature
+    static Plan SelectPlan(Temperature temperature, const TemperatureTrend::Fit& trend, std::pair<Temperature, Temperature> low_high_thresholds, int64_t now_us);
+};
@@ -1,17 +1,39 @@
 #include "Alarm.hpp"
 
+#include <algorithm>
 #include <cstring>
 
 #include "esp_log.h"
 
 static const char* TAG = "Alarm";
-static const char* LOW_THRESH_KEY = "low_thresh";
-static const char* HI_THRESH_KEY = "hi_thresh";
+static const char* THRESHOLDS_SETTING = "thresholds";
+static const char* INPUT_SETTING = "alarm_input";
+// Older firmware kept each threshold under its own key, as the bits of a double
+static const char* LEGACY_LOW_THRESH_KEY = "low_thresh";
+static const char* LEGACY_HI_THRESH_KEY = "hi_thresh";
+// Bump the version when StoredRule changes, older blobs are then ignored
+static const char* RULES_KEY = "rules_v1";
 
-static constexpr double DEFAULT_LOW_THRESH = -55.;
-static constexpr double DEFAULT_HI_THRESH = 125.;
+static constexpr Temperature DEFAULT_LOW_THRESH = Temperature::FromDegrees(-55);
+static constexpr Temperature DEFAULT_HI_THRESH = Temperature::FromDegrees(125);
+static constexpr uint16_t FIRST_USER_RULE = Alarm::HIGH_THRESHOLD_RULE + 1;
 
-Alarm::Alarm() : _last_alarm(Alarm_T::NONE)
+// NVS layout of a user rule
+struct StoredRule {
+    uint64_t sensor;
+    uint32_t hold_s;
+    uint16_t id;
+    uint16_t requires_id;
+    int16_t level;
+    int16_t hysteresis;
+    uint8_t kind;
+    uint8_t alarm;
+    uint8_t reserved[2];
+};
+static_assert(sizeof(StoredRule) == 24, "StoredRule is stored as is");
+
+Alarm::Alarm(const std::shared_ptr<SettingsStore>& settings) : _thresholds(settings, THRESHOLDS_SETTING, std::make_pair(DEFAULT_LOW_THRESH, DEFAULT_HI_THRESH)),
+                                                                _input(settings, INPUT_SETTING, Input_T::FILTERED)
 {
     esp_err_t result;
     _nvs_handle = nvs::open_nvs_handle("storage", NVS_READWRITE, &result);
@@ -19,84 +41,233 @@ Alarm::Alarm() : _last_alarm(Alarm_T::NONE)
         ESP_LOGE(TAG, "Error opening NVS");
         _nvs_handle = nullptr;
     }
-    
-    _low_threshold = GetEememValueOrDefault(LOW_THRESH_KEY, DEFAULT_LOW_THRESH);
-    _high_threshold = GetEememValueOrDefault(HI_THRESH_KEY, DEFAULT_HI_THRESH);
+
+    if (!_thresholds.IsLoaded()) {
+        _thresholds.SetValue(std::make_pair(MigrateLegacyThreshold(LEGACY_LOW_THRESH_KEY, DEFAULT_LOW_THRESH),
+                                            MigrateLegacyThreshold(LEGACY_HI_THRESH_KEY, DEFAULT_HI_THRESH)));
+        // Only drop the old keys once the blob holding their values is on flash
+        if (settings->Flush() && _nvs_handle) {
+            for (const char* key : {LEGACY_LOW_THRESH_KEY, LEGACY_HI_THRESH_KEY}) {
+                _nvs_handle->erase_item(key);
+            }
+            _nvs_handle->commit();
+        }
+    }
+    const auto thresholds = _thresholds.GetValue();
+
+    std::lock_guard<decltype(_critical_section)> lock(_critical_section);
+    if (!CompileRules(thresholds, LoadUserRules())) {
+        ESP_LOGE(TAG, "Stored rules don't compile, only using the thresholds");
+        CompileRules(thresholds, {});
+    }
 }
 
-std::pair<double, double> Alarm::GetLowHighThresholds() const 
+bool Alarm::CompileRules(std::pair<Temperature, Temperature> thresholds, const std::vector<Rule>& user_rules)
 {
-    return std::make_pair(_low_threshold, _high_threshold);
+    std::vector<Rule> rules;
+    rules.reserve(user_rules.size() + 2);
+
+    Rule low_rule;
+    low_rule.id = LOW_THRESHOLD_RULE;
+    low_rule.kind = AlarmRules::BELOW;
+    low_rule.level = thresholds.first;
+    low_rule.alarm = Alarm_T::LOW;
+    rules.push_back(low_rule);
+
+    Rule high_rule;
+    high_rule.id = HIGH_THRESHOLD_RULE;
+    high_rule.kind = AlarmRules::ABOVE;
+    high_rule.level = thresholds.second;
+    high_rule.alarm = Alarm_T::HIGH;
+    rules.push_back(high_rule);
+
+    rules.insert(rules.end(), user_rules.begin(), user_rules.end());
+    if (!_rules.SetRules(rules)) {
+        return false;
+    }
+    _user_rules = user_rules;
+    return true;
 }
 
-void Alarm::SetValue(std::pair<double, double> new_value) 
+std::pair<Temperature, Temperature> Alarm::GetLowHighThresholds() const 
 {
-    std::lock_guard<decltype(_critical_section)> lock(_critical_section);
+    return _thresholds.GetValue();
+}
 
-    std::tie(_low_threshold, _high_threshold) = new_value;
-    UpdateEememValue(LOW_THRESH_KEY, _low_threshold);
-    UpdateEememValue(HI_THRESH_KEY, _high_threshold);
-    _last_alarm = Alarm_T::NONE;
+bool Alarm::SetThresholds(std::pair<Temperature, Temperature> new_value) 
+{
+    {
+        std::lock_guard<decltype(_critical_section)> lock(_critical_section);
+        // The form posts both thresholds on every save, usually unchanged: nothing to compile, store or notify
+        if (new_value == _thresholds.GetValue()) {
+            return true;
+        }
+
+        // Changed rules re-arm
+        if (!CompileRules(new_value, _user_rules)) {
+            ESP_LOGE(TAG, "Thresholds don't compile with the rules, not updating");
+            return false;
+        }
+        // Written to flash in the background
+        _thresholds.SetValue(new_value);
+    }
+    Notify(new_value);
+    return true;
 }
 
-std::pair<double, double> Alarm::GetValue() const 
+std::pair<Temperature, Temperature> Alarm::GetValue() const 
 {
-    std::lock_guard<decltype(_critical_section)> lock(_critical_section);
     return GetLowHighThresholds();
 }
 
-Alarm::Alarm_T Alarm::Evaluate(double new_measurement) 
+Alarm::Alarm_T Alarm::Evaluate(const AlarmRules::Readings& readings) 
 {
     std::lock_guard<decltype(_critical_section)> lock(_critical_section);
-    Alarm::Alarm_T new_alarm = Alarm_T::NONE;
+    const Temperature primary = _input.GetValue() == Input_T::RAW ? readings.primary.raw : readings.primary.filtered;
+    return _rules.Evaluate(readings, primary);
+}
 
-    
-    if (new_measurement <= _low_threshold) {
-        new_alarm = Alarm_T::LOW;
-    } else if (new_measurement >= _high_threshold) {
-        new_alarm = Alarm_T::HIGH;
+std::vector<std::pair<Alarm::Rule, bool>> Alarm::GetRules() const
+{
+    std::lock_guard<decltype(_critical_section)> lock(_critical_section);
+    std::vector<std::pair<Rule, bool>> rules;
+    for (const auto& rule : _rules.GetRules()) {
+        rules.emplace_back(rule, _rules.IsActive(rule.id));
     }
+    return rules;
+}
+
+int Alarm::AddRule(Rule rule)
+{
+    {
+        std::lock_guard<decltype(_critical_section)> lock(_critical_section);
+        if (_user_rules.size() >= MAX_USER_RULES) {
+            ESP_LOGE(TAG, "Too many rules");
+            return -1;
+        }
 
-    if (new_alarm == Alarm_T::NONE || new_alarm == _last_alarm) {
-        return Alarm_T::NONE;
+        uint16_t id = FIRST_USER_RULE;
+        for (const auto& user_rule : _user_rules) {
+            id = std::max<uint16_t>(id, user_rule.id + 1);
+        }
+        rule.id = id;
+
+        auto user_rules = _user_rules;
+        user_rules.push_back(rule);
+        if (!CompileRules(_thresholds.GetValue(), user_rules)) {
+            return -1;
+        }
+        SaveUserRules();
     }
+    Notify(_thresholds.GetValue());
+    return rule.id;
+}
 
+bool Alarm::RemoveRule(uint16_t id)
+{
+    {
+        std::lock_guard<decltype(_critical_section)> lock(_critical_section);
+        auto user_rules = _user_rules;
+        const auto it = std::find_if(user_rules.begin(), user_rules.end(), [id](const Rule& rule) { return rule.id == id; });
+        if (it == user_rules.end()) {
+            return false;
+        }
+        user_rules.erase(it);
+        if (!CompileRules(_thresholds.GetValue(), user_rules)) {
+            return false;
+        }
+        SaveUserRules();
+    }
+    Notify(_thresholds.GetValue());
+    return true;
+}
 
-    _last_alarm = new_alarm;
-    return new_alarm;
+std::pair<Temperature, Temperature> Alarm::GetSensorBand(AlarmRules::SensorId sensor) const
+{
+    std::lock_guard<decltype(_critical_section)> lock(_critical_section);
+    return _rules.GetAlarmBand(sensor);
 }
 
-double Alarm::GetEememValueOrDefault(const char* key, double default_value) 
+std::vector<Alarm::Rule> Alarm::LoadUserRules()
 {
     if (!_nvs_handle) {
-        return default_value;
+        return {};
     }
 
-    uint64_t value_as_int;
-    auto err = _nvs_handle->get_item(key, value_as_int);
-    switch (err) {
-        case ESP_OK: {
-            double ret_val;
-            memcpy(&ret_val, &value_as_int, sizeof(ret_val));
-            return ret_val;
+    size_t size = 0;
+    if (_nvs_handle->get_item_size(nvs::ItemType::BLOB, RULES_KEY, size) != ESP_OK || size % sizeof(StoredRule) != 0) {
+        return {};
+    }
+    std::vector<StoredRule> stored(std::min(size / sizeof(StoredRule), MAX_USER_RULES));
+    if (_nvs_handle->get_blob(RULES_KEY, stored.data(), stored.size() * sizeof(StoredRule)) != ESP_OK) {
+        ESP_LOGE(TAG, "Error reading rules from EEMEM");
+        return {};
+    }
+
+    std::vector<Rule> rules;
+    rules.reserve(stored.size());
+    for (const auto& entry : stored) {
+        // The names in the UI are looked up by these, so a damaged record is dropped rather than cast
+        if (!AlarmRules::IsValidKind(entry.kind) || !AlarmRules::IsValidAlarm(entry.alarm)) {
+            ESP_LOGW(TAG, "Dropping stored rule %d with kind %d and alarm %d", entry.id, entry.kind, entry.alarm);
+            continue;
         }
-        case ESP_ERR_NVS_NOT_FOUND:
-        default :
-            ESP_LOGI(TAG, "Value for %s not found in EEMEM, return default %lf.", key, default_value);
-            return default_value;
+        Rule rule;
+        rule.id = entry.id;
+        rule.kind = static_cast<AlarmRules::Kind_T>(entry.kind);
+        rule.sensor = entry.sensor;
+        rule.level = Temperature::FromSixteenths(entry.level);
+        rule.hysteresis = Temperature::FromSixteenths(entry.hysteresis);
+        rule.hold_s = entry.hold_s;
+        rule.requires_id = entry.requires_id;
+        rule.alarm = static_cast<Alarm_T>(entry.alarm);
+        rules.push_back(rule);
     }
+    ESP_LOGI(TAG, "Loaded %d rules", static_cast<int>(rules.size()));
+    return rules;
 }
 
-void Alarm::UpdateEememValue(const char* name, double new_value) 
+void Alarm::SaveUserRules()
 {
     if (!_nvs_handle) {
         return;
     }
+    if (_user_rules.empty()) {
+        _nvs_handle->erase_item(RULES_KEY);
+        _nvs_handle->commit();
+        return;
+    }
 
-    uint64_t as_int;
-    memcpy(&as_int, &new_value, sizeof(as_int));
-    auto err = _nvs_handle->set_item(name, as_int);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving value for %s to EEMEM", name);
+    std::vector<StoredRule> stored;
+    stored.reserve(_user_rules.size());
+    for (const auto& rule : _user_rules) {
+        StoredRule entry = {};
+        entry.sensor = rule.sensor;
+        entry.hold_s = rule.hold_s;
+        entry.id = rule.id;
+        entry.requires_id = rule.requires_id;
+        entry.level = rule.level.GetSixteenths();
+        entry.hysteresis = rule.hysteresis.GetSixteenths();
+        entry.kind = static_cast<uint8_t>(rule.kind);
+        entry.alarm = static_cast<uint8_t>(rule.alarm);
+        stored.push_back(entry);
     }
+
+    if (_nvs_handle->set_blob(RULES_KEY, stored.data(), stored.size() * sizeof(StoredRule)) != ESP_OK ||
+        _nvs_handle->commit() != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving rules to EEMEM");
+    }
+}
+
+Temperature Alarm::MigrateLegacyThreshold(const char* key, Temperature default_value) 
+{
+    uint64_t value_as_int;
+    if (!_nvs_handle || _nvs_handle->get_item(key, value_as_int) != ESP_OK) {
+        return default_value;
+    }
+
+    double legacy_value;
+    memcpy(&legacy_value, &value_as_int, sizeof(legacy_value));
+    ESP_LOGI(TAG, "Migrating %s to the settings store.", key);
+    return Temperature::FromFloat(static_cast<float>(legacy_value));
 }
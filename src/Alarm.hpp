@@ -1,7 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <memory>
+#include <vector>
 
 #include "nvs_flash.h"
 #include "nvs.h"
@@ -10,32 +12,66 @@
 #include "freertos/task.h"
 #include "esp_system.h"
 
+#include "AlarmRules.hpp"
 #include "DataBinding.hpp"
+#include "SettingsStore.hpp"
+#include "Temperature.hpp"
+#include "TemperatureFilter.hpp"
 
-
-class Alarm : public DataBinding<std::pair<double,double>> {
+// The low/high thresholds bound to the UI, plus any number of user rules, all evaluated by one
+// AlarmRules table. The thresholds are the two built-in rules and persist through the SettingsStore;
+// user rules are kept in their own NVS blob.
+class Alarm : public DataBinding<std::pair<Temperature, Temperature>> {
 public:
- enum Alarm_T {
-        NONE,
-        LOW,
-        HIGH
+    using Alarm_T = AlarmRules::Alarm_T;
+    using Rule = AlarmRules::Rule;
+
+    static constexpr uint16_t LOW_THRESHOLD_RULE = 0;
+    static constexpr uint16_t HIGH_THRESHOLD_RULE = 1;
+    static constexpr size_t MAX_USER_RULES = 64; // What fits in NVS comfortably
+
+    // Which side of the TemperatureFilter the alarm looks at. Raw reacts a little faster, filtered ignores glitches.
+    enum Input_T {
+        RAW,
+        FILTERED
     };
 private:
-    mutable std::mutex _critical_section;
-    double _low_threshold;
-    double _high_threshold;
-    std::unique_ptr<nvs::NVSHandle> _nvs_handle;
-    Alarm_T _last_alarm;
-
-    double GetEememValueOrDefault(const char* name, double default_value);
-    void UpdateEememValue(const char* name, double new_value);
+    mutable std::mutex _critical_section; // Guards the rules and the NVS writes, readers of the thresholds go through _thresholds
+    PersistentValue<std::pair<Temperature, Temperature>> _thresholds;
+    PersistentValue<Input_T> _input;
+    std::unique_ptr<nvs::NVSHandle> _nvs_handle; // For the rules, they don't have a fixed size
+    AlarmRules _rules;
+    std::vector<Rule> _user_rules;
+
+    // Reads a threshold older firmware stored under its own key
+    Temperature MigrateLegacyThreshold(const char* key, Temperature default_value);
+    std::vector<Rule> LoadUserRules();
+    void SaveUserRules();
+    // Compiles the built-in rules for thresholds along with user_rules
+    bool CompileRules(std::pair<Temperature, Temperature> thresholds, const std::vector<Rule>& user_rules);
 public:
    
-    Alarm();
-    std::pair<double, double> GetLowHighThresholds() const;
+    explicit Alarm(const std::shared_ptr<SettingsStore>& settings);
+    std::pair<Temperature, Temperature> GetLowHighThresholds() const;
+
+    // False, leaving the thresholds as they were, if they don't compile along with the user rules
+    bool SetThresholds(std::pair<Temperature, Temperature> new_value);
+    void SetValue(std::pair<Temperature, Temperature> new_value) override { SetThresholds(new_value); }
+    std::pair<Temperature, Temperature> GetValue() const override;
+    // Rules on the primary sensor see the side selected by SetInput. Returns the alarm of the first rule that fired.
+    [[nodiscard]] Alarm_T Evaluate(const AlarmRules::Readings& readings);
+
+    // Every rule, built-in ones included, with whether it is active
+    [[nodiscard]] std::vector<std::pair<Rule, bool>> GetRules() const;
+    // Gives the rule a free id and returns it, -1 if it's rejected (see AlarmRules::SetRules) or there are too many
+    int AddRule(Rule rule);
+    // False for unknown and built-in rules, and for rules others require
+    bool RemoveRule(uint16_t id);
+    // See AlarmRules::GetAlarmBand. Adding or removing a rule bumps the version like a threshold change does,
+    // so the sensors get programmed again.
+    [[nodiscard]] std::pair<Temperature, Temperature> GetSensorBand(AlarmRules::SensorId sensor) const;
 
-    void SetValue(std::pair<double, double> new_value) override;
-    std::pair<double, double> GetValue() const override;
-    [[nodiscard]] Alarm_T Evaluate(double new_measurement);
+    void SetInput(Input_T input) { _input.SetValue(input); }
+    [[nodiscard]] Input_T GetInput() const { return _input.GetValue(); }
     
 };
\ No newline at end of file
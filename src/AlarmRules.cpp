@@ -0,0 +1,284 @@
+#include "AlarmRules.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "esp_log.h"
+
+static const char* TAG = "AlarmRules";
+
+static constexpr int64_t RATE_PERIOD_US = 10000000;
+static constexpr int64_t US_PER_MIN = 60000000;
+
+static int16_t ClampSixteenths(int32_t value)
+{
+    // INVALID_SIXTEENTHS is never a level
+    return static_cast<int16_t>(std::min<int32_t>(std::max<int32_t>(value, Temperature::INVALID_SIXTEENTHS + 1),
+                                                  std::numeric_limits<int16_t>::max()));
+}
+
+AlarmRules::SensorId AlarmRules::GetSensorId(const OneWireBus::RomCode& rom_code)
+{
+    SensorId id = 0;
+    for (size_t i = 0; i < rom_code.bytes.size(); i++) {
+        id |= static_cast<SensorId>(rom_code.bytes[i]) << (8 * i);
+    }
+    return id;
+}
+
+bool AlarmRules::SetRules(const std::vector<Rule>& rules)
+{
+    if (rules.size() > MAX_RULES) {
+        ESP_LOGE(TAG, "Too many rules: %d", static_cast<int>(rules.size()));
+        return false;
+    }
+
+    // Ids to positions, sorted for lookups
+    std::vector<std::pair<uint16_t, size_t>> by_id;
+    by_id.reserve(rules.size());
+    for (size_t i = 0; i < rules.size(); i++) {
+        by_id.emplace_back(rules[i].id, i);
+    }
+    std::sort(by_id.begin(), by_id.end());
+    for (size_t i = 1; i < by_id.size(); i++) {
+        if (by_id[i].first == by_id[i - 1].first) {
+            ESP_LOGE(TAG, "Duplicate rule id %d", by_id[i].first);
+            return false;
+        }
+    }
+
+    for (const auto& rule : rules) {
+        if (rule.hold_s > MAX_HOLD_S) {
+            ESP_LOGE(TAG, "Rule %d holds for too long: %u s", rule.id, rule.hold_s);
+            return false;
+        }
+        if (!IsValidKind(rule.kind) || !IsValidAlarm(rule.alarm)) {
+            ESP_LOGE(TAG, "Rule %d has kind %d and alarm %d", rule.id, static_cast<int>(rule.kind), static_cast<int>(rule.alarm));
+            return false;
+        }
+    }
+
+    static constexpr size_t NO_INDEX = SIZE_MAX;
+    std::vector<size_t> requires_index(rules.size(), NO_INDEX);
+    for (size_t i = 0; i < rules.size(); i++) {
+        if (rules[i].requires_id == NO_RULE) {
+            continue;
+        }
+        const auto it = std::lower_bound(by_id.begin(), by_id.end(), std::make_pair(rules[i].requires_id, size_t(0)));
+        if (it == by_id.end() || it->first != rules[i].requires_id) {
+            ESP_LOGE(TAG, "Rule %d requires missing rule %d", rules[i].id, rules[i].requires_id);
+            return false;
+        }
+        requires_index[i] = it->second;
+    }
+
+    // Every rule requires at most one other, so the requirements form chains: walk each one up to a
+    // rule already placed (or its root), then place it root first
+    static constexpr int UNPLACED = -1;
+    static constexpr int VISITING = -2;
+    std::vector<int> table_index(rules.size(), UNPLACED);
+    std::vector<size_t> order;
+    std::vector<size_t> chain;
+    order.reserve(rules.size());
+    for (size_t i = 0; i < rules.size(); i++) {
+        chain.clear();
+        size_t j = i;
+        while (table_index[j] == UNPLACED) {
+            table_index[j] = VISITING;
+            chain.push_back(j);
+            if (requires_index[j] == NO_INDEX) {
+                break;
+            }
+            j = requires_index[j];
+        }
+        if (table_index[j] == VISITING && requires_index[j] != NO_INDEX) {
+            ESP_LOGE(TAG, "Rule requirements loop through rule %d", rules[j].id);
+            return false;
+        }
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            table_index[*it] = static_cast<int>(order.size());
+            order.push_back(*it);
+        }
+    }
+
+    std::vector<SensorId> sensors;
+    for (const auto& rule : rules) {
+        if (std::find(sensors.begin(), sensors.end(), rule.sensor) == sensors.end()) {
+            sensors.push_back(rule.sensor);
+        }
+    }
+    if (sensors.size() > MAX_SENSORS + 1) {
+        ESP_LOGE(TAG, "Rules watch too many sensors: %d", static_cast<int>(sensors.size()));
+        return false;
+    }
+
+    std::vector<std::pair<uint16_t, size_t>> old_by_id;
+    old_by_id.reserve(_rules.size());
+    for (size_t i = 0; i < _rules.size(); i++) {
+        old_by_id.emplace_back(_rules[i].id, i);
+    }
+    std::sort(old_by_id.begin(), old_by_id.end());
+
+    std::vector<Rule> ordered_rules;
+    std::vector<CompiledRule> table;
+    std::vector<RuleState> states(rules.size());
+    ordered_rules.reserve(rules.size());
+    table.reserve(rules.size());
+    for (const size_t i : order) {
+        const Rule& rule = rules[i];
+        const bool is_rate = rule.kind == RISING || rule.kind == FALLING;
+        const bool is_negated = rule.kind == BELOW || rule.kind == FALLING;
+        const auto sensor_index = std::find(sensors.begin(), sensors.end(), rule.sensor) - sensors.begin();
+
+        // BELOW level L: v <= L sets, v > L + h clears, i.e. -v >= -L and -v < -(L + h).
+        // FALLING compares the negated rate against the level as given.
+        int32_t set_level = rule.level.GetSixteenths();
+        const int32_t hysteresis = std::abs(rule.hysteresis.IsValid() ? rule.hysteresis.GetSixteenths() : 0);
+        int32_t clear_level = set_level - hysteresis;
+        if (rule.kind == BELOW) {
+            set_level = -set_level;
+            clear_level = -(rule.level.GetSixteenths() + hysteresis);
+        }
+
+        CompiledRule compiled;
+        compiled.set_level = ClampSixteenths(set_level);
+        compiled.clear_level = ClampSixteenths(clear_level);
+        compiled.hold_ms = rule.hold_s * 1000;
+        compiled.requires = requires_index[i] == NO_INDEX ? NO_RULE : static_cast<uint16_t>(table_index[requires_index[i]]);
+        compiled.value_index = static_cast<uint8_t>(2 * sensor_index + (is_rate ? 1 : 0));
+        compiled.flags = is_negated ? NEGATE_FLAG : 0;
+        table.push_back(compiled);
+        ordered_rules.push_back(rule);
+
+        // Carry over what the old table knew about this rule, an edited rule starts again
+        const auto old = std::lower_bound(old_by_id.begin(), old_by_id.end(), std::make_pair(rule.id, size_t(0)));
+        if (old != old_by_id.end() && old->first == rule.id && _rules[old->second] == rule) {
+            states[table.size() - 1] = _states[old->second];
+        }
+    }
+
+    std::vector<RateTracker> rates(sensors.size());
+    for (size_t i = 0; i < sensors.size(); i++) {
+        const auto old = std::find(_sensors.begin(), _sensors.end(), sensors[i]);
+        if (old != _sensors.end()) {
+            rates[i] = _rates[old - _sensors.begin()];
+        }
+    }
+
+    _rules = std::move(ordered_rules);
+    _table = std::move(table);
+    _states = std::move(states);
+    _sensors = std::move(sensors);
+    _rates = std::move(rates);
+    _values.assign(2 * _sensors.size(), Temperature::INVALID_SIXTEENTHS);
+    return true;
+}
+
+bool AlarmRules::IsActive(uint16_t id) const
+{
+    const auto it = std::find_if(_rules.begin(), _rules.end(), [id](const Rule& rule) { return rule.id == id; });
+    return it != _rules.end() && _states[it - _rules.begin()].is_active;
+}
+
+std::pair<Temperature, Temperature> AlarmRules::GetAlarmBand(SensorId sensor) const
+{
+    // The widest the sensor measures, nothing gets flagged
+    int32_t low = Temperature::FromDegrees(-55).GetSixteenths();
+    int32_t high = Temperature::FromDegrees(125).GetSixteenths();
+    for (const auto& rule : _rules) {
+        if ((rule.sensor != sensor && rule.sensor != PRIMARY_SENSOR) || !rule.level.IsValid()) {
+            continue;
+        }
+        if (rule.kind == ABOVE) {
+            high = std::min<int32_t>(high, rule.level.GetSixteenths());
+        } else if (rule.kind == BELOW) {
+            low = std::max<int32_t>(low, rule.level.GetSixteenths());
+        }
+    }
+    return std::make_pair(Temperature::FromSixteenths(static_cast<int16_t>(low)), Temperature::FromSixteenths(static_cast<int16_t>(high)));
+}
+
+void AlarmRules::UpdateValues(const Readings& readings, Temperature primary)
+{
+    for (size_t i = 0; i < _sensors.size(); i++) {
+        Temperature value = Temperature::Invalid();
+        bool is_read = false;
+        if (_sensors[i] == PRIMARY_SENSOR) {
+            value = primary;
+            is_read = !readings.is_partial;
+        } else {
+            for (size_t j = 0; j < readings.sensor_count; j++) {
+                if (readings.sensor_ids[j] == _sensors[i]) {
+                    value = readings.sensor_values[j];
+                    is_read = true;
+                    break;
+                }
+            }
+        }
+        // Left out of a partial read because it isn't alarming, not because it's gone. Its last value
+        // stands, so hold times carry on.
+        if (!is_read && readings.is_partial) {
+            continue;
+        }
+        _values[2 * i] = value.GetSixteenths();
+
+        RateTracker& rate = _rates[i];
+        if (!value.IsValid()) {
+            continue;
+        }
+        if (!rate.reference.IsValid() || readings.timestamp_us < rate.reference_us) {
+            rate = {value, readings.timestamp_us, Temperature::INVALID_SIXTEENTHS};
+        } else if (readings.timestamp_us - rate.reference_us >= RATE_PERIOD_US) {
+            const int64_t change = value.GetSixteenths() - rate.reference.GetSixteenths();
+            rate.sixteenths_per_min = ClampSixteenths(static_cast<int32_t>(change * US_PER_MIN / (readings.timestamp_us - rate.reference_us)));
+            rate.reference = value;
+            rate.reference_us = readings.timestamp_us;
+        }
+        _values[2 * i + 1] = rate.sixteenths_per_min;
+    }
+}
+
+AlarmRules::Alarm_T AlarmRules::Evaluate(const Readings& readings, Temperature primary)
+{
+    UpdateValues(readings, primary);
+
+    const int64_t now_us = readings.timestamp_us;
+    Alarm_T fired = NONE;
+    for (size_t i = 0; i < _table.size(); i++) {
+        const CompiledRule& rule = _table[i];
+        RuleState& state = _states[i];
+
+        int32_t value = _values[rule.value_index];
+        const bool is_required_active = rule.requires == NO_RULE || _states[rule.requires].is_active;
+        if (value == Temperature::INVALID_SIXTEENTHS) {
+            // Nothing to go on, keep the state but restart the hold time
+            state.condition_since_us = NOT_PENDING;
+            state.is_active = state.is_active && is_required_active;
+            continue;
+        }
+        if (rule.flags & NEGATE_FLAG) {
+            value = -value;
+        }
+
+        if (state.is_active) {
+            state.is_active = value >= rule.clear_level && is_required_active;
+            continue;
+        }
+        if (value < rule.set_level || !is_required_active) {
+            state.condition_since_us = NOT_PENDING;
+            continue;
+        }
+        if (state.condition_since_us == NOT_PENDING) {
+            state.condition_since_us = now_us;
+        }
+        if (now_us - state.condition_since_us >= static_cast<int64_t>(rule.hold_ms) * 1000) {
+            state.is_active = true;
+            state.condition_since_us = NOT_PENDING;
+            if (fired == NONE) {
+                fired = _rules[i].alarm;
+            }
+        }
+    }
+    return fired;
+}
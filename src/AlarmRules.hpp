@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "OneWireBus.hpp"
+#include "Temperature.hpp"
+#include "TemperatureFilter.hpp"
+
+// Alarm rules compiled into a flat table that is evaluated in one pass per sample without allocating.
+// A rule watches one sensor's temperature or rate of change, fires once the condition has held for
+// hold_s, and re-arms only after the value moved back past the hysteresis band, so a reading that
+// hovers at a threshold doesn't fire again and again. A rule can require another one (e.g. on another
+// sensor) to be active. Compiling orders the table so required rules are evaluated first and turns
+// BELOW/FALLING into negated ABOVE/RISING, every entry is then the same compare.
+//
+// Not thread safe, Alarm serialises access.
+class AlarmRules {
+public:
+    enum Alarm_T {
+        NONE,
+        LOW,
+        HIGH
+    };
+
+    enum Kind_T {
+        ABOVE,
+        BELOW,
+        RISING, // Levels in C per minute
+        FALLING
+    };
+
+    using SensorId = uint64_t; // The 48-bit serial number from the ROM code
+    static constexpr SensorId PRIMARY_SENSOR = 0; // The reading the UI shows, after the TemperatureFilter
+    static constexpr uint16_t NO_RULE = UINT16_MAX;
+    static constexpr size_t MAX_RULES = 4096;
+    static constexpr size_t MAX_SENSORS = 8;
+    static constexpr Temperature DEFAULT_HYSTERESIS = Temperature::FromSixteenths(8); // 0.5C, one 9-bit step
+    static constexpr uint32_t MAX_HOLD_S = 24 * 60 * 60;
+
+    struct Rule {
+        uint16_t id = 0;
+        Kind_T kind = ABOVE;
+        SensorId sensor = PRIMARY_SENSOR;
+        Temperature level;
+        Temperature hysteresis = DEFAULT_HYSTERESIS;
+        uint32_t hold_s = 0; // Up to MAX_HOLD_S
+        uint16_t requires_id = NO_RULE; // Only fires, and stays active, while that rule is active
+        Alarm_T alarm = HIGH;
+
+        bool operator==(const Rule& other) const {
+            return id == other.id && kind == other.kind && sensor == other.sensor && level == other.level &&
+                   hysteresis == other.hysteresis && hold_s == other.hold_s && requires_id == other.requires_id && alarm == other.alarm;
+        }
+    };
+
+    // One sample of every sensor, plain data so it can go through a DataSourceSeqLock
+    struct Readings {
+        int64_t timestamp_us = 0;
+        TemperatureFilter::Output primary = {Temperature::Invalid(), Temperature::Invalid(), true};
+        uint8_t sensor_count = 0;
+        std::array<SensorId, MAX_SENSORS> sensor_ids = {};
+        std::array<Temperature, MAX_SENSORS> sensor_values = {}; // Raw
+        // Only some sensors were read (Alarm Search), the others keep their last value, the primary one included
+        bool is_partial = false;
+    };
+private:
+    static constexpr uint8_t NEGATE_FLAG = 0x01;
+    static constexpr int64_t NOT_PENDING = INT64_MIN;
+
+    struct CompiledRule {
+        int16_t set_level; // Active at or above
+        int16_t clear_level; // Inactive below
+        uint32_t hold_ms;
+        uint16_t requires; // Table index, always lower than this entry's
+        uint8_t value_index; // Into _values
+        uint8_t flags;
+    };
+
+    struct RuleState {
+        int64_t condition_since_us = NOT_PENDING;
+        bool is_active = false;
+    };
+
+    // Rate of change from readings at least RATE_PERIOD_US apart, 9-bit steps are too coarse over a single sample period
+    struct RateTracker {
+        Temperature reference;
+        int64_t reference_us = 0;
+        int16_t sixteenths_per_min = Temperature::INVALID_SIXTEENTHS;
+    };
+
+    std::vector<Rule> _rules; // In table order
+    std::vector<CompiledRule> _table;
+    std::vector<RuleState> _states;
+    std::vector<SensorId> _sensors; // Each has two _values, temperature then rate
+    std::vector<RateTracker> _rates;
+    std::vector<int16_t> _values;
+
+    void UpdateValues(const Readings& readings, Temperature primary);
+public:
+    // Kinds and alarms read back from storage may be anything, a rule only sounds LOW or HIGH
+    static constexpr bool IsValidKind(int kind) { return kind >= ABOVE && kind <= FALLING; }
+    static constexpr bool IsValidAlarm(int alarm) { return alarm == LOW || alarm == HIGH; }
+
+    // Compiles a new rule set, keeping the state of rules that didn't change. False, leaving the
+    // rules unchanged, if ids repeat, a rule requires a missing rule, the requirements loop, a hold is
+    // longer than MAX_HOLD_S, a kind or alarm is out of range or there are too many rules or sensors.
+    bool SetRules(const std::vector<Rule>& rules);
+    // Required rules come before the rules requiring them
+    [[nodiscard]] const std::vector<Rule>& GetRules() const { return _rules; }
+    [[nodiscard]] bool IsActive(uint16_t id) const;
+    // Low/high TH/TL for a sensor so Alarm Search flags it whenever one of its ABOVE/BELOW rules could fire.
+    // Rules on the primary sensor count for every sensor, any of them can become the primary one.
+    // Rate rules have no band, they are caught by the full reads.
+    [[nodiscard]] std::pair<Temperature, Temperature> GetAlarmBand(SensorId sensor) const;
+
+    // primary is the value PRIMARY_SENSOR rules look at. Returns the alarm of the first rule that became active.
+    Alarm_T Evaluate(const Readings& readings, Temperature primary);
+
+    static SensorId GetSensorId(const OneWireBus::RomCode& rom_code);
+};
@@ -1,12 +1,16 @@
 #include "Audio.hpp"
 
+#include <algorithm>
+
 #include "driver/ledc.h"
 
 #include "esp_log.h"
 
 static const char* TAG = "Audio";
 
-Audio::Audio(gpio_num_t pin) : _pin(pin), _is_running(true)
+static constexpr uint32_t TONE_DUTY = 50; // Out of 1023, the buzzer is loud enough at 5%
+
+Audio::Audio(gpio_num_t pin) : _pin(pin)
 {
     ledc_timer_config_t ledc_timer;
      
@@ -27,68 +31,130 @@ Audio::Audio(gpio_num_t pin) : _pin(pin), _is_running(true)
     ledc_channel.timer_sel = LEDC_TIMER_0;
     ESP_ERROR_CHECK(ledc_channel_config(&ledc_channel));
 
-    _beep_worker = std::thread([this] {
-        this->TaskWorker();
-    });
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = &Audio::HandleTimer;
+    timer_args.arg = this;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "audio";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &_timer));
 }
 
 Audio::~Audio() 
 {
-    {
-        std::lock_guard<decltype(_beep_queue_lock)> lock(_beep_queue_lock);
-        _is_running = false;
-    }
-    _beep_queue_cv.notify_all();
-
-    _beep_worker.join();
+    esp_timer_stop(_timer);
+    esp_timer_delete(_timer);
+    SetTone(0);
 }
 
-void Audio::Play(const Audio::Beep& beep) 
+void Audio::SetTone(int frequency_hz) 
 {
-    if (beep.IsSilence()){
-        std::this_thread::sleep_for(beep.duration);
+    if (frequency_hz > 0) {
+        ESP_ERROR_CHECK(ledc_set_freq(LEDC_HIGH_SPEED_MODE, LEDC_TIMER_0, frequency_hz));
+        ESP_ERROR_CHECK(ledc_set_duty(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_0, TONE_DUTY));
     } else {
-        ESP_ERROR_CHECK(ledc_set_freq(LEDC_HIGH_SPEED_MODE, LEDC_TIMER_0, beep.frequency_hz));
-        ESP_ERROR_CHECK(ledc_set_duty(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_0, 50));
-        ESP_ERROR_CHECK(ledc_update_duty(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_0));
-        std::this_thread::sleep_for(beep.duration);
         ESP_ERROR_CHECK(ledc_set_duty(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_0, 0));
-        ESP_ERROR_CHECK(ledc_update_duty(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_0));
     }
+    ESP_ERROR_CHECK(ledc_update_duty(LEDC_HIGH_SPEED_MODE, LEDC_CHANNEL_0));
 }
 
-void Audio::PlayTune(const std::vector<Audio::Beep>& to_play) 
+void Audio::HandleTimer(void* arg) 
 {
-    {
-        std::lock_guard<decltype(_beep_queue_lock)> lock(_beep_queue_lock);
-        for (const auto& beep : to_play) {
-            _pending_beeps.push(beep);
+    auto* audio = static_cast<Audio*>(arg);
+    const int64_t now_us = esp_timer_get_time();
+    std::lock_guard<decltype(audio->_lock)> lock(audio->_lock);
+    // A tune started after this timeout was dispatched has already rescheduled the edge
+    if (audio->_playing.beeps == nullptr || now_us < audio->_next_edge_us) {
+        return;
+    }
+    audio->Advance(now_us);
+}
+
+void Audio::Advance(int64_t now_us) 
+{
+    while (_playing.beeps != nullptr && _next_beep == _playing.size) {
+        if (_queued_count == 0) {
+            _playing = Tune();
+            break;
         }
+        _playing = _queued[0];
+        _next_beep = 0;
+        std::move(_queued.begin() + 1, _queued.begin() + _queued_count, _queued.begin());
+        --_queued_count;
+    }
+
+    if (_playing.beeps == nullptr) {
+        SetTone(0);
+        return;
+    }
+
+    const Beep& beep = _playing.beeps[_next_beep++];
+    SetTone(beep.frequency_hz);
+    // Edges are kept on an absolute schedule so timer latency doesn't add up over a tune
+    _next_edge_us += std::chrono::duration_cast<std::chrono::microseconds>(beep.duration).count();
+    if (esp_timer_start_once(_timer, std::max<int64_t>(_next_edge_us - now_us, 0)) != ESP_OK) {
+        ESP_LOGE(TAG, "Error arming the note timer");
     }
-    _beep_queue_cv.notify_all();
 }
 
-void Audio::TaskWorker() 
+void Audio::StartTune(const Tune& tune, int64_t now_us) 
 {
-    while(true) {
-        Audio::Beep next_beep;
-        {
-            std::unique_lock<decltype(_beep_queue_lock)> lock(_beep_queue_lock);
-            
-            if (_pending_beeps.empty()) {
-                _beep_queue_cv.wait_for(lock, std::chrono::seconds(5));
-                if (_pending_beeps.empty()) {
-                    continue;
-                }
-            }
-            if (!_is_running) {
-                return;
-            }
-            
-            next_beep = std::move(_pending_beeps.front());
-            _pending_beeps.pop();
+    esp_timer_stop(_timer);
+    _playing = tune;
+    _next_beep = 0;
+    _next_edge_us = now_us;
+    Advance(now_us);
+}
+
+bool Audio::IsPending(const Beep* beeps) const
+{
+    return _playing.beeps == beeps ||
+           std::any_of(_queued.begin(), _queued.begin() + _queued_count, [beeps](const Tune& tune) {
+               return tune.beeps == beeps;
+           });
+}
+
+bool Audio::PlayTune(const Beep* beeps, size_t size, Priority_T priority) 
+{
+    const int64_t now_us = esp_timer_get_time();
+    std::lock_guard<decltype(_lock)> lock(_lock);
+    if (IsPending(beeps)) {
+        return true;
+    }
+
+    const Tune tune = {beeps, size, priority};
+    if (_playing.beeps == nullptr || priority > _playing.priority) {
+        StartTune(tune, now_us);
+        return true;
+    }
+
+    const auto position = std::find_if(_queued.begin(), _queued.begin() + _queued_count, [priority](const Tune& queued) {
+        return queued.priority < priority;
+    });
+    if (_queued_count == _queued.size()) {
+        if (position == _queued.end()) {
+            ESP_LOGW(TAG, "Tune queue full, dropping tune");
+            return false;
         }
+        // Make room by dropping the newest of the lowest priority tunes
+        --_queued_count;
+    }
+    std::move_backward(position, _queued.begin() + _queued_count, _queued.begin() + _queued_count + 1);
+    *position = tune;
+    ++_queued_count;
+    return true;
+}
+
+void Audio::Stop(Priority_T up_to) 
+{
+    std::lock_guard<decltype(_lock)> lock(_lock);
+    const auto end = std::remove_if(_queued.begin(), _queued.begin() + _queued_count, [up_to](const Tune& tune) {
+        return tune.priority <= up_to;
+    });
+    _queued_count = end - _queued.begin();
 
-        Play(next_beep);
+    if (_playing.beeps != nullptr && _playing.priority <= up_to) {
+        esp_timer_stop(_timer);
+        _playing = Tune();
+        SetTone(0);
     }
 }
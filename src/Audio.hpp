@@ -1,36 +1,70 @@
 #pragma once
+#include <array>
 #include <chrono>
-#include <queue>
-#include <thread>
+#include <cstddef>
 #include <mutex>
-#include <condition_variable>
 
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 
+// Plays tunes on the LEDC peripheral. Note edges are scheduled on one esp_timer at absolute
+// times, so nothing sleeps and no thread sits idle waiting for tunes.
+//
+// Tunes are not copied: PlayTune takes a pointer to the beeps, which must outlive the playback
+// (e.g. a static constexpr array). A higher priority tune cuts the one playing short, a tune that
+// is already playing or queued isn't queued again, and at most MAX_QUEUED_TUNES wait.
 class Audio {
 public:
     struct Beep {
         std::chrono::steady_clock::duration duration;
         int frequency_hz;
 
-        [[nodiscard]] bool IsSilence() const {return frequency_hz <= 0;}
+        [[nodiscard]] constexpr bool IsSilence() const {return frequency_hz <= 0;}
     };
+
+    enum class Priority_T : uint8_t {
+        NOTIFICATION,
+        ALARM
+    };
+
+    static constexpr size_t MAX_QUEUED_TUNES = 4;
 private:
+    struct Tune {
+        const Beep* beeps = nullptr;
+        size_t size = 0;
+        Priority_T priority = Priority_T::NOTIFICATION;
+    };
+
     gpio_num_t _pin;
-    bool _is_running;
-    std::thread _beep_worker;
+    esp_timer_handle_t _timer;
 
-    std::queue<Beep> _pending_beeps;
+    std::mutex _lock;
+    Tune _playing; // beeps is nullptr when idle
+    size_t _next_beep = 0;
+    int64_t _next_edge_us = 0;
+    std::array<Tune, MAX_QUEUED_TUNES> _queued; // Highest priority first, FIFO within a priority
+    size_t _queued_count = 0;
 
-    std::condition_variable _beep_queue_cv;
-    std::mutex _beep_queue_lock;
-    void TaskWorker();
-    void Play(const Audio::Beep& beep);
+    static void HandleTimer(void* arg);
+    // Starts the next beep, or the next queued tune, and arms the timer for its end. Call with _lock held.
+    void Advance(int64_t now_us);
+    void StartTune(const Tune& tune, int64_t now_us); // Call with _lock held
+    [[nodiscard]] bool IsPending(const Beep* beeps) const; // Call with _lock held
+    static void SetTone(int frequency_hz);
 public:
-
-    void PlayTune(const std::vector<Audio::Beep>& to_play);
-    Audio(gpio_num_t pin);
+    explicit Audio(gpio_num_t pin);
     ~Audio();
-};
\ No newline at end of file
+
+    Audio(const Audio&) = delete;
+    Audio& operator=(const Audio&) = delete;
+
+    // False if the queue is full of tunes of at least this priority
+    bool PlayTune(const Beep* beeps, size_t size, Priority_T priority = Priority_T::NOTIFICATION);
+    template <size_t N>
+    bool PlayTune(const std::array<Beep, N>& beeps, Priority_T priority = Priority_T::NOTIFICATION) {
+        return PlayTune(beeps.data(), N, priority);
+    }
+
+    // Silences the playing tune and drops the queued ones, up to and including the given priority
+    void Stop(Priority_T up_to = Priority_T::ALARM);
+};
@@ -0,0 +1,112 @@
+#include "ConversionScheduler.hpp"
+
+#include <algorithm>
+
+#include "esp_log.h"
+
+static const char* TAG = "ConversionScheduler";
+
+ConversionScheduler::ConversionScheduler() : _is_running(true), _timer(nullptr)
+{
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = &ConversionScheduler::HandleTimer;
+    timer_args.arg = this;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "conversion";
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &_timer));
+
+    _worker = std::thread([this] {
+        this->TaskWorker();
+    });
+}
+
+ConversionScheduler::~ConversionScheduler()
+{
+    {
+        std::lock_guard<decltype(_jobs_lock)> lock(_jobs_lock);
+        _is_running = false;
+    }
+    _jobs_cv.notify_all();
+    _worker.join();
+
+    esp_timer_stop(_timer);
+    esp_timer_delete(_timer);
+}
+
+void ConversionScheduler::HandleTimer(void* arg)
+{
+    auto this_obj = static_cast<ConversionScheduler*>(arg);
+    {
+        // Taking the lock orders this notify after the worker started waiting
+        std::lock_guard<decltype(_jobs_lock)> lock(this_obj->_jobs_lock);
+    }
+    this_obj->_jobs_cv.notify_all();
+}
+
+void ConversionScheduler::ArmTimer()
+{
+    esp_timer_stop(_timer);
+    if (_pending_jobs.empty()) {
+        return;
+    }
+
+    const int64_t timeout_us = std::max<int64_t>(_pending_jobs.front().deadline_us - esp_timer_get_time(), 0);
+    if (esp_timer_start_once(_timer, timeout_us) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to arm timer for %lld us", timeout_us);
+    }
+}
+
+bool ConversionScheduler::IsJobDue() const
+{
+    return !_pending_jobs.empty() && _pending_jobs.front().deadline_us <= esp_timer_get_time();
+}
+
+void ConversionScheduler::ScheduleAt(int64_t deadline_us, Job job)
+{
+    bool is_due;
+    {
+        std::lock_guard<decltype(_jobs_lock)> lock(_jobs_lock);
+        auto insert_it = std::upper_bound(_pending_jobs.begin(), _pending_jobs.end(), deadline_us, [](int64_t deadline, const PendingJob& pending) {
+            return deadline < pending.deadline_us;
+        });
+        const bool is_earliest = insert_it == _pending_jobs.begin();
+        _pending_jobs.insert(insert_it, {deadline_us, std::move(job)});
+
+        if (is_earliest) {
+            ArmTimer();
+        }
+        is_due = IsJobDue();
+    }
+
+    if (is_due) {
+        _jobs_cv.notify_all();
+    }
+}
+
+void ConversionScheduler::ScheduleAfter(std::chrono::microseconds delay, Job job)
+{
+    ScheduleAt(esp_timer_get_time() + delay.count(), std::move(job));
+}
+
+void ConversionScheduler::TaskWorker()
+{
+    while (true) {
+        Job next_job;
+        {
+            std::unique_lock<decltype(_jobs_lock)> lock(_jobs_lock);
+            _jobs_cv.wait(lock, [this] {
+                return !_is_running || IsJobDue();
+            });
+
+            if (!_is_running) {
+                return;
+            }
+
+            next_job = std::move(_pending_jobs.front().job);
+            _pending_jobs.erase(_pending_jobs.begin());
+            ArmTimer();
+        }
+
+        next_job();
+    }
+}
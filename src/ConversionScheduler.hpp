@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "esp_timer.h"
+
+// Runs deferred bus work (e.g. reading a scratchpad once a conversion is done) on a single
+// thread. Deadlines are tracked by one esp_timer, so wakeups aren't rounded to the
+// FreeRTOS tick and any number of sensors share one stack.
+class ConversionScheduler {
+public:
+    using Job = std::function<void()>;
+private:
+    struct PendingJob {
+        int64_t deadline_us;
+        Job job;
+    };
+
+    bool _is_running;
+    std::vector<PendingJob> _pending_jobs; // Sorted by deadline
+    std::mutex _jobs_lock;
+    std::condition_variable _jobs_cv;
+    esp_timer_handle_t _timer;
+    std::thread _worker;
+
+    static void HandleTimer(void* arg);
+    void ArmTimer(); // Call with _jobs_lock held
+    [[nodiscard]] bool IsJobDue() const; // Call with _jobs_lock held
+    void TaskWorker();
+public:
+    ConversionScheduler();
+    ~ConversionScheduler();
+
+    // Runs the job on the scheduler thread once esp_timer_get_time() reaches deadline_us
+    void ScheduleAt(int64_t deadline_us, Job job);
+    void ScheduleAfter(std::chrono::microseconds delay, Job job);
+};
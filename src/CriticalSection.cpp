@@ -1,7 +1,7 @@
 
 #include "CriticalSection.hpp"
 
-CriticalSection::CriticalSection() : _critical_section(portMUX_INITIALIZER_UNLOCKED)
+CriticalSection::CriticalSection() : _critical_section(portMUX_INITIALIZER_UNLOCKED), _ref_count(0)
 {
     
 }
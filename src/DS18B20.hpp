@@ -2,18 +2,31 @@
 
 #include <array>
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
 
+#include "ConversionScheduler.hpp"
 #include "OneWireBus.hpp"
+#include "Temperature.hpp"
 
 class DS18B20 {
 public:
-    static constexpr double INVALID_TEMP = -300.0;
-    struct RomCode {
-        uint8_t family_code = 0;
-        std::array<uint8_t,6> bytes;
-        uint8_t crc = 0;
+    static constexpr uint8_t FAMILY_CODE = 0x28;
 
-        [[nodiscard]] bool IsValid() const {return family_code != 0;}
+    // Function commands
+    static constexpr uint8_t CONVERT_T = 0x44;
+    static constexpr uint8_t READ_SCRATCHPAD = 0xBE;
+    static constexpr uint8_t WRITE_SCRATCHPAD = 0x4E;
+
+    using RomCode = OneWireBus::RomCode;
+
+    // Values of the R1:R0 bits in the configuration register
+    enum Resolution_T {
+        RES_9_BIT = 0,
+        RES_10_BIT = 1,
+        RES_11_BIT = 2,
+        RES_12_BIT = 3
     };
 
     struct Scratchpad {
@@ -26,25 +39,57 @@ public:
         uint8_t& temp_alarm_l(){ return data[3];}
         uint8_t& config(){ return data[4];}
         uint8_t& crc() {return data[8];}
+
+        Resolution_T resolution() {return static_cast<Resolution_T>((config() >> 5) & 0x03);}
     };
 
 private:
-    OneWireBus _bus;
+    std::shared_ptr<OneWireBus> _bus;
     RomCode _rom_code;
+    Resolution_T _resolution;
+    // Write Scratchpad always writes TH, TL and config together, keep the alarm registers to write them back
+    uint8_t _temp_alarm_h;
+    uint8_t _temp_alarm_l;
     
-    bool InitRomCode();
-    bool SendMatchRom();
-    bool SendSkipRom();
-    
-    static uint8_t GetCrcByte(uint8_t current_crc, uint8_t byte);
     static bool CheckCrc(const Scratchpad& scratchpad);
-    static bool CheckCrc(const RomCode& rom_code);
+    bool WriteScratchpad(uint8_t temp_alarm_h, uint8_t temp_alarm_l, Resolution_T resolution);
 public:
    
-    explicit DS18B20(gpio_num_t pin);
+    DS18B20(const std::shared_ptr<OneWireBus>& bus, const RomCode& rom_code);
+
+    [[nodiscard]] const RomCode& GetRomCode() const { return _rom_code; }
+    [[nodiscard]] Resolution_T GetResolution() const { return _resolution; }
 
     Scratchpad ReadScratchpad();
 
-    // Gets the temperature in degrees Celsius
-    double ReadTemperature();
-};
\ No newline at end of file
+    // Only changes the scratchpad, the EEPROM copy (and so the power-on resolution) is left alone
+    bool SetResolution(Resolution_T resolution);
+
+    // Sets the TH/TL alarm registers in the scratchpad only. Copying them to EEPROM would also store the
+    // adaptive resolution, so they are programmed again at every boot and after re-enumeration instead.
+    bool SetAlarmThresholds(int8_t temp_alarm_l, int8_t temp_alarm_h);
+
+    // The alarm registers are compared against the integer part of the reading. Rounds down so the sensor
+    // flags a superset of the readings the CPU would alarm on.
+    static int8_t ToAlarmRegister(Temperature temperature);
+
+    // Starts a conversion on this sensor and returns straight away
+    bool StartConversion();
+
+    // Gets the temperature from the last conversion, without starting a new one. Invalid if the scratchpad can't be read.
+    Temperature ReadConvertedTemperature();
+
+    // Gets the temperature. Blocks the calling task for the conversion time.
+    Temperature ReadTemperature();
+
+    // Starts a conversion and calls on_done with the temperature from the scheduler's thread once the
+    // conversion time has elapsed. Returns false if the conversion could not be started.
+    bool ReadTemperatureAsync(ConversionScheduler& scheduler, std::function<void(Temperature)> on_done);
+
+    // Worst case conversion time from the datasheet
+    static std::chrono::microseconds GetConversionTime(Resolution_T resolution);
+
+    // Waits out the conversion time, then polls the bus until every device doing a conversion has finished.
+    // False if they are still busy after twice the conversion time.
+    static bool WaitForConversion(OneWireBus& bus, Resolution_T resolution);
+};
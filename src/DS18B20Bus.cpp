@@ -0,0 +1,213 @@
+#include "DS18B20Bus.hpp"
+
+#include <algorithm>
+
+#include "esp_log.h"
+#include "freertos/task.h"
+
+static const char* TAG = "DS18B20Bus";
+
+// Also search periodically so newly plugged sensors get picked up
+static constexpr unsigned int READS_PER_ENUMERATION = 60;
+
+DS18B20Bus::DS18B20Bus(gpio_num_t pin, OneWireBus::Backend_T backend_type) : _bus(std::make_shared<OneWireBus>(pin, backend_type))
+{
+    Enumerate();
+}
+
+DS18B20Bus::DS18B20Bus(const std::shared_ptr<OneWireBus>& bus) : _bus(bus)
+{
+    Enumerate();
+}
+
+bool DS18B20Bus::Enumerate() 
+{
+    std::vector<DS18B20::RomCode> found;
+    if (!_bus->Search(found)) {
+        ESP_LOGE(TAG, "Search ROM failed");
+        return false;
+    }
+
+    _sensors.clear();
+    for (const auto& rom_code : found) {
+        if (rom_code.family_code != DS18B20::FAMILY_CODE) {
+            ESP_LOGW(TAG, "Ignoring device with family code %x", rom_code.family_code);
+            continue;
+        }
+        _sensors.emplace_back(_bus, rom_code);
+        ApplyAlarmBand(_sensors.back());
+    }
+    ESP_LOGI(TAG, "Found %d DS18B20 sensors", _sensors.size());
+
+    // Keep searching until something shows up
+    _needs_enumeration = _sensors.empty();
+    _reads_since_enumeration = 0;
+    return true;
+}
+
+std::vector<DS18B20Bus::Reading> DS18B20Bus::GetInvalidReadings() 
+{
+    _needs_enumeration = true;
+    std::vector<Reading> readings;
+    readings.reserve(_sensors.size());
+    for (const auto& sensor : _sensors) {
+        readings.push_back({sensor.GetRomCode(), Temperature::Invalid()});
+    }
+    return readings;
+}
+
+DS18B20::Resolution_T DS18B20Bus::GetMaxResolution() const 
+{
+    auto resolution = DS18B20::Resolution_T::RES_9_BIT;
+    for (const auto& sensor : _sensors) {
+        resolution = std::max(resolution, sensor.GetResolution());
+    }
+    return resolution;
+}
+
+bool DS18B20Bus::SetResolution(DS18B20::Resolution_T resolution) 
+{
+    bool is_success = true;
+    for (auto& sensor : _sensors) {
+        if (!sensor.SetResolution(resolution)) {
+            _needs_enumeration = true;
+            is_success = false;
+        }
+    }
+    return is_success;
+}
+
+bool DS18B20Bus::ApplyAlarmBand(DS18B20& sensor) 
+{
+    if (!_alarm_bands) {
+        return true;
+    }
+    const auto band = _alarm_bands(sensor.GetRomCode());
+    return sensor.SetAlarmThresholds(DS18B20::ToAlarmRegister(band.first), DS18B20::ToAlarmRegister(band.second));
+}
+
+bool DS18B20Bus::SetAlarmThresholds(Temperature low_threshold, Temperature high_threshold) 
+{
+    return SetAlarmThresholds([low_threshold, high_threshold](const DS18B20::RomCode&) {
+        return std::make_pair(low_threshold, high_threshold);
+    });
+}
+
+bool DS18B20Bus::SetAlarmThresholds(AlarmBandSource alarm_bands) 
+{
+    _alarm_bands = std::move(alarm_bands);
+
+    bool is_success = true;
+    for (auto& sensor : _sensors) {
+        if (!ApplyAlarmBand(sensor)) {
+            _needs_enumeration = true;
+            is_success = false;
+        }
+    }
+    return is_success;
+}
+
+bool DS18B20Bus::StartConversionAll() 
+{
+    if (_needs_enumeration || ++_reads_since_enumeration >= READS_PER_ENUMERATION) {
+        Enumerate();
+    }
+
+    if (_sensors.empty()) {
+        return false;
+    }
+
+    auto lock = _bus->AcquireLock();
+    if (!_bus->SkipRom()) {
+        ESP_LOGE(TAG, "No presence pulse, cannot start conversion");
+        _needs_enumeration = true;
+        return false;
+    }
+    _bus->WriteByte(DS18B20::CONVERT_T);
+    return true;
+}
+
+std::vector<DS18B20Bus::Reading> DS18B20Bus::ReadConvertedAll() 
+{
+    std::vector<Reading> readings;
+    readings.reserve(_sensors.size());
+    for (auto& sensor : _sensors) {
+        const auto temp = sensor.ReadConvertedTemperature();
+        if (!temp.IsValid()) {
+            _needs_enumeration = true;
+        }
+        readings.push_back({sensor.GetRomCode(), temp});
+    }
+    return readings;
+}
+
+std::vector<DS18B20Bus::Reading> DS18B20Bus::ReadConvertedAlarming() 
+{
+    std::vector<DS18B20::RomCode> alarming;
+    if (!_bus->Search(alarming, OneWireBus::ALARM_SEARCH)) {
+        ESP_LOGW(TAG, "Alarm search failed, reading every sensor");
+        return ReadConvertedAll();
+    }
+
+    std::vector<Reading> readings;
+    readings.reserve(alarming.size());
+    for (auto& sensor : _sensors) {
+        if (std::find(alarming.begin(), alarming.end(), sensor.GetRomCode()) == alarming.end()) {
+            continue;
+        }
+        const auto temp = sensor.ReadConvertedTemperature();
+        if (!temp.IsValid()) {
+            _needs_enumeration = true;
+        }
+        readings.push_back({sensor.GetRomCode(), temp});
+    }
+    return readings;
+}
+
+std::vector<DS18B20Bus::Reading> DS18B20Bus::ReadAll() 
+{
+    if (!StartConversionAll()) {
+        return {};
+    }
+
+    if (!DS18B20::WaitForConversion(*_bus, GetMaxResolution())) {
+        return GetInvalidReadings();
+    }
+    return ReadConvertedAll();
+}
+
+void DS18B20Bus::ReadAllAsync(ConversionScheduler& scheduler, std::function<void(std::vector<Reading>)> on_done) 
+{
+    if (!StartConversionAll()) {
+        on_done({});
+        return;
+    }
+
+    scheduler.ScheduleAfter(DS18B20::GetConversionTime(GetMaxResolution()), [this, on_done = std::move(on_done)] {
+        on_done(ReadConvertedAll());
+    });
+}
+
+std::vector<DS18B20Bus::Reading> DS18B20Bus::ReadAlarming() 
+{
+    if (!StartConversionAll()) {
+        return {};
+    }
+
+    if (!DS18B20::WaitForConversion(*_bus, GetMaxResolution())) {
+        return GetInvalidReadings();
+    }
+    return ReadConvertedAlarming();
+}
+
+void DS18B20Bus::ReadAlarmingAsync(ConversionScheduler& scheduler, std::function<void(std::vector<Reading>)> on_done) 
+{
+    if (!StartConversionAll()) {
+        on_done({});
+        return;
+    }
+
+    scheduler.ScheduleAfter(DS18B20::GetConversionTime(GetMaxResolution()), [this, on_done = std::move(on_done)] {
+        on_done(ReadConvertedAlarming());
+    });
+}
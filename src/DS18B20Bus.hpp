@@ -0,0 +1,70 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "ConversionScheduler.hpp"
+#include "DS18B20.hpp"
+#include "OneWireBus.hpp"
+
+// All the DS18B20s sharing one 1-Wire bus. Devices are found with Search ROM and converted
+// together, so N sensors cost one conversion time instead of N.
+class DS18B20Bus {
+public:
+    struct Reading {
+        DS18B20::RomCode rom_code;
+        Temperature temperature;
+
+        [[nodiscard]] bool IsValid() const {return temperature.IsValid();}
+    };
+
+    // Low/high alarm thresholds for one sensor
+    using AlarmBandSource = std::function<std::pair<Temperature, Temperature>(const DS18B20::RomCode&)>;
+private:
+    std::shared_ptr<OneWireBus> _bus;
+    std::vector<DS18B20> _sensors;
+    bool _needs_enumeration = true;
+    unsigned int _reads_since_enumeration = 0;
+    AlarmBandSource _alarm_bands; // Empty until SetAlarmThresholds
+
+    bool Enumerate();
+    bool ApplyAlarmBand(DS18B20& sensor);
+    // Enumerates if needed and sends a broadcast Convert T. False if there is nothing to read.
+    bool StartConversionAll();
+    std::vector<Reading> ReadConvertedAll();
+    // Uses Alarm Search to only read the sensors whose TH/TL alarm flag is set
+    std::vector<Reading> ReadConvertedAlarming();
+    // What a read returns when the conversion never finished, the bus is searched again on the next one
+    std::vector<Reading> GetInvalidReadings();
+    // The slowest sensor decides how long a broadcast conversion takes
+    [[nodiscard]] DS18B20::Resolution_T GetMaxResolution() const;
+public:
+    explicit DS18B20Bus(gpio_num_t pin, OneWireBus::Backend_T backend_type = OneWireBus::Backend_T::RMT);
+    // Runs on a caller provided bus, e.g. one bit-banging a OneWireSimulator
+    explicit DS18B20Bus(const std::shared_ptr<OneWireBus>& bus);
+
+    [[nodiscard]] size_t GetSensorCount() const { return _sensors.size(); }
+
+    // Sets every sensor's resolution for the following conversions
+    bool SetResolution(DS18B20::Resolution_T resolution);
+
+    // Programs every sensor's TH/TL registers so out of range probes can be found with Alarm Search.
+    // Sensors found later get the same thresholds.
+    bool SetAlarmThresholds(Temperature low_threshold, Temperature high_threshold);
+    // Same, with thresholds of each sensor's own. Kept to program sensors found later.
+    bool SetAlarmThresholds(AlarmBandSource alarm_bands);
+
+    // Starts one conversion on every sensor, then reads each scratchpad. Sensors that stop
+    // answering get an invalid reading and trigger a new search on the next call.
+    std::vector<Reading> ReadAll();
+
+    // Same as ReadAll, but returns once the conversion is started and calls on_done from the
+    // scheduler's thread. on_done is called with no readings if the conversion could not be started.
+    void ReadAllAsync(ConversionScheduler& scheduler, std::function<void(std::vector<Reading>)> on_done);
+
+    // Same as ReadAll/ReadAllAsync, but only returns readings for sensors whose alarm flag is set after the conversion.
+    // With many probes this skips most of the scratchpad reads.
+    std::vector<Reading> ReadAlarming();
+    void ReadAlarmingAsync(ConversionScheduler& scheduler, std::function<void(std::vector<Reading>)> on_done);
+};
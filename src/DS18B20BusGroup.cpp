@@ -0,0 +1,119 @@
+#include "DS18B20BusGroup.hpp"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "DS18B20BusGroup";
+
+DS18B20BusGroup::DS18B20BusGroup(const std::vector<gpio_num_t>& pins, OneWireBus::Backend_T backend_type)
+{
+    _buses.reserve(pins.size());
+    for (auto pin : pins) {
+        // Peripherals run out after a few buses, OneWireBus falls back to bit-banging on its own
+        _buses.push_back(std::make_shared<DS18B20Bus>(pin, backend_type));
+    }
+    ESP_LOGI(TAG, "%d buses, %d sensors", static_cast<int>(_buses.size()), static_cast<int>(GetSensorCount()));
+}
+
+size_t DS18B20BusGroup::GetSensorCount() const
+{
+    size_t count = 0;
+    for (const auto& bus : _buses) {
+        count += bus->GetSensorCount();
+    }
+    return count;
+}
+
+bool DS18B20BusGroup::SetResolution(DS18B20::Resolution_T resolution)
+{
+    bool is_success = true;
+    for (auto& bus : _buses) {
+        is_success = bus->SetResolution(resolution) && is_success;
+    }
+    return is_success;
+}
+
+bool DS18B20BusGroup::SetAlarmThresholds(const DS18B20Bus::AlarmBandSource& alarm_bands)
+{
+    bool is_success = true;
+    for (auto& bus : _buses) {
+        is_success = bus->SetAlarmThresholds(alarm_bands) && is_success;
+    }
+    return is_success;
+}
+
+void DS18B20BusGroup::SelectPrimary(Sample& sample)
+{
+    const auto& readings = sample.readings;
+    for (size_t i = 0; i < readings.size(); i++) {
+        if (_primary_rom.IsValid() && readings[i].rom_code == _primary_rom) {
+            sample.primary_index = static_cast<int>(i);
+            return;
+        }
+    }
+    // A partial read leaves out sensors that are still there
+    if (sample.is_partial) {
+        return;
+    }
+
+    for (size_t i = 0; i < readings.size(); i++) {
+        if (readings[i].IsValid()) {
+            _primary_rom = readings[i].rom_code;
+            sample.primary_index = static_cast<int>(i);
+            ESP_LOGI(TAG, "Primary sensor is now %02x%02x%02x%02x%02x%02x", _primary_rom.bytes[5], _primary_rom.bytes[4],
+                     _primary_rom.bytes[3], _primary_rom.bytes[2], _primary_rom.bytes[1], _primary_rom.bytes[0]);
+            return;
+        }
+    }
+}
+
+void DS18B20BusGroup::ReadEachAsync(BusRead read, bool is_partial, ConversionScheduler& scheduler, SampleCallback on_done)
+{
+    struct PendingSample {
+        Sample sample;
+        std::vector<std::vector<DS18B20Bus::Reading>> bus_readings; // Merged in bus order, not completion order
+        size_t pending_buses;
+        SampleCallback on_done;
+    };
+
+    auto pending = std::make_shared<PendingSample>();
+    pending->sample.timestamp_us = esp_timer_get_time();
+    pending->sample.is_partial = is_partial;
+    pending->bus_readings.resize(_buses.size());
+    pending->pending_buses = _buses.size();
+    pending->on_done = std::move(on_done);
+
+    if (_buses.empty()) {
+        pending->on_done(std::move(pending->sample));
+        return;
+    }
+
+    // Every bus starts its conversion here and reads it back from a scheduler job. All of it
+    // runs on the scheduler thread, so the counter needs no lock. A bus that fails to start
+    // completes right away.
+    for (size_t i = 0; i < _buses.size(); i++) {
+        ((*_buses[i]).*read)(scheduler, [this, pending, i](std::vector<DS18B20Bus::Reading> readings) {
+            pending->bus_readings[i] = std::move(readings);
+            if (--pending->pending_buses > 0) {
+                return;
+            }
+
+            auto& merged = pending->sample.readings;
+            for (auto& bus_readings : pending->bus_readings) {
+                merged.insert(merged.end(), bus_readings.begin(), bus_readings.end());
+            }
+            SelectPrimary(pending->sample);
+            pending->on_done(std::move(pending->sample));
+        });
+    }
+}
+
+void DS18B20BusGroup::ReadAllAsync(ConversionScheduler& scheduler, SampleCallback on_done)
+{
+    ReadEachAsync(&DS18B20Bus::ReadAllAsync, false, scheduler, std::move(on_done));
+}
+
+void DS18B20BusGroup::ReadAlarmingAsync(ConversionScheduler& scheduler, SampleCallback on_done)
+{
+    ReadEachAsync(&DS18B20Bus::ReadAlarmingAsync, true, scheduler, std::move(on_done));
+}
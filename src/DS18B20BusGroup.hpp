@@ -0,0 +1,54 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "ConversionScheduler.hpp"
+#include "DS18B20Bus.hpp"
+
+// Several independent DS18B20 buses, one per GPIO, read as one. Conversions are started on
+// every bus back to back and their waits overlap, so adding a bus costs its scratchpad reads
+// rather than another conversion time.
+class DS18B20BusGroup {
+public:
+    // Readings from every bus, stamped with the time the conversions were started
+    struct Sample {
+        int64_t timestamp_us;
+        std::vector<DS18B20Bus::Reading> readings;
+        // From an Alarm Search: only the sensors whose alarm flag was set were read
+        bool is_partial = false;
+        // Into readings, -1 if the primary sensor isn't among them
+        int primary_index = -1;
+
+        // The primary sensor's reading, may be invalid. Null if it wasn't read.
+        [[nodiscard]] const DS18B20Bus::Reading* GetPrimary() const {
+            return primary_index >= 0 ? &readings[primary_index] : nullptr;
+        }
+    };
+
+    using SampleCallback = std::function<void(Sample)>;
+private:
+    std::vector<std::shared_ptr<DS18B20Bus>> _buses;
+    // The sensor the UI shows: the first one with a valid reading, kept for as long as it stays on the bus
+    // so a glitch never swaps in another probe. Only touched from the scheduler's thread.
+    DS18B20::RomCode _primary_rom;
+
+    void SelectPrimary(Sample& sample);
+
+    using BusRead = void (DS18B20Bus::*)(ConversionScheduler&, std::function<void(std::vector<DS18B20Bus::Reading>)>);
+    void ReadEachAsync(BusRead read, bool is_partial, ConversionScheduler& scheduler, SampleCallback on_done);
+public:
+    explicit DS18B20BusGroup(const std::vector<gpio_num_t>& pins, OneWireBus::Backend_T backend_type = OneWireBus::Backend_T::RMT);
+
+    [[nodiscard]] size_t GetBusCount() const { return _buses.size(); }
+    [[nodiscard]] size_t GetSensorCount() const;
+
+    bool SetResolution(DS18B20::Resolution_T resolution);
+    bool SetAlarmThresholds(const DS18B20Bus::AlarmBandSource& alarm_bands);
+
+    // Same as DS18B20Bus::ReadAllAsync/ReadAlarmingAsync across every bus. on_done is called once,
+    // from the scheduler's thread, when the slowest bus is done. Don't start another read before then.
+    void ReadAllAsync(ConversionScheduler& scheduler, SampleCallback on_done);
+    void ReadAlarmingAsync(ConversionScheduler& scheduler, SampleCallback on_done);
+};
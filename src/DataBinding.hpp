@@ -1,16 +1,50 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <mutex>
 #include <type_traits>
+#include <vector>
 #include <stdio.h>
 
+#include "CriticalSection.hpp"
+
 template <typename T>
 class DataBinding {
+public:
+    // Called with the new value on the thread that set it, so keep it short (e.g. EventDispatcher::Defer)
+    using Subscriber = std::function<void(const T&)>;
+private:
+    std::vector<Subscriber> _subscribers;
+    std::mutex _subscribers_lock;
+    std::atomic<uint32_t> _version{0};
+protected:
+    // Implementations call this at the end of SetValue, outside of their own lock
+    void Notify(const T& value) {
+        // Bumped after the value is stored, so whoever reads this version gets at least this value
+        _version.fetch_add(1, std::memory_order_release);
+        std::lock_guard<decltype(_subscribers_lock)> lock(_subscribers_lock);
+        for (const auto& subscriber : _subscribers) {
+            subscriber(value);
+        }
+    }
 public:
     virtual void SetValue(T value) = 0;
 
     [[nodiscard]] virtual T GetValue() const = 0;
 
+    // Goes up with every SetValue, e.g. to tell whether something derived from the value is stale.
+    // Read it before GetValue: the value is then at least as new as the version.
+    [[nodiscard]] uint32_t GetVersion() const { return _version.load(std::memory_order_acquire); }
+
+    void Subscribe(Subscriber subscriber) {
+        std::lock_guard<decltype(_subscribers_lock)> lock(_subscribers_lock);
+        _subscribers.push_back(std::move(subscriber));
+    }
+
     virtual ~DataBinding() = default;
 };
 
@@ -23,8 +57,11 @@ public:
     explicit DataSourceSingleValue(T initial_value): _current_value(initial_value) {}
 
     void SetValue(T value) override {
-        std::lock_guard<decltype(_critical_section)> lock(_critical_section);
-        _current_value = value;
+        {
+            std::lock_guard<decltype(_critical_section)> lock(_critical_section);
+            _current_value = value;
+        }
+        this->Notify(value);
     }
 
     [[nodiscard]] T GetValue() const override {
@@ -33,4 +70,68 @@ public:
     }
 
     ~DataSourceSingleValue() override = default;
+};
+
+// Sequence lock for small plain values (temperatures, pairs of them). Readers never block or take a
+// lock: they copy the value and retry if a write happened meanwhile. Writes are serialized and
+// run with interrupts off, so a reader never spins on a writer that got preempted halfway.
+template <typename T>
+class DataSourceSeqLock : public DataBinding<T> {
+    static_assert(std::is_trivially_copy_constructible<T>::value && std::is_trivially_destructible<T>::value,
+                  "Value is copied bytewise");
+
+    using Word = uint32_t;
+    static constexpr size_t WORD_COUNT = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+    std::atomic<uint32_t> _sequence; // Odd while a write is in progress
+    std::array<std::atomic<Word>, WORD_COUNT> _words;
+    std::mutex _writer_lock;
+    CriticalSection _critical_section;
+
+    void StoreWords(const T& value) {
+        std::array<Word, WORD_COUNT> words = {};
+        memcpy(words.data(), &value, sizeof(T));
+        for (size_t i = 0; i < WORD_COUNT; i++) {
+            _words[i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+public:
+    explicit DataSourceSeqLock(T initial_value): _sequence(0) {
+        StoreWords(initial_value);
+    }
+
+    void SetValue(T value) override {
+        {
+            std::lock_guard<decltype(_writer_lock)> writer_lock(_writer_lock);
+            auto lock = _critical_section.Acquire();
+
+            const uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+            _sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            StoreWords(value);
+            _sequence.store(sequence + 2, std::memory_order_release);
+        }
+        this->Notify(value);
+    }
+
+    [[nodiscard]] T GetValue() const override {
+        std::array<Word, WORD_COUNT> words;
+        uint32_t sequence_before;
+        uint32_t sequence_after;
+        do {
+            sequence_before = _sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORD_COUNT; i++) {
+                words[i] = _words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            sequence_after = _sequence.load(std::memory_order_relaxed);
+        } while ((sequence_before & 1) || sequence_before != sequence_after);
+
+        alignas(T) unsigned char storage[sizeof(T)];
+        memcpy(storage, words.data(), sizeof(T));
+        return *reinterpret_cast<const T*>(storage);
+    }
+
+    ~DataSourceSeqLock() override = default;
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "EventDispatcher.hpp"
+
+#include "esp_log.h"
+
+static const char* TAG = "EventDispatcher";
+
+EventDispatcher::EventDispatcher() : _is_running(true)
+{
+    _worker = std::thread([this] {
+        this->TaskWorker();
+    });
+}
+
+EventDispatcher::~EventDispatcher()
+{
+    {
+        std::lock_guard<decltype(_events_lock)> lock(_events_lock);
+        _is_running = false;
+    }
+    _events_cv.notify_all();
+    _worker.join();
+}
+
+bool EventDispatcher::Post(Event event)
+{
+    {
+        std::lock_guard<decltype(_events_lock)> lock(_events_lock);
+        if (_size == CAPACITY) {
+            ESP_LOGW(TAG, "Event queue full, dropping event");
+            return false;
+        }
+        _events[(_head + _size) % CAPACITY] = std::move(event);
+        ++_size;
+    }
+    _events_cv.notify_one();
+    return true;
+}
+
+void EventDispatcher::TaskWorker()
+{
+    while (true) {
+        Event event;
+        {
+            std::unique_lock<decltype(_events_lock)> lock(_events_lock);
+            _events_cv.wait(lock, [this] {
+                return _size > 0 || !_is_running;
+            });
+            if (!_is_running) {
+                return;
+            }
+
+            event = std::move(_events[_head]);
+            _events[_head] = nullptr;
+            _head = (_head + 1) % CAPACITY;
+            --_size;
+        }
+
+        event();
+    }
+}
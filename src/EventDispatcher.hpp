@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "DataBinding.hpp"
+
+// Runs change notifications on one thread, in the order they were posted, so consumers (alarm,
+// web push, ...) react as soon as a value changes without the producer waiting on them.
+// The queue has a fixed capacity; when consumers fall that far behind new events are dropped.
+class EventDispatcher {
+public:
+    using Event = std::function<void()>;
+    static constexpr size_t CAPACITY = 16;
+private:
+    bool _is_running;
+    std::array<Event, CAPACITY> _events; // Ring buffer
+    size_t _head = 0;
+    size_t _size = 0;
+    std::mutex _events_lock;
+    std::condition_variable _events_cv;
+    std::thread _worker;
+
+    void TaskWorker();
+public:
+    EventDispatcher();
+    ~EventDispatcher();
+
+    // False if the queue is full
+    bool Post(Event event);
+
+    // Subscriber for a DataBinding that hands the new value to handler on the dispatcher thread
+    template <typename T>
+    typename DataBinding<T>::Subscriber Defer(std::function<void(const T&)> handler) {
+        return [this, handler = std::move(handler)](const T& value) {
+            Post([handler, value] {
+                handler(value);
+            });
+        };
+    }
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// A NOR flash region: erasing a sector sets it to 0xFF, writes can only clear bits. Implemented by
+// a flash partition on the device and by a file backed image on a build machine.
+class FlashStorage {
+public:
+    static constexpr size_t SECTOR_SIZE = 4096;
+
+    [[nodiscard]] virtual bool IsValid() const = 0;
+    [[nodiscard]] virtual size_t GetSize() const = 0;
+
+    virtual bool Read(size_t offset, void* data, size_t size) = 0;
+    virtual bool Write(size_t offset, const void* data, size_t size) = 0;
+    // offset must be sector aligned
+    virtual bool EraseSector(size_t offset) = 0;
+
+    virtual ~FlashStorage() = default;
+};
@@ -0,0 +1,135 @@
+#include "HistoryExport.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "SampleCodec.hpp"
+
+HistoryExport::HistoryExport(SampleLog& log, Format_T format, Sink sink, void* context) : _log(log), _format(format),
+                                                                                          _sink(sink), _context(context)
+{
+
+}
+
+bool HistoryExport::ParseFormat(std::string_view name, Format_T& format)
+{
+    if (name == "csv") {
+        format = Format_T::CSV;
+    } else if (name == "ndjson") {
+        format = Format_T::NDJSON;
+    } else if (name == "binary") {
+        format = Format_T::BINARY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* HistoryExport::GetContentType(Format_T format)
+{
+    switch (format) {
+        case Format_T::CSV:
+            return "text/csv";
+        case Format_T::NDJSON:
+            return "application/x-ndjson";
+        default:
+            return "application/octet-stream";
+    }
+}
+
+char* HistoryExport::Reserve(size_t size)
+{
+    if (_length + size > sizeof(_buffer)) {
+        Flush();
+    }
+    return _buffer + _length;
+}
+
+void HistoryExport::Append(const void* data, size_t size)
+{
+    memcpy(Reserve(size), data, size);
+    Commit(size);
+}
+
+void HistoryExport::AppendLittleEndian(uint64_t value, size_t size)
+{
+    char* out = Reserve(size);
+    for (size_t i = 0; i < size; i++) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+    Commit(size);
+}
+
+void HistoryExport::AppendRow(const SampleLog::Entry& entry, int64_t time_offset_s)
+{
+    char temperature[Temperature::MAX_FORMATTED_SIZE];
+    const int temperature_length = static_cast<int>(entry.temperature.Format(temperature, sizeof(temperature)));
+    const long long time_s = static_cast<long long>(entry.log_time_s) - time_offset_s;
+    char* row = Reserve(MAX_ROW_SIZE);
+    const size_t available = sizeof(_buffer) - _length;
+    const int length = _format == Format_T::CSV ?
+        snprintf(row, available, "%u,%lld,%.*s\n", static_cast<unsigned>(entry.log_time_s), time_s,
+                 temperature_length, temperature) :
+        snprintf(row, available, "{\"seq\":%u,\"time\":%lld,\"temperature\":%.*s}\n",
+                 static_cast<unsigned>(entry.log_time_s), time_s, temperature_length, temperature);
+    Commit(length);
+}
+
+bool HistoryExport::Flush()
+{
+    if (!_is_failed && _length > 0) {
+        _is_failed = !_sink(_context, _buffer, _length);
+        _length = 0;
+    }
+    return !_is_failed;
+}
+
+bool HistoryExport::Write(int64_t first_log_time_s, int64_t last_log_time_s, int64_t time_offset_s)
+{
+    SampleEncoder encoder;
+    if (_format == Format_T::BINARY) {
+        // Magic, version, 3 reserved bytes, then the time offset
+        const uint8_t header[8] = {'Y', 'S', 'L', 'B', BINARY_VERSION, 0, 0, 0};
+        Append(header, sizeof(header));
+        AppendLittleEndian(static_cast<uint64_t>(time_offset_s), sizeof(int64_t));
+    } else if (_format == Format_T::CSV) {
+        static const char CSV_HEADER[] = "seq,time,temperature\n";
+        Append(CSV_HEADER, sizeof(CSV_HEADER) - 1);
+    }
+
+    // Each block is sent as its sample and bit count followed by the bytes the bits take up
+    const auto append_block = [this](const SampleBlock& block) {
+        AppendLittleEndian(block.sample_count, sizeof(block.sample_count));
+        AppendLittleEndian(block.bit_count, sizeof(block.bit_count));
+        Append(block.data.data(), (block.bit_count + 7) / 8);
+    };
+
+    SampleLog::Entry entries[BATCH_SIZE];
+    auto cursor = _log.Seek(static_cast<uint32_t>(std::clamp(first_log_time_s, int64_t(0), int64_t(UINT32_MAX))));
+    bool is_done = first_log_time_s > last_log_time_s;
+    while (!is_done && !_is_failed) {
+        const size_t count = _log.Read(cursor, entries, BATCH_SIZE);
+        is_done = count == 0;
+        for (size_t i = 0; i < count && !is_done; i++) {
+            const auto& entry = entries[i];
+            if (entry.log_time_s > last_log_time_s) {
+                is_done = true;
+                break;
+            }
+            if (_format != Format_T::BINARY) {
+                AppendRow(entry, time_offset_s);
+                continue;
+            }
+            if (!encoder.Append(entry.log_time_s, entry.temperature.GetSixteenths())) {
+                append_block(encoder.GetBlock());
+                encoder.Reset();
+                encoder.Append(entry.log_time_s, entry.temperature.GetSixteenths());
+            }
+        }
+    }
+    if (!encoder.IsEmpty()) {
+        append_block(encoder.GetBlock());
+    }
+    return Flush();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "SampleLog.hpp"
+
+// Streams a range of the SampleLog out as CSV, NDJSON or SampleCodec blocks. Records are read a
+// batch at a time and the output is collected in a fixed size chunk that is handed to the Sink
+// (e.g. httpd_resp_send_chunk) when the next row might not fit, so a log of any length goes out
+// through the same few hundred bytes of stack.
+//
+// The binary format is little endian whatever the host: "YSLB", a version byte, 3 reserved bytes
+// and the int64 time offset, then blocks of a uint16 sample count, a uint16 bit count and the
+// bytes those bits take up. Timestamps in the blocks are log times.
+class HistoryExport {
+public:
+    enum class Format_T {
+        CSV,
+        NDJSON,
+        BINARY
+    };
+
+    // Takes size bytes of data, false on errors
+    using Sink = bool (*)(void* context, const char* data, size_t size);
+
+    static constexpr size_t CHUNK_SIZE = 512;
+    static constexpr size_t BATCH_SIZE = 16;
+    static constexpr size_t MAX_ROW_SIZE = 80;
+    static constexpr uint8_t BINARY_VERSION = 1;
+private:
+    SampleLog& _log;
+    Format_T _format;
+    Sink _sink;
+    void* _context;
+    char _buffer[CHUNK_SIZE];
+    size_t _length = 0;
+    bool _is_failed = false;
+
+    // Room for at least size more bytes, sending what is buffered if needed
+    char* Reserve(size_t size);
+    void Commit(size_t size) { _length += size; }
+    void Append(const void* data, size_t size);
+    // The low size bytes of value, least significant first
+    void AppendLittleEndian(uint64_t value, size_t size);
+    void AppendRow(const SampleLog::Entry& entry, int64_t time_offset_s);
+    bool Flush();
+public:
+    HistoryExport(SampleLog& log, Format_T format, Sink sink, void* context);
+
+    HistoryExport(const HistoryExport&) = delete;
+    HistoryExport& operator=(const HistoryExport&) = delete;
+
+    // "csv", "ndjson" or "binary"
+    static bool ParseFormat(std::string_view name, Format_T& format);
+    static const char* GetContentType(Format_T format);
+
+    // Sends every record with a log time from first to last, inclusive. time_offset_s is the log's
+    // GetTimeOffsetS(), taken by the caller along with the range. False once the sink fails.
+    bool Write(int64_t first_log_time_s, int64_t last_log_time_s, int64_t time_offset_s);
+};
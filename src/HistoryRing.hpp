@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Fixed size ring of the last N entries with one writer and any number of readers, none of which
+// ever block. Entries are numbered from 0 in push order; readers copy a range and then drop the
+// entries the writer may have overwritten while they were copying. Like DataSourceSeqLock, entries
+// are kept as relaxed atomic words so that copying one the writer is replacing isn't a data race.
+template <typename T, size_t N>
+class HistoryRing {
+    static_assert(std::is_trivially_copyable<T>::value, "Entries are copied while the writer may be running");
+    static_assert(N > 0, "Empty ring");
+
+    using Word = uint32_t;
+    static constexpr size_t WORD_COUNT = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+    std::array<std::array<std::atomic<Word>, WORD_COUNT>, N> _entries;
+    std::atomic<uint32_t> _count{0}; // Entries ever pushed, the newest is _count - 1
+
+    void StoreEntry(size_t slot, const T& entry) {
+        std::array<Word, WORD_COUNT> words = {};
+        memcpy(words.data(), &entry, sizeof(T));
+        for (size_t i = 0; i < WORD_COUNT; i++) {
+            _entries[slot][i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+    void LoadEntry(size_t slot, T& entry) const {
+        std::array<Word, WORD_COUNT> words;
+        for (size_t i = 0; i < WORD_COUNT; i++) {
+            words[i] = _entries[slot][i].load(std::memory_order_relaxed);
+        }
+        memcpy(&entry, words.data(), sizeof(T));
+    }
+public:
+    static constexpr size_t CAPACITY = N;
+
+    // Writer thread only
+    void Push(const T& entry) {
+        const uint32_t count = _count.load(std::memory_order_relaxed);
+        // A reader that sees any of the new words must also see count, so it knows the slot is going
+        std::atomic_thread_fence(std::memory_order_release);
+        StoreEntry(count % N, entry);
+        _count.store(count + 1, std::memory_order_release);
+    }
+
+    [[nodiscard]] uint32_t GetCount() const { return _count.load(std::memory_order_acquire); }
+
+    // Copies up to max_entries of the newest entries to out, oldest first, and returns the number of the first one
+    uint32_t Snapshot(std::vector<T>& out, size_t max_entries = N) const {
+        const uint32_t end = _count.load(std::memory_order_acquire);
+        uint32_t begin = end - static_cast<uint32_t>(std::min<size_t>({end, N, max_entries}));
+
+        out.resize(end - begin);
+        for (uint32_t i = begin; i < end; i++) {
+            LoadEntry(i % N, out[i - begin]);
+        }
+
+        // The writer may be halfway through replacing entry end_after - N, anything older than that is gone too
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint32_t end_after = _count.load(std::memory_order_relaxed);
+        const uint32_t first_intact = end_after + 1 > N ? end_after + 1 - N : 0;
+        if (first_intact > begin) {
+            const uint32_t torn = std::min(first_intact, end) - begin;
+            out.erase(out.begin(), out.begin() + torn);
+            begin += torn;
+        }
+        return begin;
+    }
+};
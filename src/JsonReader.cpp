@@ -0,0 +1,406 @@
+#include "JsonReader.hpp"
+
+#include <cstring>
+
+JsonReader::JsonReader(char* buffer, size_t size, Source source, void* context) : _buffer(buffer), _capacity(size),
+                                                                                    _source(source), _context(context),
+                                                                                    _end(0), _is_input_done(false)
+{
+
+}
+
+JsonReader::JsonReader(char* text, size_t length) : _buffer(text), _capacity(length), _source(nullptr), _context(nullptr),
+                                                    _end(length), _is_input_done(true)
+{
+
+}
+
+bool JsonReader::Refill()
+{
+    if (_is_input_done) {
+        return false;
+    }
+    // Keep the token being read, it has to stay contiguous
+    if (_start > 0) {
+        memmove(_buffer, _buffer + _start, _end - _start);
+        _end -= _start;
+        _start = 0;
+    }
+    if (_end == _capacity) {
+        // Token longer than the buffer
+        _is_input_done = true;
+        return false;
+    }
+
+    const int read = _source(_context, _buffer + _end, _capacity - _end);
+    if (read <= 0) {
+        _is_input_done = true;
+        return false;
+    }
+    _end += read;
+    return true;
+}
+
+int JsonReader::Peek(size_t offset)
+{
+    while (_start + offset >= _end) {
+        if (!Refill()) {
+            return -1;
+        }
+    }
+    return static_cast<unsigned char>(_buffer[_start + offset]);
+}
+
+void JsonReader::SkipWhitespace()
+{
+    while (true) {
+        const int c = Peek(0);
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            return;
+        }
+        ++_start;
+    }
+}
+
+JsonReader::Token_T JsonReader::Fail()
+{
+    _is_failed = true;
+    _text = nullptr;
+    _text_length = 0;
+    return Token_T::ERROR;
+}
+
+JsonReader::Expect_T JsonReader::GetExpectAfterValue() const
+{
+    return _depth == 0 ? Expect_T::DONE : Expect_T::COMMA_OR_END;
+}
+
+JsonReader::Token_T JsonReader::Next()
+{
+    if (_is_failed) {
+        return Token_T::ERROR;
+    }
+    _text = nullptr;
+    _text_length = 0;
+
+    SkipWhitespace();
+    int c = Peek(0);
+    if (c < 0) {
+        return _expect == Expect_T::DONE ? Token_T::END : Fail();
+    }
+
+    switch (_expect) {
+        case Expect_T::DONE:
+            // Trailing characters
+            return Fail();
+        case Expect_T::COMMA_OR_END:
+            if (c == (IsInArray() ? ']' : '}')) {
+                return Close(IsInArray());
+            }
+            if (c != ',') {
+                return Fail();
+            }
+            ++_start;
+            SkipWhitespace();
+            c = Peek(0);
+            _expect = IsInArray() ? Expect_T::VALUE : Expect_T::KEY;
+            break;
+        case Expect_T::FIRST_VALUE:
+            if (c == ']') {
+                return Close(true);
+            }
+            _expect = Expect_T::VALUE;
+            break;
+        case Expect_T::FIRST_KEY:
+            if (c == '}') {
+                return Close(false);
+            }
+            _expect = Expect_T::KEY;
+            break;
+        default:
+            break;
+    }
+
+    if (_expect == Expect_T::KEY) {
+        size_t read = 0;
+        size_t written = 0;
+        if (c != '"' || !ReadString(read, written)) {
+            return Fail();
+        }
+        // _start stays on the key until the colon is found, so a refill can't drop its text
+        while (Peek(read) == ' ' || Peek(read) == '\t' || Peek(read) == '\n' || Peek(read) == '\r') {
+            ++read;
+        }
+        if (Peek(read) != ':') {
+            return Fail();
+        }
+        _text = _buffer + _start + 1;
+        _text_length = written - 1;
+        _start += read + 1;
+        _expect = Expect_T::VALUE;
+        return Token_T::KEY;
+    }
+    return ReadValue(c);
+}
+
+JsonReader::Token_T JsonReader::ReadValue(int c)
+{
+    switch (c) {
+        case '{':
+            return Open(false);
+        case '[':
+            return Open(true);
+        case '"': {
+            size_t read = 0;
+            size_t written = 0;
+            if (!ReadString(read, written)) {
+                return Fail();
+            }
+            _text = _buffer + _start + 1;
+            _text_length = written - 1;
+            _start += read;
+            _expect = GetExpectAfterValue();
+            return Token_T::STRING;
+        }
+        case 't':
+            return ReadLiteral("true", Token_T::TRUE);
+        case 'f':
+            return ReadLiteral("false", Token_T::FALSE);
+        case 'n':
+            return ReadLiteral("null", Token_T::NULL_VALUE);
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                return ReadNumber();
+            }
+            return Fail();
+    }
+}
+
+JsonReader::Token_T JsonReader::Open(bool is_array)
+{
+    if (_depth == MAX_DEPTH) {
+        return Fail();
+    }
+    if (is_array) {
+        _array_bits |= (1u << _depth);
+    } else {
+        _array_bits &= ~(1u << _depth);
+    }
+    ++_depth;
+    ++_start;
+    _expect = is_array ? Expect_T::FIRST_VALUE : Expect_T::FIRST_KEY;
+    return is_array ? Token_T::BEGIN_ARRAY : Token_T::BEGIN_OBJECT;
+}
+
+JsonReader::Token_T JsonReader::Close(bool is_array)
+{
+    --_depth;
+    ++_start;
+    _expect = GetExpectAfterValue();
+    return is_array ? Token_T::END_ARRAY : Token_T::END_OBJECT;
+}
+
+static int GetHexValue(int c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool JsonReader::ReadString(size_t& read, size_t& written)
+{
+    // Offsets are relative to _start, a refill moves the buffer contents but not _start's token
+    read = 1;
+    written = 1;
+    const auto read_hex4 = [this, &read]() -> int32_t {
+        int32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            const int digit = GetHexValue(Peek(read++));
+            if (digit < 0) {
+                return -1;
+            }
+            value = (value << 4) | digit;
+        }
+        return value;
+    };
+
+    while (true) {
+        const int c = Peek(read++);
+        if (c < 0x20) {
+            // End of input or an unescaped control character
+            return false;
+        }
+        if (c == '"') {
+            break;
+        }
+        if (c != '\\') {
+            _buffer[_start + written++] = static_cast<char>(c);
+            continue;
+        }
+
+        const int escaped = Peek(read++);
+        switch (escaped) {
+            case '"': case '\\': case '/':
+                _buffer[_start + written++] = static_cast<char>(escaped);
+                break;
+            case 'b': _buffer[_start + written++] = '\b'; break;
+            case 'f': _buffer[_start + written++] = '\f'; break;
+            case 'n': _buffer[_start + written++] = '\n'; break;
+            case 'r': _buffer[_start + written++] = '\r'; break;
+            case 't': _buffer[_start + written++] = '\t'; break;
+            case 'u': {
+                int32_t code_point = read_hex4();
+                if (code_point < 0) {
+                    return false;
+                }
+                // A surrogate pair takes 12 characters for 4 bytes of UTF-8, a lone one is kept as is
+                if (code_point >= 0xD800 && code_point < 0xDC00 && Peek(read) == '\\' && Peek(read + 1) == 'u') {
+                    const size_t pair_start = read;
+                    read += 2;
+                    const int32_t low = read_hex4();
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                    } else {
+                        read = pair_start;
+                    }
+                }
+                // UTF-8 is never longer than the escape, so writing in place is safe
+                char* out = _buffer + _start + written;
+                if (code_point < 0x80) {
+                    out[0] = static_cast<char>(code_point);
+                    written += 1;
+                } else if (code_point < 0x800) {
+                    out[0] = static_cast<char>(0xC0 | (code_point >> 6));
+                    out[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+                    written += 2;
+                } else if (code_point < 0x10000) {
+                    out[0] = static_cast<char>(0xE0 | (code_point >> 12));
+                    out[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+                    out[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+                    written += 3;
+                } else {
+                    out[0] = static_cast<char>(0xF0 | (code_point >> 18));
+                    out[1] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+                    out[2] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+                    out[3] = static_cast<char>(0x80 | (code_point & 0x3F));
+                    written += 4;
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+JsonReader::Token_T JsonReader::ReadNumber()
+{
+    size_t length = 0;
+    const auto is_digit = [](int c) { return c >= '0' && c <= '9'; };
+
+    if (Peek(length) == '-') {
+        ++length;
+    }
+    // No leading zeros
+    if (Peek(length) == '0') {
+        ++length;
+    } else if (is_digit(Peek(length))) {
+        while (is_digit(Peek(length))) {
+            ++length;
+        }
+    } else {
+        return Fail();
+    }
+    if (Peek(length) == '.') {
+        ++length;
+        if (!is_digit(Peek(length))) {
+            return Fail();
+        }
+        while (is_digit(Peek(length))) {
+            ++length;
+        }
+    }
+    if (Peek(length) == 'e' || Peek(length) == 'E') {
+        ++length;
+        if (Peek(length) == '+' || Peek(length) == '-') {
+            ++length;
+        }
+        if (!is_digit(Peek(length))) {
+            return Fail();
+        }
+        while (is_digit(Peek(length))) {
+            ++length;
+        }
+    }
+
+    // Peek may have moved the buffer, take the text once the whole number is in
+    _text = _buffer + _start;
+    _text_length = length;
+    _start += length;
+    _expect = GetExpectAfterValue();
+    return Token_T::NUMBER;
+}
+
+JsonReader::Token_T JsonReader::ReadLiteral(const char* literal, Token_T token)
+{
+    const size_t length = strlen(literal);
+    for (size_t i = 0; i < length; i++) {
+        if (Peek(i) != literal[i]) {
+            return Fail();
+        }
+    }
+    _start += length;
+    _expect = GetExpectAfterValue();
+    return token;
+}
+
+bool JsonReader::Skip(Token_T token)
+{
+    if (token != Token_T::BEGIN_OBJECT && token != Token_T::BEGIN_ARRAY) {
+        return token != Token_T::ERROR;
+    }
+    const int depth = _depth;
+    while (_depth >= depth) {
+        const Token_T next = Next();
+        if (next == Token_T::ERROR || next == Token_T::END) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool JsonReader::ParseInteger(std::string_view text, int64_t& out)
+{
+    if (text.empty()) {
+        return false;
+    }
+    size_t i = 0;
+    const bool is_negative = text[0] == '-';
+    if (is_negative) {
+        ++i;
+    }
+    if (i == text.size()) {
+        return false;
+    }
+    uint64_t magnitude = 0;
+    for (; i < text.size(); i++) {
+        const char c = text[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        if (magnitude > (static_cast<uint64_t>(INT64_MAX) - (c - '0')) / 10) {
+            return false;
+        }
+        magnitude = magnitude * 10 + (c - '0');
+    }
+    out = is_negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+    return true;
+}
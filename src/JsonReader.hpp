@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Pull tokenizer for JSON, working in place in a caller supplied buffer. Input is read from a
+// Source in chunks (e.g. httpd_req_recv) as tokens need it, so a body never has to fit in memory
+// at once, only its longest token. Strings are unescaped in place and token text points into
+// the buffer, nothing is copied or allocated.
+//
+// The grammar is checked as tokens are pulled: a malformed document yields ERROR at the point it
+// goes wrong, and END only comes after one complete value.
+class JsonReader {
+public:
+    enum class Token_T {
+        BEGIN_OBJECT,
+        END_OBJECT,
+        BEGIN_ARRAY,
+        END_ARRAY,
+        KEY, // The colon after it is consumed too
+        STRING,
+        NUMBER,
+        TRUE,
+        FALSE,
+        NULL_VALUE,
+        END,
+        ERROR
+    };
+
+    // Reads up to size bytes into buffer: returns how many, 0 at the end of the input, negative on errors
+    using Source = int (*)(void* context, char* buffer, size_t size);
+
+    static constexpr int MAX_DEPTH = 32;
+private:
+    enum class Expect_T : uint8_t {
+        VALUE,
+        FIRST_VALUE, // Right after '[', may also close it
+        KEY,
+        FIRST_KEY, // Right after '{', may also close it
+        COMMA_OR_END,
+        DONE
+    };
+
+    char* _buffer;
+    size_t _capacity;
+    Source _source;
+    void* _context;
+    size_t _start = 0; // First byte not consumed yet
+    size_t _end; // End of the bytes read so far
+    bool _is_input_done;
+
+    Expect_T _expect = Expect_T::VALUE;
+    uint32_t _array_bits = 0; // One bit per depth, set for arrays
+    int _depth = 0;
+    bool _is_failed = false;
+    const char* _text = nullptr;
+    size_t _text_length = 0;
+
+    // Character at _start + offset, reading more input as needed; -1 at the end of the input
+    int Peek(size_t offset);
+    bool Refill();
+    void SkipWhitespace();
+    Token_T Fail();
+    [[nodiscard]] bool IsInArray() const { return _depth > 0 && (_array_bits & (1u << (_depth - 1))); }
+    [[nodiscard]] Expect_T GetExpectAfterValue() const;
+
+    Token_T ReadValue(int c);
+    Token_T Open(bool is_array);
+    Token_T Close(bool is_array);
+    // Unescapes the string at _start in place without consuming it. read is its length in the input,
+    // written the length of the quote and unescaped text.
+    bool ReadString(size_t& read, size_t& written);
+    Token_T ReadNumber();
+    Token_T ReadLiteral(const char* literal, Token_T token);
+public:
+    // Reads the input from source, buffer holds the unconsumed part and bounds the token length
+    JsonReader(char* buffer, size_t size, Source source, void* context);
+    // Parses text that is already in memory, unescaping in place
+    JsonReader(char* text, size_t length);
+
+    Token_T Next();
+    // Skips the value a BEGIN_OBJECT or BEGIN_ARRAY token just opened, does nothing for other tokens
+    bool Skip(Token_T token);
+
+    // Text of the last KEY, STRING or NUMBER token, valid until the next call to Next
+    [[nodiscard]] std::string_view GetText() const { return {_text, _text_length}; }
+    // False for numbers with a fraction or exponent, and on overflow
+    bool GetInteger(int64_t& out) const { return ParseInteger(GetText(), out); }
+    // Same for text from elsewhere, e.g. a number sent as a string
+    static bool ParseInteger(std::string_view text, int64_t& out);
+    [[nodiscard]] int GetDepth() const { return _depth; }
+};
@@ -0,0 +1,184 @@
+#include "JsonWriter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+JsonWriter::JsonWriter(char* buffer, size_t size, Sink sink, void* context) : _buffer(buffer), _capacity(size),
+                                                                              _sink(sink), _context(context)
+{
+
+}
+
+bool JsonWriter::Flush()
+{
+    if (_is_failed) {
+        return false;
+    }
+    if (_length == 0) {
+        return true;
+    }
+    if (_sink == nullptr || !_sink(_context, _buffer, _length)) {
+        _is_failed = true;
+        return false;
+    }
+    _length = 0;
+    return true;
+}
+
+void JsonWriter::Write(const char* data, size_t size)
+{
+    while (size > 0 && !_is_failed) {
+        if (_length == _capacity && !Flush()) {
+            return;
+        }
+        const size_t to_copy = std::min(size, _capacity - _length);
+        memcpy(_buffer + _length, data, to_copy);
+        _length += to_copy;
+        data += to_copy;
+        size -= to_copy;
+    }
+}
+
+void JsonWriter::Put(char c)
+{
+    Write(&c, 1);
+}
+
+void JsonWriter::BeginValue()
+{
+    if (_is_after_key) {
+        _is_after_key = false;
+        return;
+    }
+    if (_depth > 0) {
+        const uint32_t bit = 1u << (_depth - 1);
+        if (_has_items_bits & bit) {
+            Put(',');
+        }
+        _has_items_bits |= bit;
+    }
+}
+
+void JsonWriter::BeginObject()
+{
+    BeginValue();
+    Put('{');
+    if (_depth == MAX_DEPTH) {
+        _is_failed = true;
+        return;
+    }
+    _has_items_bits &= ~(1u << _depth);
+    ++_depth;
+}
+
+void JsonWriter::EndObject()
+{
+    Put('}');
+    --_depth;
+}
+
+void JsonWriter::BeginArray()
+{
+    BeginValue();
+    Put('[');
+    if (_depth == MAX_DEPTH) {
+        _is_failed = true;
+        return;
+    }
+    _has_items_bits &= ~(1u << _depth);
+    ++_depth;
+}
+
+void JsonWriter::EndArray()
+{
+    Put(']');
+    --_depth;
+}
+
+void JsonWriter::Key(std::string_view key)
+{
+    BeginValue();
+    WriteEscaped(key);
+    Put(':');
+    _is_after_key = true;
+}
+
+void JsonWriter::WriteEscaped(std::string_view text)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    Put('"');
+    // Runs of plain characters go out in one copy
+    size_t run_start = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        const auto c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        Write(text.data() + run_start, i - run_start);
+        run_start = i + 1;
+        switch (c) {
+            case '"': Write("\\\"", 2); break;
+            case '\\': Write("\\\\", 2); break;
+            case '\n': Write("\\n", 2); break;
+            case '\r': Write("\\r", 2); break;
+            case '\t': Write("\\t", 2); break;
+            default: {
+                const char escaped[] = {'\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0x0F]};
+                Write(escaped, sizeof(escaped));
+                break;
+            }
+        }
+    }
+    Write(text.data() + run_start, text.size() - run_start);
+    Put('"');
+}
+
+void JsonWriter::String(std::string_view value)
+{
+    BeginValue();
+    WriteEscaped(value);
+}
+
+void JsonWriter::Integer(int64_t value)
+{
+    char digits[24];
+    const int length = snprintf(digits, sizeof(digits), "%lld", static_cast<long long>(value));
+    BeginValue();
+    Write(digits, length);
+}
+
+void JsonWriter::Number(double value)
+{
+    if (!std::isfinite(value)) {
+        Null();
+        return;
+    }
+    char digits[32];
+    const int length = snprintf(digits, sizeof(digits), "%g", value);
+    BeginValue();
+    Write(digits, length);
+}
+
+void JsonWriter::Bool(bool value)
+{
+    BeginValue();
+    if (value) {
+        Write("true", 4);
+    } else {
+        Write("false", 5);
+    }
+}
+
+void JsonWriter::Null()
+{
+    BeginValue();
+    Write("null", 4);
+}
+
+void JsonWriter::Raw(std::string_view json)
+{
+    BeginValue();
+    Write(json.data(), json.size());
+}
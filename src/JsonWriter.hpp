@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Streaming JSON writer over a caller supplied buffer. Commas and string escaping are taken care
+// of; when the buffer fills up it is handed to the Sink (e.g. httpd_resp_send_chunk) and reused,
+// so a document of any size goes out through a fixed amount of stack. Without a sink the whole
+// document must fit, and writing past the end fails the writer.
+//
+// Errors are sticky: once the sink fails or the buffer overflows, further writes are dropped
+// and IsFailed() is true.
+class JsonWriter {
+public:
+    // Takes size bytes of data, false on errors
+    using Sink = bool (*)(void* context, const char* data, size_t size);
+
+    static constexpr int MAX_DEPTH = 32;
+private:
+    char* _buffer;
+    size_t _capacity;
+    size_t _length = 0;
+    Sink _sink;
+    void* _context;
+
+    uint32_t _has_items_bits = 0; // One bit per depth, set once the container has a member
+    int _depth = 0;
+    bool _is_after_key = false;
+    bool _is_failed = false;
+
+    void Write(const char* data, size_t size);
+    void Put(char c);
+    void BeginValue(); // Writes the comma the value needs, if any
+    void WriteEscaped(std::string_view text);
+public:
+    JsonWriter(char* buffer, size_t size, Sink sink = nullptr, void* context = nullptr);
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    void Key(std::string_view key);
+
+    void String(std::string_view value);
+    void Integer(int64_t value);
+    void Number(double value); // Shortest %g form, null when not finite
+    void Bool(bool value);
+    void Null();
+    // A value that is already JSON, e.g. a formatted number
+    void Raw(std::string_view json);
+
+    // Hands what is buffered to the sink
+    bool Flush();
+
+    [[nodiscard]] bool IsFailed() const { return _is_failed; }
+    // What is buffered and not yet flushed
+    [[nodiscard]] const char* GetData() const { return _buffer; }
+    [[nodiscard]] size_t GetLength() const { return _length; }
+};
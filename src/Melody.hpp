@@ -0,0 +1,248 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+#include "Audio.hpp"
+
+// Compiles tunes written in RTTTL ("name:d=4,o=5,b=120:8a#5,p,4c.6") into a std::array of
+// Audio::Beep while compiling, so the firmware only carries the table, in flash.
+//
+//   static constexpr std::string_view ALARM_MELODY = "alarm:d=4,o=4,b=30:a,p,a";
+//   audio.PlayTune(Melody::Compiled<ALARM_MELODY>);
+//
+// Notes are [duration][letter][#][.][octave][.], p is a rest; the defaults section may set the
+// duration (d), octave (o) and beats per minute (b). Malformed notation fails the build, the error
+// points at the InvalidMelody call with the reason.
+namespace Melody {
+    constexpr int DEFAULT_DURATION = 4;
+    constexpr int DEFAULT_OCTAVE = 6;
+    constexpr int DEFAULT_BPM = 63;
+    constexpr int MIN_OCTAVE = 1;
+    constexpr int MAX_OCTAVE = 8;
+    constexpr int MAX_BPM = 900;
+
+    // Not constexpr: reaching it while compiling a melody is the compile error
+    [[noreturn]] inline void InvalidMelody([[maybe_unused]] const char* reason) { abort(); }
+
+    namespace Detail {
+        // Octave 4 in millihertz, C to B
+        constexpr std::array<int32_t, 12> OCTAVE_4_MHZ = {
+            261626, 277183, 293665, 311127, 329628, 349228, 369994, 391995, 415305, 440000, 466164, 493883
+        };
+
+        constexpr bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+        constexpr bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+        constexpr char ToLower(char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; }
+
+        // Reads digits at position, 0 if there are none
+        constexpr int ParseNumber(std::string_view text, size_t& position) {
+            int value = 0;
+            while (position < text.size() && IsDigit(text[position])) {
+                value = value * 10 + (text[position++] - '0');
+                if (value > 100000) {
+                    InvalidMelody("number too large");
+                }
+            }
+            return value;
+        }
+
+        constexpr void SkipSpaces(std::string_view text, size_t& position) {
+            while (position < text.size() && IsSpace(text[position])) {
+                ++position;
+            }
+        }
+
+        constexpr bool IsValidDuration(int duration) {
+            return duration == 1 || duration == 2 || duration == 4 || duration == 8 || duration == 16 || duration == 32;
+        }
+
+        constexpr int GetFrequencyHz(int semitone, int octave) {
+            int64_t millihertz = OCTAVE_4_MHZ[semitone];
+            if (octave >= 4) {
+                millihertz <<= (octave - 4);
+            } else {
+                millihertz >>= (4 - octave);
+            }
+            return static_cast<int>((millihertz + 500) / 1000);
+        }
+
+        struct Defaults {
+            int duration;
+            int octave;
+            int bpm;
+        };
+
+        // Returns where the notes start
+        constexpr size_t ParseHeader(std::string_view text, Defaults& defaults) {
+            const size_t name_end = text.find(':');
+            if (name_end == std::string_view::npos) {
+                InvalidMelody("missing ':' after the name");
+            }
+            const size_t defaults_end = text.find(':', name_end + 1);
+            if (defaults_end == std::string_view::npos) {
+                InvalidMelody("missing ':' after the defaults");
+            }
+
+            defaults = {DEFAULT_DURATION, DEFAULT_OCTAVE, DEFAULT_BPM};
+            size_t position = name_end + 1;
+            while (true) {
+                SkipSpaces(text, position);
+                if (position == defaults_end) {
+                    break;
+                }
+                const char key = ToLower(text[position++]);
+                SkipSpaces(text, position);
+                if (position >= defaults_end || text[position++] != '=') {
+                    InvalidMelody("expected '=' in the defaults");
+                }
+                SkipSpaces(text, position);
+                const int value = ParseNumber(text, position);
+                switch (key) {
+                    case 'd':
+                        if (!IsValidDuration(value)) {
+                            InvalidMelody("default duration must be 1, 2, 4, 8, 16 or 32");
+                        }
+                        defaults.duration = value;
+                        break;
+                    case 'o':
+                        if (value < MIN_OCTAVE || value > MAX_OCTAVE) {
+                            InvalidMelody("default octave out of range");
+                        }
+                        defaults.octave = value;
+                        break;
+                    case 'b':
+                        if (value < 1 || value > MAX_BPM) {
+                            InvalidMelody("beats per minute out of range");
+                        }
+                        defaults.bpm = value;
+                        break;
+                    default:
+                        InvalidMelody("unknown default, expected d, o or b");
+                }
+                SkipSpaces(text, position);
+                if (position < defaults_end && text[position++] != ',') {
+                    InvalidMelody("expected ',' between defaults");
+                }
+            }
+            return defaults_end + 1;
+        }
+
+        // Parses the note at position and moves past its separator
+        constexpr Audio::Beep ParseNote(std::string_view text, size_t& position, const Defaults& defaults) {
+            SkipSpaces(text, position);
+            int duration = ParseNumber(text, position);
+            if (duration == 0) {
+                duration = defaults.duration;
+            } else if (!IsValidDuration(duration)) {
+                InvalidMelody("note duration must be 1, 2, 4, 8, 16 or 32");
+            }
+
+            if (position >= text.size()) {
+                InvalidMelody("missing note");
+            }
+            int semitone = -1; // Rest
+            switch (ToLower(text[position++])) {
+                case 'c': semitone = 0; break;
+                case 'd': semitone = 2; break;
+                case 'e': semitone = 4; break;
+                case 'f': semitone = 5; break;
+                case 'g': semitone = 7; break;
+                case 'a': semitone = 9; break;
+                case 'b': semitone = 11; break;
+                case 'p': break;
+                default:
+                    InvalidMelody("unknown note, expected a to g or p");
+            }
+            if (position < text.size() && text[position] == '#') {
+                if (semitone != 0 && semitone != 2 && semitone != 5 && semitone != 7 && semitone != 9) {
+                    InvalidMelody("only c, d, f, g and a can be sharp");
+                }
+                ++semitone;
+                ++position;
+            }
+
+            bool is_dotted = false;
+            if (position < text.size() && text[position] == '.') {
+                is_dotted = true;
+                ++position;
+            }
+            int octave = ParseNumber(text, position);
+            if (octave == 0) {
+                octave = defaults.octave;
+            } else if (octave < MIN_OCTAVE || octave > MAX_OCTAVE) {
+                InvalidMelody("note octave out of range");
+            }
+            if (position < text.size() && text[position] == '.') {
+                if (is_dotted) {
+                    InvalidMelody("note dotted twice");
+                }
+                is_dotted = true;
+                ++position;
+            }
+
+            SkipSpaces(text, position);
+            if (position < text.size() && text[position++] != ',') {
+                InvalidMelody("expected ',' between notes");
+            }
+
+            // A whole note lasts four beats
+            int64_t duration_ns = 240000000000LL / (static_cast<int64_t>(defaults.bpm) * duration);
+            if (is_dotted) {
+                duration_ns = duration_ns * 3 / 2;
+            }
+            return Audio::Beep{std::chrono::nanoseconds(duration_ns), semitone < 0 ? -1 : GetFrequencyHz(semitone, octave)};
+        }
+    }
+
+    constexpr size_t CountNotes(std::string_view rtttl) {
+        Detail::Defaults defaults = {};
+        size_t position = Detail::ParseHeader(rtttl, defaults);
+        size_t count = 0;
+        while (position < rtttl.size()) {
+            Detail::ParseNote(rtttl, position, defaults);
+            ++count;
+        }
+        if (count == 0) {
+            InvalidMelody("no notes");
+        }
+        return count;
+    }
+
+    template <size_t N>
+    constexpr std::array<Audio::Beep, N> Compile(std::string_view rtttl) {
+        Detail::Defaults defaults = {};
+        size_t position = Detail::ParseHeader(rtttl, defaults);
+        std::array<Audio::Beep, N> beeps = {};
+        for (auto& beep : beeps) {
+            if (position >= rtttl.size()) {
+                InvalidMelody("fewer notes than expected");
+            }
+            beep = Detail::ParseNote(rtttl, position, defaults);
+        }
+        if (position < rtttl.size()) {
+            InvalidMelody("more notes than expected");
+        }
+        return beeps;
+    }
+
+    // The compiled table of a melody with static storage, see above
+    template <const std::string_view& Rtttl>
+    inline constexpr auto Compiled = Compile<CountNotes(Rtttl)>(Rtttl);
+
+    namespace Detail {
+        constexpr std::string_view SELF_TEST = "test:d=8,o=5,b=120:4a4,c#,p,16e.6,b3.,32g#";
+        constexpr auto SELF_TEST_TUNE = Compile<CountNotes(SELF_TEST)>(SELF_TEST);
+
+        static_assert(SELF_TEST_TUNE.size() == 6, "Wrong note count");
+        static_assert(SELF_TEST_TUNE[0].frequency_hz == 440 && SELF_TEST_TUNE[0].duration == std::chrono::milliseconds(500), "Wrong A4 quarter note");
+        static_assert(SELF_TEST_TUNE[1].frequency_hz == 554 && SELF_TEST_TUNE[1].duration == std::chrono::milliseconds(250), "Wrong default duration or octave");
+        static_assert(SELF_TEST_TUNE[2].IsSilence() && SELF_TEST_TUNE[2].duration == std::chrono::milliseconds(250), "Wrong rest");
+        static_assert(SELF_TEST_TUNE[3].frequency_hz == 1319 && SELF_TEST_TUNE[3].duration == std::chrono::microseconds(187500), "Wrong dotted note");
+        static_assert(SELF_TEST_TUNE[4].frequency_hz == 247 && SELF_TEST_TUNE[4].duration == std::chrono::milliseconds(375), "Wrong dot after the octave");
+        static_assert(SELF_TEST_TUNE[5].frequency_hz == 831 && SELF_TEST_TUNE[5].duration == std::chrono::microseconds(62500), "Wrong sharp");
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// Generates the 1-Wire reset and read/write slots for a OneWireBus. Implementations
+// are free to drive the line with a peripheral, as long as they honour OneWireTiming.
+class OneWireBackend {
+public:
+    [[nodiscard]] virtual bool IsValid() const = 0;
+
+    // Sends a reset pulse and returns whether a presence pulse was seen
+    virtual bool Reset() = 0;
+
+    virtual void WriteBit(bool to_write) = 0;
+    virtual bool ReadBit() = 0;
+
+    // Read/Writes are LSB first. Backends that can clock out a whole byte at once should override these.
+    virtual void WriteByte(uint8_t to_write) {
+        for (int i = 0; i < 8; i++) {
+            WriteBit(to_write & (1 << i));
+        }
+    }
+
+    virtual uint8_t ReadByte() {
+        uint8_t ret_byte = 0;
+        for (int i = 0; i < 8; i++) {
+            ret_byte |= (static_cast<uint8_t>(ReadBit()) << i);
+        }
+        return ret_byte;
+    }
+
+    virtual ~OneWireBackend() = default;
+};
@@ -0,0 +1,71 @@
+#include "OneWireBitBangBackend.hpp"
+
+#include "OneWireTiming.hpp"
+
+using namespace OneWireTiming;
+
+static constexpr int POLL_INTERVAL_US = 5;
+
+OneWireBitBangBackend::OneWireBitBangBackend(const std::shared_ptr<OneWirePin>& pin) : _pin(pin)
+{
+    _pin->Release();
+}
+
+bool OneWireBitBangBackend::Reset()
+{
+    _pin->BeginSlot();
+    _pin->Hold();
+    _pin->DelayUs(RESET_LOW_US);
+    _pin->Release();
+
+    _pin->DelayUs(PRESENCE_WAIT_US);
+    auto retry = RetryCounter(PRESENCE_TIMEOUT_US / POLL_INTERVAL_US);
+    while (_pin->Read() && retry.Tick()) {
+        _pin->DelayUs(POLL_INTERVAL_US);
+    }
+    bool is_present = retry.IsValid();
+    _pin->EndSlot();
+
+    if (is_present) {
+        // The presence pulse is at most 240us, a line held longer than the whole slot is stuck
+        auto release_retry = RetryCounter(RESET_SLOT_US / POLL_INTERVAL_US);
+        while (!_pin->Read() && release_retry.Tick()) {
+            _pin->DelayUs(POLL_INTERVAL_US);
+        }
+        is_present = release_retry.IsValid();
+    }
+
+    return is_present;
+}
+
+void OneWireBitBangBackend::WriteBit(bool to_write)
+{
+    _pin->BeginSlot();
+    _pin->Hold();
+
+    if (!to_write) { // Generate a 0 slot - hold the bus a bit longer
+        _pin->DelayUs(WRITE_0_LOW_US);
+        _pin->Release();
+        _pin->DelayUs(SLOT_US - WRITE_0_LOW_US + RECOVERY_US);
+    } else {
+        _pin->DelayUs(WRITE_1_LOW_US);
+        _pin->Release();
+        _pin->DelayUs(SLOT_US - WRITE_1_LOW_US + RECOVERY_US);
+    }
+    _pin->EndSlot();
+}
+
+bool OneWireBitBangBackend::ReadBit()
+{
+    _pin->BeginSlot();
+
+    _pin->Hold();
+    _pin->DelayUs(READ_LOW_US);
+    _pin->Release();
+    _pin->DelayUs(READ_SAMPLE_US - READ_LOW_US);
+    const bool value = _pin->Read();
+    _pin->DelayUs(SLOT_US - READ_SAMPLE_US + RECOVERY_US);
+
+    _pin->EndSlot();
+    return value;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+
+#include "OneWireBackend.hpp"
+#include "OneWirePin.hpp"
+
+// Software fallback - times every slot on the CPU. Has no platform dependencies of its
+// own, so the same code runs against OneWireSimulator on a build machine.
+class OneWireBitBangBackend : public OneWireBackend {
+    std::shared_ptr<OneWirePin> _pin;
+
+    class RetryCounter {
+        int _retries = 0;
+        const int _max_retries;
+    public:
+        RetryCounter(int max_retries) : _max_retries(max_retries) {
+
+        }
+        bool Tick() {
+            ++_retries;
+            return _retries <= _max_retries;
+        }
+
+        void Reset() {
+            _retries = 0;
+        }
+
+        bool IsValid() {
+            return _retries <= _max_retries;
+        }
+    };
+public:
+    explicit OneWireBitBangBackend(const std::shared_ptr<OneWirePin>& pin);
+
+    [[nodiscard]] bool IsValid() const override { return _pin != nullptr; }
+
+    bool Reset() override;
+    void WriteBit(bool to_write) override;
+    bool ReadBit() override;
+};
@@ -1,105 +1,200 @@
 
 #include "OneWireBus.hpp"
 
-#include "freertos/FreeRTOS.h"
+#include <numeric>
+
 #include "esp_log.h"
 
-static constexpr int WAIT_RETRIES = 100;
+#include "OneWireBitBangBackend.hpp"
+#include "OneWireGpioPin.hpp"
+#include "OneWireRmtBackend.hpp"
+#include "OneWireUartBackend.hpp"
+
 static const char* TAG = "OneWire";
 
-OneWireBus::OneWireBus(gpio_num_t pin) : _pin(pin)
+static constexpr size_t MAX_DEVICES = 32; // Guards against a noisy bus making the search loop forever
+
+OneWireBus::OneWireBus(gpio_num_t pin, Backend_T backend_type) : _backend(MakeBackend(pin, backend_type))
 {
-    gpio_reset_pin(pin);
-    Release();
+    if (!_backend->IsValid()) {
+        ESP_LOGW(TAG, "Backend %d unavailable on pin %d, falling back to bit-banging", backend_type, pin);
+        _backend.reset();
+        _backend = MakeBackend(pin, Backend_T::BIT_BANG);
+    }
 }
 
+OneWireBus::OneWireBus(std::unique_ptr<OneWireBackend> backend) : _backend(std::move(backend))
+{
 
-bool OneWireBus::Reset() 
+}
+
+std::unique_ptr<OneWireBackend> OneWireBus::MakeBackend(gpio_num_t pin, Backend_T backend_type)
 {
-    auto lock = AcquireLock();
-    Hold();
-    ets_delay_us(500);
-    Release();
-    
-    ets_delay_us(50);
-    auto retry = RetryCounter(WAIT_RETRIES);
-    while (gpio_get_level(_pin) && retry.Tick()) {
-        ets_delay_us(5);
-    }
-    
-    _is_init = retry.IsValid();
-    if (_is_init) {
-        while(!gpio_get_level(_pin));
+    switch (backend_type) {
+        case Backend_T::RMT:
+            return std::make_unique<OneWireRmtBackend>(pin);
+        case Backend_T::UART:
+            return std::make_unique<OneWireUartBackend>(pin);
+        case Backend_T::BIT_BANG:
+        default:
+            return std::make_unique<OneWireBitBangBackend>(std::make_shared<OneWireGpioPin>(pin));
     }
-  
-    return _is_init;
 }
 
+bool OneWireBus::Reset() 
+{
+    auto lock = AcquireLock();
+    return _backend->Reset();
+}
 
 void OneWireBus::WriteBit(bool to_write) 
 {
     auto lock = AcquireLock();
-    Hold();
-
-    if (!to_write) { // Generate a 0 slot - hold the bus a bit longer
-        ets_delay_us(80);   
-        Release();
-    } else {
-        ets_delay_us(1);
-        Release();
-        ets_delay_us(80);
-    }
+    _backend->WriteBit(to_write);
 }
 
 bool OneWireBus::ReadBit() 
 {
     auto lock = AcquireLock();
+    return _backend->ReadBit();
+}
 
-    Hold();
-    ets_delay_us(3);
-    Release();
-    const bool value = gpio_get_level(_pin);
-    ets_delay_us(80);
+void OneWireBus::WriteByte(uint8_t to_write) 
+{
+    auto lock = AcquireLock();
+    _backend->WriteByte(to_write);
+}
 
-    return value;
+uint8_t OneWireBus::ReadByte() 
+{
+    auto lock = AcquireLock();
+    return _backend->ReadByte();
 }
 
-void OneWireBus::WriteByte(uint8_t to_write) 
+bool OneWireBus::MatchRom(const RomCode& rom_code)
 {
     auto lock = AcquireLock();
+    if (!Reset()) {
+        return false;
+    }
+    WriteByte(MATCH_ROM);
 
-    for (int i = 0; i < 8; i++) {
-        WriteBit(((to_write) & (1 << i)));
-        ets_delay_us(1);
+    WriteByte(rom_code.family_code);
+    for (auto byte : rom_code.bytes) {
+        WriteByte(byte);
     }
+    WriteByte(rom_code.crc);
+    return true;
 }
 
-uint8_t OneWireBus::ReadByte() 
+bool OneWireBus::SkipRom()
 {
-    uint8_t ret_byte = 0;
-
     auto lock = AcquireLock();
-    for(int i = 0; i< 8; i++) {
-        const uint8_t next_bit = ReadBit();
-        ret_byte |= (next_bit << i);
-        ets_delay_us(1);
+    if (!Reset()) {
+        return false;
     }
-    return ret_byte;
+    WriteByte(SKIP_ROM);
+    return true;
+}
+
+bool OneWireBus::Search(std::vector<RomCode>& found, uint8_t search_command)
+{
+    found.clear();
+    auto lock = AcquireLock();
+
+    std::array<uint8_t, 8> rom = {};
+    int last_discrepancy = -1;
+
+    do {
+        if (!Reset()) {
+            // Nobody on the bus
+            return true;
+        }
+        WriteByte(search_command);
+
+        int last_zero = -1;
+        for (int bit = 0; bit < 64; bit++) {
+            const bool id_bit = ReadBit();
+            const bool complement_bit = ReadBit();
+            const uint8_t mask = 1 << (bit % 8);
+            bool direction;
+
+            if (id_bit && complement_bit) {
+                // On the first bit of the first pass this just means no device is taking part (e.g. nothing alarming)
+                if (bit == 0 && found.empty()) {
+                    return true;
+                }
+                ESP_LOGE(TAG, "Devices dropped out of search at bit %d", bit);
+                return false;
+            } else if (id_bit != complement_bit) {
+                // Every remaining device agrees on this bit
+                direction = id_bit;
+            } else if (bit < last_discrepancy) {
+                // Follow the same branch as the previous pass
+                direction = rom[bit / 8] & mask;
+            } else {
+                // Take the 1 branch at the last fork, 0 at new ones
+                direction = (bit == last_discrepancy);
+            }
+
+            if (!id_bit && !complement_bit && !direction) {
+                last_zero = bit;
+            }
+
+            if (direction) {
+                rom[bit / 8] |= mask;
+            } else {
+                rom[bit / 8] &= ~mask;
+            }
+            WriteBit(direction);
+        }
+
+        RomCode rom_code;
+        rom_code.family_code = rom[0];
+        std::copy(rom.begin() + 1, rom.begin() + 7, rom_code.bytes.begin());
+        rom_code.crc = rom[7];
+
+        if (!CheckCrc(rom_code)) {
+            ESP_LOGE(TAG, "CRC mismatch on searched ROM code");
+            return false;
+        }
+        found.push_back(rom_code);
+        last_discrepancy = last_zero;
+    } while (last_discrepancy >= 0 && found.size() < MAX_DEVICES);
+
+    return true;
 }
 
-CriticalSection::Lock OneWireBus::AcquireLock() 
+uint8_t OneWireBus::GetCrcByte(uint8_t current_crc, uint8_t byte)
 {
-    return _critical_section.Acquire();
+    const std::array<uint8_t,256> crc_table = 
+    {0, 94, 188, 226, 97, 63, 221, 131, 194, 156, 126, 32, 163, 253, 31, 65,
+	157, 195, 33, 127, 252, 162, 64, 30, 95, 1, 227, 189, 62, 96, 130, 220,
+	35, 125, 159, 193, 66, 28, 254, 160, 225, 191, 93, 3, 128, 222, 60, 98,
+	190, 224, 2, 92, 223, 129, 99, 61, 124, 34, 192, 158, 29, 67, 161, 255,
+	70, 24, 250, 164, 39, 121, 155, 197, 132, 218, 56, 102, 229, 187, 89, 7,
+	219, 133, 103, 57, 186, 228, 6, 88, 25, 71, 165, 251, 120, 38, 196, 154,
+	101, 59, 217, 135, 4, 90, 184, 230, 167, 249, 27, 69, 198, 152, 122, 36,
+	248, 166, 68, 26, 153, 199, 37, 123, 58, 100, 134, 216, 91, 5, 231, 185,
+	140, 210, 48, 110, 237, 179, 81, 15, 78, 16, 242, 172, 47, 113, 147, 205,
+	17, 79, 173, 243, 112, 46, 204, 146, 211, 141, 111, 49, 178, 236, 14, 80,
+	175, 241, 19, 77, 206, 144, 114, 44, 109, 51, 209, 143, 12, 82, 176, 238,
+	50, 108, 142, 208, 83, 13, 239, 177, 240, 174, 76, 18, 145, 207, 45, 115,
+	202, 148, 118, 40, 171, 245, 23, 73, 8, 86, 180, 234, 105, 55, 213, 139,
+	87, 9, 235, 181, 54, 104, 138, 212, 149, 203, 41, 119, 244, 170, 72, 22,
+	233, 183, 85, 11, 136, 214, 52, 106, 43, 117, 151, 201, 74, 20, 246, 168,
+	116, 42, 200, 150, 21, 75, 169, 247, 182, 232, 10, 84, 215, 137, 107, 53};
+
+    return crc_table[current_crc ^ byte];
 }
 
-void OneWireBus::Hold() 
+bool OneWireBus::CheckCrc(const RomCode& rom_code)
 {
-    gpio_set_direction(_pin, GPIO_MODE_OUTPUT);
-    gpio_set_level(_pin, 0);
+    const auto crc_calc =  std::accumulate(rom_code.bytes.begin(), rom_code.bytes.end(), GetCrcByte(0, rom_code.family_code), [&](const uint8_t accum, const uint8_t next_byte) { return GetCrcByte(accum, next_byte);});
+    return crc_calc == rom_code.crc;
 }
 
-void OneWireBus::Release() 
+std::unique_lock<std::recursive_mutex> OneWireBus::AcquireLock() 
 {
-    gpio_set_direction(_pin, GPIO_MODE_INPUT);
-    gpio_set_pull_mode(_pin, GPIO_PULLUP_ONLY);
+    return std::unique_lock<std::recursive_mutex>(_transaction_lock);
 }
@@ -1,39 +1,48 @@
 #pragma once
 
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "driver/gpio.h"
-#include "freertos/FreeRTOS.h"
-#include "CriticalSection.hpp"
+#include "OneWireBackend.hpp"
 
 class OneWireBus {
-    gpio_num_t _pin;
-    bool _is_init = false;
-    CriticalSection _critical_section;
+public:
+    enum Backend_T {
+        BIT_BANG,
+        RMT,
+        UART
+    };
 
-    void Release(); // Release the bus - open drain with pull-up
-    void Hold(); // Hold the bus low
+    // ROM commands
+    static constexpr uint8_t READ_ROM = 0x33;
+    static constexpr uint8_t MATCH_ROM = 0x55;
+    static constexpr uint8_t SKIP_ROM = 0xCC;
+    static constexpr uint8_t SEARCH_ROM = 0xF0;
+    static constexpr uint8_t ALARM_SEARCH = 0xEC;
 
-    class RetryCounter {
-        int _retries = 0;
-        const int _max_retries;
-    public:
-        RetryCounter(int max_retries) : _max_retries(max_retries) {
+    struct RomCode {
+        uint8_t family_code = 0;
+        std::array<uint8_t,6> bytes;
+        uint8_t crc = 0;
 
-        }
-        bool Tick() {
-            ++_retries;
-            return _retries <= _max_retries; 
-        }
-
-        void Reset() {
-            _retries = 0;
-        }
-
-        bool IsValid() {
-            return _retries <= _max_retries;
+        [[nodiscard]] bool IsValid() const {return family_code != 0;}
+        bool operator==(const RomCode& other) const {
+            return family_code == other.family_code && bytes == other.bytes && crc == other.crc;
         }
     };
+private:
+    std::unique_ptr<OneWireBackend> _backend;
+    std::recursive_mutex _transaction_lock;
+
+    static std::unique_ptr<OneWireBackend> MakeBackend(gpio_num_t pin, Backend_T backend_type);
 public:
-    explicit OneWireBus(gpio_num_t pin);
+    // Falls back to bit-banging if the requested peripheral can't be set up
+    explicit OneWireBus(gpio_num_t pin, Backend_T backend_type = Backend_T::RMT);
+    // Runs on a caller provided backend, e.g. bit-banging a OneWireSimulator
+    explicit OneWireBus(std::unique_ptr<OneWireBackend> backend);
 
     // Sends a reset pulse and waits for a presence pulse
     bool Reset();
@@ -44,5 +53,19 @@ public:
     //Read/Writes are LSB first
     void WriteByte(uint8_t to_write);
     uint8_t ReadByte();
-    CriticalSection::Lock AcquireLock();
-};
\ No newline at end of file
+
+    // Reset followed by Match ROM / Skip ROM. The bus lock should be held until the function command is done.
+    bool MatchRom(const RomCode& rom_code);
+    bool SkipRom();
+
+    // Walks the ROM tree and returns every device that answers. With ALARM_SEARCH only devices
+    // with their alarm flag set answer. Returns false on a bus or CRC error.
+    bool Search(std::vector<RomCode>& found, uint8_t search_command = SEARCH_ROM);
+
+    // Held for a whole transaction (reset, ROM command, function command) so tasks sharing the bus don't interleave
+    std::unique_lock<std::recursive_mutex> AcquireLock();
+
+    // Dallas/Maxim CRC8, one byte at a time
+    static uint8_t GetCrcByte(uint8_t current_crc, uint8_t byte);
+    static bool CheckCrc(const RomCode& rom_code);
+};
@@ -0,0 +1,39 @@
+#include "OneWireGpioPin.hpp"
+
+OneWireGpioPin::OneWireGpioPin(gpio_num_t pin) : _pin(pin)
+{
+    gpio_reset_pin(pin);
+    Release();
+}
+
+void OneWireGpioPin::Hold()
+{
+    gpio_set_direction(_pin, GPIO_MODE_OUTPUT);
+    gpio_set_level(_pin, 0);
+}
+
+void OneWireGpioPin::Release()
+{
+    gpio_set_direction(_pin, GPIO_MODE_INPUT);
+    gpio_set_pull_mode(_pin, GPIO_PULLUP_ONLY);
+}
+
+bool OneWireGpioPin::Read()
+{
+    return gpio_get_level(_pin);
+}
+
+void OneWireGpioPin::DelayUs(uint32_t us)
+{
+    ets_delay_us(us);
+}
+
+void OneWireGpioPin::BeginSlot()
+{
+    _slot_lock.emplace(_critical_section);
+}
+
+void OneWireGpioPin::EndSlot()
+{
+    _slot_lock.reset();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <optional>
+
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+
+#include "CriticalSection.hpp"
+#include "OneWirePin.hpp"
+
+class OneWireGpioPin : public OneWirePin {
+    gpio_num_t _pin;
+    CriticalSection _critical_section;
+    std::optional<CriticalSection::Lock> _slot_lock;
+public:
+    explicit OneWireGpioPin(gpio_num_t pin);
+
+    void Hold() override;
+    void Release() override;
+    [[nodiscard]] bool Read() override;
+    void DelayUs(uint32_t us) override;
+
+    // Interrupts are disabled for the duration of a single slot
+    void BeginSlot() override;
+    void EndSlot() override;
+};
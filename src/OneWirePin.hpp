@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+// The open-drain line a bit-banged 1-Wire bus runs on. Implemented by a real GPIO on the
+// device and by OneWireSimulator on a build machine.
+class OneWirePin {
+public:
+    virtual void Hold() = 0; // Hold the bus low
+    virtual void Release() = 0; // Release the bus - open drain with pull-up
+    [[nodiscard]] virtual bool Read() = 0;
+    virtual void DelayUs(uint32_t us) = 0;
+
+    // Bracket the timing critical part of a slot
+    virtual void BeginSlot() {}
+    virtual void EndSlot() {}
+
+    virtual ~OneWirePin() = default;
+};
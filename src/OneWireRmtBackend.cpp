@@ -0,0 +1,227 @@
+#include "OneWireRmtBackend.hpp"
+
+#include <atomic>
+
+#include "esp_log.h"
+
+#include "OneWireTiming.hpp"
+
+using namespace OneWireTiming;
+
+static const char* TAG = "OneWireRmt";
+
+static constexpr uint32_t APB_CLK_HZ = 80000000;
+static constexpr uint8_t RMT_CLK_DIV = 80; // 1us per tick
+static constexpr uint64_t TICK_NS = 1000000000ULL * RMT_CLK_DIV / APB_CLK_HZ;
+static constexpr uint32_t MAX_DURATION_TICKS = 0x7FFF; // 15-bit fields in rmt_item32_t
+static constexpr uint8_t RX_FILTER_TICKS = 30; // In APB ticks, rejects glitches shorter than ~0.4us
+static constexpr size_t RX_BUFFER_SIZE = 512;
+static constexpr TickType_t RX_TIMEOUT = pdMS_TO_TICKS(10);
+
+static constexpr uint32_t UsToTicks(uint32_t us)
+{
+    return static_cast<uint32_t>(us * 1000ULL / TICK_NS);
+}
+
+static constexpr uint16_t RX_IDLE_TICKS = UsToTicks(SLOT_US + RECOVERY_US + 15); // Longer than the high part of any slot
+static constexpr uint16_t RX_RESET_IDLE_TICKS = UsToTicks(RESET_LOW_US + 60);
+static constexpr uint32_t READ_SAMPLE_TICKS = UsToTicks(READ_SAMPLE_US);
+
+// Each bus claims one TX and one RX channel
+static std::atomic<int> s_next_channel(0);
+
+namespace {
+    // An item as it is clocked out: held low, then released for the rest of the slot and the recovery time
+    struct SlotTicks {
+        uint32_t low;
+        uint32_t high;
+    };
+
+    constexpr SlotTicks MakeSlotTicks(uint32_t low_us, uint32_t slot_us) {
+        return {UsToTicks(low_us), UsToTicks(slot_us - low_us + RECOVERY_US)};
+    }
+
+    constexpr SlotTicks RESET_TICKS = {UsToTicks(RESET_LOW_US), UsToTicks(RESET_SLOT_US)};
+    constexpr SlotTicks WRITE_0_TICKS = MakeSlotTicks(WRITE_0_LOW_US, SLOT_US);
+    constexpr SlotTicks WRITE_1_TICKS = MakeSlotTicks(WRITE_1_LOW_US, SLOT_US);
+    constexpr SlotTicks READ_TICKS = MakeSlotTicks(READ_LOW_US, SLOT_US);
+
+    // The waveform the RMT actually emits, after rounding to its clock
+    constexpr bool FitsItem(const SlotTicks& slot) {
+        return slot.low > 0 && slot.low <= MAX_DURATION_TICKS && slot.high > 0 && slot.high <= MAX_DURATION_TICKS;
+    }
+    static_assert(FitsItem(RESET_TICKS) && FitsItem(WRITE_0_TICKS) && FitsItem(WRITE_1_TICKS) && FitsItem(READ_TICKS),
+                  "Slot durations don't fit an RMT item");
+    static_assert(IsValidReset(RESET_TICKS.low * TICK_NS) && RESET_TICKS.high * TICK_NS >= RESET_LOW_MIN_US * 1000ULL,
+                  "RMT reset pulse out of spec");
+    static_assert(IsValidWriteSlot(WRITE_0_TICKS.low * TICK_NS, WRITE_1_TICKS.low * TICK_NS,
+                                   (WRITE_0_TICKS.low + WRITE_0_TICKS.high) * TICK_NS) &&
+                  WRITE_0_TICKS.low + WRITE_0_TICKS.high == WRITE_1_TICKS.low + WRITE_1_TICKS.high,
+                  "RMT write slots out of spec");
+    static_assert(IsValidReadSlot(READ_TICKS.low * TICK_NS, READ_SAMPLE_TICKS * TICK_NS, (READ_TICKS.low + READ_TICKS.high) * TICK_NS),
+                  "RMT read slot out of spec");
+    static_assert(RX_IDLE_TICKS > WRITE_1_TICKS.high && RX_IDLE_TICKS > READ_TICKS.high && RX_RESET_IDLE_TICKS > RESET_TICKS.low,
+                  "RMT capture would end inside a slot");
+
+    rmt_item32_t MakeItem(const SlotTicks& slot) {
+        rmt_item32_t item = {};
+        item.level0 = 0;
+        item.duration0 = slot.low;
+        item.level1 = 1;
+        item.duration1 = slot.high;
+        return item;
+    }
+
+    const rmt_item32_t WRITE_0_SLOT = MakeItem(WRITE_0_TICKS);
+    const rmt_item32_t WRITE_1_SLOT = MakeItem(WRITE_1_TICKS);
+    const rmt_item32_t READ_SLOT = MakeItem(READ_TICKS);
+}
+
+OneWireRmtBackend::OneWireRmtBackend(gpio_num_t pin) : _pin(pin),
+                                                       _tx_channel(RMT_CHANNEL_MAX),
+                                                       _rx_channel(RMT_CHANNEL_MAX)
+{
+    const int first_channel = s_next_channel.fetch_add(2);
+    if (first_channel + 1 >= RMT_CHANNEL_MAX) {
+        ESP_LOGE(TAG, "No free RMT channels for pin %d", pin);
+        return;
+    }
+    _tx_channel = static_cast<rmt_channel_t>(first_channel);
+    _rx_channel = static_cast<rmt_channel_t>(first_channel + 1);
+
+    _is_valid = Init();
+    if (!_is_valid) {
+        ESP_LOGE(TAG, "Failed to set up RMT channels %d/%d for pin %d", _tx_channel, _rx_channel, pin);
+    }
+}
+
+OneWireRmtBackend::~OneWireRmtBackend()
+{
+    if (_is_valid) {
+        rmt_driver_uninstall(_tx_channel);
+        rmt_driver_uninstall(_rx_channel);
+    }
+}
+
+bool OneWireRmtBackend::Init()
+{
+    rmt_config_t tx_config = {};
+    tx_config.rmt_mode = RMT_MODE_TX;
+    tx_config.channel = _tx_channel;
+    tx_config.gpio_num = _pin;
+    tx_config.clk_div = RMT_CLK_DIV;
+    tx_config.mem_block_num = 1;
+    tx_config.tx_config.loop_en = false;
+    tx_config.tx_config.carrier_en = false;
+    tx_config.tx_config.idle_level = RMT_IDLE_LEVEL_HIGH;
+    tx_config.tx_config.idle_output_en = true;
+
+    if (rmt_config(&tx_config) != ESP_OK || rmt_driver_install(_tx_channel, 0, 0) != ESP_OK) {
+        return false;
+    }
+
+    rmt_config_t rx_config = {};
+    rx_config.rmt_mode = RMT_MODE_RX;
+    rx_config.channel = _rx_channel;
+    rx_config.gpio_num = _pin;
+    rx_config.clk_div = RMT_CLK_DIV;
+    rx_config.mem_block_num = 1;
+    rx_config.rx_config.filter_en = true;
+    rx_config.rx_config.filter_ticks_thresh = RX_FILTER_TICKS;
+    rx_config.rx_config.idle_threshold = RX_IDLE_TICKS;
+
+    if (rmt_config(&rx_config) != ESP_OK || rmt_driver_install(_rx_channel, RX_BUFFER_SIZE, 0) != ESP_OK) {
+        rmt_driver_uninstall(_tx_channel);
+        return false;
+    }
+    rmt_get_ringbuf_handle(_rx_channel, &_rx_buffer);
+
+    // rmt_config leaves the pin as a plain input, turn it back into an open drain output so both channels share it
+    gpio_set_direction(_pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode(_pin, GPIO_PULLUP_ONLY);
+    return _rx_buffer != nullptr;
+}
+
+bool OneWireRmtBackend::Reset()
+{
+    const rmt_item32_t reset_pulse = MakeItem(RESET_TICKS);
+
+    // The reset pulse itself is longer than the idle threshold used for slots
+    rmt_set_rx_idle_thresh(_rx_channel, RX_RESET_IDLE_TICKS);
+    rmt_rx_start(_rx_channel, true);
+    rmt_write_items(_tx_channel, &reset_pulse, 1, true);
+
+    bool is_present = false;
+    size_t rx_size = 0;
+    auto* rx_items = static_cast<rmt_item32_t*>(xRingbufferReceive(_rx_buffer, &rx_size, RX_TIMEOUT));
+    if (rx_items != nullptr) {
+        const size_t item_count = rx_size / sizeof(rmt_item32_t);
+        // First item is our own reset pulse, a device answers with a second low pulse shortly after
+        is_present = item_count >= 2 &&
+                     rx_items[0].level0 == 0 && rx_items[0].duration0 >= UsToTicks(RESET_LOW_MIN_US) &&
+                     rx_items[1].level0 == 0 && rx_items[1].duration0 > 0;
+        vRingbufferReturnItem(_rx_buffer, rx_items);
+    }
+
+    rmt_rx_stop(_rx_channel);
+    rmt_set_rx_idle_thresh(_rx_channel, RX_IDLE_TICKS);
+    return is_present;
+}
+
+void OneWireRmtBackend::WriteBit(bool to_write)
+{
+    rmt_write_items(_tx_channel, to_write ? &WRITE_1_SLOT : &WRITE_0_SLOT, 1, true);
+}
+
+bool OneWireRmtBackend::ReadBit()
+{
+    uint8_t bits = 0;
+    ReadSlots(&READ_SLOT, 1, bits);
+    return bits & 1;
+}
+
+void OneWireRmtBackend::WriteByte(uint8_t to_write)
+{
+    rmt_item32_t slots[8];
+    for (int i = 0; i < 8; i++) {
+        slots[i] = (to_write & (1 << i)) ? WRITE_1_SLOT : WRITE_0_SLOT;
+    }
+    rmt_write_items(_tx_channel, slots, 8, true);
+}
+
+uint8_t OneWireRmtBackend::ReadByte()
+{
+    rmt_item32_t slots[8];
+    for (auto& slot : slots) {
+        slot = READ_SLOT;
+    }
+    uint8_t bits = 0xFF;
+    ReadSlots(slots, 8, bits);
+    return bits;
+}
+
+bool OneWireRmtBackend::ReadSlots(const rmt_item32_t* slots, size_t count, uint8_t& bits)
+{
+    rmt_rx_start(_rx_channel, true);
+    rmt_write_items(_tx_channel, slots, count, true);
+
+    size_t rx_size = 0;
+    auto* rx_items = static_cast<rmt_item32_t*>(xRingbufferReceive(_rx_buffer, &rx_size, RX_TIMEOUT));
+    rmt_rx_stop(_rx_channel);
+    if (rx_items == nullptr) {
+        ESP_LOGE(TAG, "Timed out capturing read slots");
+        return false;
+    }
+
+    const size_t item_count = rx_size / sizeof(rmt_item32_t);
+    const bool is_complete = item_count >= count;
+    bits = 0;
+    for (size_t i = 0; i < count && i < item_count; i++) {
+        // A device sending a 0 stretches our short low pulse past the sample point
+        if (rx_items[i].level0 == 0 && rx_items[i].duration0 <= READ_SAMPLE_TICKS) {
+            bits |= (1 << i);
+        }
+    }
+    vRingbufferReturnItem(_rx_buffer, rx_items);
+    return is_complete;
+}
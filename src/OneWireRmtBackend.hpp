@@ -0,0 +1,34 @@
+#pragma once
+
+#include "driver/gpio.h"
+#include "driver/rmt.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/ringbuf.h"
+
+#include "OneWireBackend.hpp"
+
+// Drives the bus with a pair of RMT channels sharing one open-drain pin. Slots are
+// clocked out and captured by the peripheral, the calling task blocks on the RMT
+// interrupt instead of spinning.
+class OneWireRmtBackend : public OneWireBackend {
+    gpio_num_t _pin;
+    rmt_channel_t _tx_channel;
+    rmt_channel_t _rx_channel;
+    RingbufHandle_t _rx_buffer = nullptr;
+    bool _is_valid = false;
+
+    bool Init();
+    // Clocks out the given read slots and returns the captured line, one bit per slot
+    bool ReadSlots(const rmt_item32_t* slots, size_t count, uint8_t& bits);
+public:
+    explicit OneWireRmtBackend(gpio_num_t pin);
+    ~OneWireRmtBackend() override;
+
+    [[nodiscard]] bool IsValid() const override { return _is_valid; }
+
+    bool Reset() override;
+    void WriteBit(bool to_write) override;
+    bool ReadBit() override;
+    void WriteByte(uint8_t to_write) override;
+    uint8_t ReadByte() override;
+};
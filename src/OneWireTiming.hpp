@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+// Standard speed 1-Wire slot timings, in microseconds. Every OneWireBackend derives its
+// waveform from these so the bus looks the same regardless of which peripheral drives it.
+namespace OneWireTiming {
+    // Nominal values
+    constexpr uint32_t RESET_LOW_US = 500;
+    constexpr uint32_t PRESENCE_WAIT_US = 50; // After releasing the reset pulse, before looking for presence
+    constexpr uint32_t PRESENCE_TIMEOUT_US = 500;
+    constexpr uint32_t RESET_SLOT_US = 500; // Release time after the reset pulse, covers the whole presence window
+    constexpr uint32_t WRITE_0_LOW_US = 70;
+    constexpr uint32_t WRITE_1_LOW_US = 6;
+    constexpr uint32_t READ_LOW_US = 3;
+    constexpr uint32_t READ_SAMPLE_US = 10; // From the start of the slot
+    constexpr uint32_t SLOT_US = 80;
+    constexpr uint32_t RECOVERY_US = 5;
+
+    // Limits from the DS18B20 datasheet
+    constexpr uint32_t RESET_LOW_MIN_US = 480;
+    constexpr uint32_t WRITE_0_LOW_MIN_US = 60;
+    constexpr uint32_t WRITE_0_LOW_MAX_US = 120;
+    constexpr uint32_t WRITE_1_LOW_MIN_US = 1;
+    constexpr uint32_t WRITE_1_LOW_MAX_US = 15;
+    constexpr uint32_t READ_SAMPLE_MAX_US = 15;
+    constexpr uint32_t SLOT_MIN_US = 60;
+    constexpr uint32_t SLOT_MAX_US = 120;
+
+    // Backends that cannot hit the nominal values exactly (e.g. baud rate derived slots) check
+    // their effective timings with these, in nanoseconds
+    constexpr bool IsValidReset(uint64_t low_ns) {
+        return low_ns >= RESET_LOW_MIN_US * 1000ULL;
+    }
+
+    constexpr bool IsValidWriteSlot(uint64_t low_0_ns, uint64_t low_1_ns, uint64_t slot_ns) {
+        return low_0_ns >= WRITE_0_LOW_MIN_US * 1000ULL && low_0_ns <= WRITE_0_LOW_MAX_US * 1000ULL &&
+               low_1_ns >= WRITE_1_LOW_MIN_US * 1000ULL && low_1_ns <= WRITE_1_LOW_MAX_US * 1000ULL &&
+               slot_ns >= SLOT_MIN_US * 1000ULL && slot_ns <= SLOT_MAX_US * 1000ULL;
+    }
+
+    constexpr bool IsValidReadSlot(uint64_t low_ns, uint64_t sample_ns, uint64_t slot_ns) {
+        return low_ns >= WRITE_1_LOW_MIN_US * 1000ULL && low_ns < sample_ns &&
+               sample_ns <= READ_SAMPLE_MAX_US * 1000ULL &&
+               slot_ns >= SLOT_MIN_US * 1000ULL && slot_ns <= SLOT_MAX_US * 1000ULL;
+    }
+
+    static_assert(IsValidReset(RESET_LOW_US * 1000ULL), "Nominal reset pulse out of spec");
+    static_assert(IsValidWriteSlot(WRITE_0_LOW_US * 1000ULL, WRITE_1_LOW_US * 1000ULL, SLOT_US * 1000ULL), "Nominal write slot out of spec");
+    static_assert(IsValidReadSlot(READ_LOW_US * 1000ULL, READ_SAMPLE_US * 1000ULL, SLOT_US * 1000ULL), "Nominal read slot out of spec");
+}
@@ -0,0 +1,147 @@
+#include "OneWireUartBackend.hpp"
+
+#include <atomic>
+
+#include "esp_log.h"
+
+#include "OneWireTiming.hpp"
+
+static const char* TAG = "OneWireUart";
+
+static constexpr uint32_t SLOT_BAUD = 115200;
+static constexpr uint32_t RESET_BAUD = 9600;
+static constexpr uint8_t RESET_FRAME = 0xF0; // Start bit + 4 low data bits form the reset pulse
+static constexpr uint8_t WRITE_0_FRAME = 0x00; // Start bit + 8 low data bits
+static constexpr uint8_t WRITE_1_FRAME = 0xFF; // Start bit only, also used as the read slot
+static constexpr int RX_BUFFER_SIZE = 256; // Must be larger than the hardware FIFO
+static constexpr TickType_t RX_TIMEOUT = pdMS_TO_TICKS(10);
+
+// UART0 is the console
+static std::atomic<int> s_next_port(UART_NUM_1);
+
+namespace {
+    constexpr uint64_t BitNs(uint32_t baud) {
+        return 1000000000ULL / baud;
+    }
+}
+
+// The slot waveform is fixed by the baud rate, check that it lands inside the same windows as the other backends.
+// The UART samples the first data bit at its centre, 1.5 bit times after the falling edge.
+static_assert(OneWireTiming::IsValidWriteSlot(9 * BitNs(SLOT_BAUD), BitNs(SLOT_BAUD), 10 * BitNs(SLOT_BAUD)), "UART write slot out of spec");
+static_assert(OneWireTiming::IsValidReadSlot(BitNs(SLOT_BAUD), 3 * BitNs(SLOT_BAUD) / 2, 10 * BitNs(SLOT_BAUD)), "UART read slot out of spec");
+static_assert(OneWireTiming::IsValidReset(5 * BitNs(RESET_BAUD)), "UART reset pulse out of spec");
+
+OneWireUartBackend::OneWireUartBackend(gpio_num_t pin) : _pin(pin), _port(UART_NUM_MAX)
+{
+    const int port = s_next_port.fetch_add(1);
+    if (port >= UART_NUM_MAX) {
+        ESP_LOGE(TAG, "No free UART for pin %d", pin);
+        return;
+    }
+    _port = static_cast<uart_port_t>(port);
+
+    _is_valid = Init();
+    if (!_is_valid) {
+        ESP_LOGE(TAG, "Failed to set up UART %d for pin %d", _port, pin);
+    }
+}
+
+OneWireUartBackend::~OneWireUartBackend()
+{
+    if (_is_valid) {
+        uart_driver_delete(_port);
+    }
+}
+
+bool OneWireUartBackend::Init()
+{
+    uart_config_t config = {};
+    config.baud_rate = SLOT_BAUD;
+    config.data_bits = UART_DATA_8_BITS;
+    config.parity = UART_PARITY_DISABLE;
+    config.stop_bits = UART_STOP_BITS_1;
+    config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    config.source_clk = UART_SCLK_APB;
+
+    if (uart_driver_install(_port, RX_BUFFER_SIZE, 0, 0, nullptr, 0) != ESP_OK) {
+        return false;
+    }
+
+    if (uart_param_config(_port, &config) != ESP_OK ||
+        uart_set_pin(_port, _pin, _pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK) {
+        uart_driver_delete(_port);
+        return false;
+    }
+
+    // uart_set_pin leaves the shared pin as an input, TX keeps its route through the GPIO matrix
+    gpio_set_direction(_pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode(_pin, GPIO_PULLUP_ONLY);
+    return true;
+}
+
+bool OneWireUartBackend::Transfer(const uint8_t* tx, uint8_t* rx, size_t size)
+{
+    uart_flush_input(_port);
+    uart_write_bytes(_port, reinterpret_cast<const char*>(tx), size);
+    const int read = uart_read_bytes(_port, rx, size, RX_TIMEOUT);
+    if (read != static_cast<int>(size)) {
+        ESP_LOGE(TAG, "Only got %d of %d slots back", read, static_cast<int>(size));
+        return false;
+    }
+    return true;
+}
+
+bool OneWireUartBackend::Reset()
+{
+    uint8_t rx = RESET_FRAME;
+
+    uart_set_baudrate(_port, RESET_BAUD);
+    const bool is_complete = Transfer(&RESET_FRAME, &rx, 1);
+    uart_set_baudrate(_port, SLOT_BAUD);
+
+    // A presence pulse pulls some of the high data bits low. All zeroes means the line is stuck.
+    return is_complete && rx != RESET_FRAME && rx != 0x00;
+}
+
+void OneWireUartBackend::WriteBit(bool to_write)
+{
+    uint8_t rx;
+    Transfer(to_write ? &WRITE_1_FRAME : &WRITE_0_FRAME, &rx, 1);
+}
+
+bool OneWireUartBackend::ReadBit()
+{
+    uint8_t rx = 0;
+    Transfer(&WRITE_1_FRAME, &rx, 1);
+    return rx == WRITE_1_FRAME;
+}
+
+void OneWireUartBackend::WriteByte(uint8_t to_write)
+{
+    uint8_t tx[8];
+    uint8_t rx[8];
+    for (int i = 0; i < 8; i++) {
+        tx[i] = (to_write & (1 << i)) ? WRITE_1_FRAME : WRITE_0_FRAME;
+    }
+    Transfer(tx, rx, 8);
+}
+
+uint8_t OneWireUartBackend::ReadByte()
+{
+    uint8_t tx[8];
+    uint8_t rx[8] = {};
+    for (auto& frame : tx) {
+        frame = WRITE_1_FRAME;
+    }
+    if (!Transfer(tx, rx, 8)) {
+        return 0xFF;
+    }
+
+    uint8_t ret_byte = 0;
+    for (int i = 0; i < 8; i++) {
+        if (rx[i] == WRITE_1_FRAME) {
+            ret_byte |= (1 << i);
+        }
+    }
+    return ret_byte;
+}
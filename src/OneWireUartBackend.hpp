@@ -0,0 +1,30 @@
+#pragma once
+
+#include "driver/gpio.h"
+#include "driver/uart.h"
+
+#include "OneWireBackend.hpp"
+
+// Generates slots with a UART whose TX and RX share one open-drain pin. Each UART
+// frame is one 1-Wire slot: the start bit is the low pulse, and the echoed byte tells
+// whether a device held the line. Reset runs the same trick at a lower baud rate.
+class OneWireUartBackend : public OneWireBackend {
+    gpio_num_t _pin;
+    uart_port_t _port;
+    bool _is_valid = false;
+
+    bool Init();
+    // Sends the frames and reads back what was actually on the line
+    bool Transfer(const uint8_t* tx, uint8_t* rx, size_t size);
+public:
+    explicit OneWireUartBackend(gpio_num_t pin);
+    ~OneWireUartBackend() override;
+
+    [[nodiscard]] bool IsValid() const override { return _is_valid; }
+
+    bool Reset() override;
+    void WriteBit(bool to_write) override;
+    bool ReadBit() override;
+    void WriteByte(uint8_t to_write) override;
+    uint8_t ReadByte() override;
+};
@@ -0,0 +1,40 @@
+#include "PartitionFlashStorage.hpp"
+
+#include "esp_log.h"
+
+static const char* TAG = "PartitionFlashStorage";
+
+PartitionFlashStorage::PartitionFlashStorage(const char* label) : _partition(esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label))
+{
+    if (_partition == nullptr) {
+        ESP_LOGE(TAG, "No data partition named %s", label);
+    }
+}
+
+size_t PartitionFlashStorage::GetSize() const
+{
+    return _partition != nullptr ? _partition->size : 0;
+}
+
+bool PartitionFlashStorage::Read(size_t offset, void* data, size_t size)
+{
+    return esp_partition_read(_partition, offset, data, size) == ESP_OK;
+}
+
+bool PartitionFlashStorage::Write(size_t offset, const void* data, size_t size)
+{
+    const auto result = esp_partition_write(_partition, offset, data, size);
+    if (result != ESP_OK) {
+        ESP_LOGE(TAG, "Write of %d bytes at %x failed: %d", static_cast<int>(size), static_cast<unsigned>(offset), result);
+    }
+    return result == ESP_OK;
+}
+
+bool PartitionFlashStorage::EraseSector(size_t offset)
+{
+    const auto result = esp_partition_erase_range(_partition, offset, SECTOR_SIZE);
+    if (result != ESP_OK) {
+        ESP_LOGE(TAG, "Erase at %x failed: %d", static_cast<unsigned>(offset), result);
+    }
+    return result == ESP_OK;
+}
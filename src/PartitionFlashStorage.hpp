@@ -0,0 +1,19 @@
+#pragma once
+
+#include "esp_partition.h"
+
+#include "FlashStorage.hpp"
+
+// A data partition from partitions.csv
+class PartitionFlashStorage : public FlashStorage {
+    const esp_partition_t* _partition;
+public:
+    explicit PartitionFlashStorage(const char* label);
+
+    [[nodiscard]] bool IsValid() const override { return _partition != nullptr; }
+    [[nodiscard]] size_t GetSize() const override;
+
+    bool Read(size_t offset, void* data, size_t size) override;
+    bool Write(size_t offset, const void* data, size_t size) override;
+    bool EraseSector(size_t offset) override;
+};
@@ -0,0 +1,208 @@
+#include "SampleCodec.hpp"
+
+#include <algorithm>
+
+// Timestamp delta-of-delta codes, by number of leading 1s: 0, '10' + 7 bits, '110' + 9, '1110' + 12, '1111' + 64
+static constexpr int TIMESTAMP_PAYLOAD_BITS[] = {0, 7, 9, 12, 64};
+static constexpr int TIMESTAMP_MAX_PREFIX = 4;
+// Value delta codes: 0, '10' + 4 bits, '110' + 8, '111' + 17
+static constexpr int VALUE_PAYLOAD_BITS[] = {0, 4, 8, 17};
+static constexpr int VALUE_MAX_PREFIX = 3;
+
+static constexpr int FIRST_TIMESTAMP_BITS = 64;
+static constexpr int FIRST_VALUE_BITS = 16;
+
+static uint64_t ZigZag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t UnZigZag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Picks the shortest code whose payload holds the zigzagged value, returns the prefix length
+template <size_t N>
+static int SelectCode(uint64_t zigzag, const int (&payload_bits)[N])
+{
+    if (zigzag == 0) {
+        return 0;
+    }
+    for (size_t i = 1; i + 1 < N; i++) {
+        if (zigzag < (1ULL << payload_bits[i])) {
+            return static_cast<int>(i);
+        }
+    }
+    return N - 1;
+}
+
+// The longest prefix has no terminating 0
+static int GetPrefixBits(int prefix, int max_prefix)
+{
+    return prefix < max_prefix ? prefix + 1 : prefix;
+}
+
+SampleEncoder::SampleEncoder()
+{
+    Reset();
+}
+
+void SampleEncoder::Reset()
+{
+    _block.sample_count = 0;
+    _block.bit_count = 0;
+    _block.data.fill(0);
+    _last_timestamp = 0;
+    _last_delta = 0;
+    _last_value = 0;
+}
+
+void SampleEncoder::WriteBits(uint64_t bits, int count)
+{
+    // MSB first, a byte at a time
+    while (count > 0) {
+        const int bit_offset = _block.bit_count % 8;
+        const int chunk = std::min(count, 8 - bit_offset);
+        const auto chunk_bits = static_cast<uint8_t>((bits >> (count - chunk)) & ((1U << chunk) - 1));
+        _block.data[_block.bit_count / 8] |= chunk_bits << (8 - bit_offset - chunk);
+        _block.bit_count += chunk;
+        count -= chunk;
+    }
+}
+
+bool SampleEncoder::Append(int64_t timestamp, int16_t value)
+{
+    constexpr int CAPACITY_BITS = SampleBlock::SIZE * 8;
+
+    if (_block.sample_count == 0) {
+        if (_block.bit_count + FIRST_TIMESTAMP_BITS + FIRST_VALUE_BITS > CAPACITY_BITS) {
+            return false;
+        }
+        WriteBits(static_cast<uint64_t>(timestamp), FIRST_TIMESTAMP_BITS);
+        WriteBits(static_cast<uint16_t>(value), FIRST_VALUE_BITS);
+        _last_timestamp = timestamp;
+        _last_delta = 0;
+        _last_value = value;
+        ++_block.sample_count;
+        return true;
+    }
+
+    const int64_t delta = timestamp - _last_timestamp;
+    const uint64_t timestamp_zigzag = ZigZag(delta - _last_delta);
+    const uint64_t value_zigzag = ZigZag(static_cast<int32_t>(value) - _last_value);
+
+    const int timestamp_prefix = SelectCode(timestamp_zigzag, TIMESTAMP_PAYLOAD_BITS);
+    const int value_prefix = SelectCode(value_zigzag, VALUE_PAYLOAD_BITS);
+    const int timestamp_bits = GetPrefixBits(timestamp_prefix, TIMESTAMP_MAX_PREFIX) + TIMESTAMP_PAYLOAD_BITS[timestamp_prefix];
+    const int value_bits = GetPrefixBits(value_prefix, VALUE_MAX_PREFIX) + VALUE_PAYLOAD_BITS[value_prefix];
+    if (_block.bit_count + timestamp_bits + value_bits > CAPACITY_BITS) {
+        return false;
+    }
+
+    // Prefix of 1s, then a 0 unless it is the longest
+    WriteBits((1ULL << timestamp_prefix) - 1, timestamp_prefix);
+    if (timestamp_prefix < TIMESTAMP_MAX_PREFIX) {
+        WriteBits(0, 1);
+    }
+    WriteBits(timestamp_zigzag, TIMESTAMP_PAYLOAD_BITS[timestamp_prefix]);
+
+    WriteBits((1ULL << value_prefix) - 1, value_prefix);
+    if (value_prefix < VALUE_MAX_PREFIX) {
+        WriteBits(0, 1);
+    }
+    WriteBits(value_zigzag, VALUE_PAYLOAD_BITS[value_prefix]);
+
+    _last_timestamp = timestamp;
+    _last_delta = delta;
+    _last_value = value;
+    ++_block.sample_count;
+    return true;
+}
+
+SampleDecoder::SampleDecoder(const SampleBlock& block) : _block(block)
+{
+
+}
+
+bool SampleDecoder::ReadBits(int count, uint64_t& bits)
+{
+    if (_bit_position + count > std::min<size_t>(_block.bit_count, SampleBlock::SIZE * 8)) {
+        return false;
+    }
+
+    bits = 0;
+    while (count > 0) {
+        const int bit_offset = _bit_position % 8;
+        const int chunk = std::min(count, 8 - bit_offset);
+        const uint8_t byte = _block.data[_bit_position / 8];
+        bits = (bits << chunk) | ((byte >> (8 - bit_offset - chunk)) & ((1U << chunk) - 1));
+        _bit_position += chunk;
+        count -= chunk;
+    }
+    return true;
+}
+
+bool SampleDecoder::ReadPrefix(int max, int& ones)
+{
+    ones = 0;
+    while (ones < max) {
+        uint64_t bit;
+        if (!ReadBits(1, bit)) {
+            return false;
+        }
+        if (bit == 0) {
+            break;
+        }
+        ++ones;
+    }
+    return true;
+}
+
+bool SampleDecoder::Next(Sample& sample)
+{
+    if (_decoded_count >= _block.sample_count) {
+        return false;
+    }
+
+    uint64_t bits;
+    if (_decoded_count == 0) {
+        if (!ReadBits(FIRST_TIMESTAMP_BITS, bits)) {
+            return false;
+        }
+        _last_timestamp = static_cast<int64_t>(bits);
+        if (!ReadBits(FIRST_VALUE_BITS, bits)) {
+            return false;
+        }
+        _last_value = static_cast<int16_t>(bits);
+        _last_delta = 0;
+    } else {
+        int prefix;
+        if (!ReadPrefix(TIMESTAMP_MAX_PREFIX, prefix) || !ReadBits(TIMESTAMP_PAYLOAD_BITS[prefix], bits)) {
+            return false;
+        }
+        _last_delta += UnZigZag(bits);
+        _last_timestamp += _last_delta;
+
+        if (!ReadPrefix(VALUE_MAX_PREFIX, prefix) || !ReadBits(VALUE_PAYLOAD_BITS[prefix], bits)) {
+            return false;
+        }
+        _last_value = static_cast<int16_t>(_last_value + UnZigZag(bits));
+    }
+
+    ++_decoded_count;
+    sample = {_last_timestamp, _last_value};
+    return true;
+}
+
+bool SampleDecoder::DecodeBlock(const SampleBlock& block, std::vector<Sample>& samples)
+{
+    SampleDecoder decoder(block);
+    samples.reserve(samples.size() + block.sample_count);
+
+    Sample sample;
+    while (decoder.Next(sample)) {
+        samples.push_back(sample);
+    }
+    return decoder._decoded_count == block.sample_count;
+}
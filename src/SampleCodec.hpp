@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Gorilla style compression for (timestamp, raw temperature) pairs. Timestamps are stored as
+// the change in their spacing and values as the change from the previous value, both in
+// variable length codes, so a steady 1Hz series of a slowly moving temperature costs a few bits
+// a sample instead of 80. Samples go into fixed size blocks that decode on their own.
+struct SampleBlock {
+    static constexpr size_t SIZE = 256;
+
+    uint16_t sample_count = 0;
+    uint16_t bit_count = 0;
+    std::array<uint8_t, SIZE> data;
+};
+
+class SampleEncoder {
+    SampleBlock _block;
+    int64_t _last_timestamp = 0;
+    int64_t _last_delta = 0;
+    int16_t _last_value = 0;
+
+    void WriteBits(uint64_t bits, int count);
+public:
+    SampleEncoder();
+
+    // Starts a new, empty block
+    void Reset();
+
+    // Constant time. False if the sample doesn't fit, the block is left as it was.
+    bool Append(int64_t timestamp, int16_t value);
+
+    [[nodiscard]] const SampleBlock& GetBlock() const { return _block; }
+    [[nodiscard]] bool IsEmpty() const { return _block.sample_count == 0; }
+};
+
+class SampleDecoder {
+public:
+    struct Sample {
+        int64_t timestamp;
+        int16_t value;
+    };
+private:
+    const SampleBlock& _block;
+    size_t _bit_position = 0;
+    uint16_t _decoded_count = 0;
+    int64_t _last_timestamp = 0;
+    int64_t _last_delta = 0;
+    int16_t _last_value = 0;
+
+    bool ReadBits(int count, uint64_t& bits);
+    // Number of leading 1 bits, up to max
+    bool ReadPrefix(int max, int& ones);
+public:
+    explicit SampleDecoder(const SampleBlock& block);
+
+    // False once every sample was read, or if the block is corrupt
+    bool Next(Sample& sample);
+
+    // Appends every sample in the block, returns false if it was corrupt
+    static bool DecodeBlock(const SampleBlock& block, std::vector<Sample>& samples);
+};
@@ -0,0 +1,371 @@
+#include "SampleLog.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "esp_log.h"
+
+
+static const char* TAG = "SampleLog";
+
+static constexpr uint32_t SECTOR_MAGIC = 0x474F4C59; // "YLOG"
+// Records read from flash in one go by Read
+static constexpr size_t READ_BATCH_SIZE = 16;
+
+SampleLog::SampleLog(const std::shared_ptr<FlashStorage>& storage) : _storage(storage)
+{
+
+}
+
+size_t SampleLog::GetRecordOffset(size_t sector, size_t slot) const
+{
+    return sector * FlashStorage::SECTOR_SIZE + sizeof(SectorHeader) + slot * sizeof(Record);
+}
+
+bool SampleLog::ReadHeader(size_t sector, SectorHeader& header)
+{
+    if (!_storage->Read(sector * FlashStorage::SECTOR_SIZE, &header, sizeof(header))) {
+        return false;
+    }
+    return header.magic == SECTOR_MAGIC && header.sequence == ~header.sequence_inverse;
+}
+
+bool SampleLog::StartSector(size_t sector, uint32_t sequence)
+{
+    // Power loss in between leaves a sector without a header, which the next boot skips and erases again
+    if (!_storage->EraseSector(sector * FlashStorage::SECTOR_SIZE)) {
+        return false;
+    }
+
+    const SectorHeader header = {SECTOR_MAGIC, sequence, ~sequence, 0xFFFFFFFF};
+    if (!_storage->Write(sector * FlashStorage::SECTOR_SIZE, &header, sizeof(header))) {
+        return false;
+    }
+
+    _head_sector = sector;
+    _head_sequence = sequence;
+    _next_record = 0;
+    return true;
+}
+
+size_t SampleLog::FindFirstEmptyRecord(size_t sector)
+{
+    // Records are written in order, so the written ones form a prefix. A torn record still isn't empty.
+    size_t low = 0;
+    size_t high = RECORDS_PER_SECTOR;
+    while (low < high) {
+        const size_t mid = (low + high) / 2;
+        Record record;
+        if (!_storage->Read(GetRecordOffset(sector, mid), &record, sizeof(record)) || !IsEmpty(record)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool SampleLog::FindLastRecord(Record& record)
+{
+    // The head sector may have just been started, then the newest record is at the end of the previous one
+    size_t sector = _head_sector;
+    size_t end = _next_record;
+    for (int sectors_left = 2; sectors_left > 0; sectors_left--) {
+        while (end > 0) {
+            --end;
+            if (_storage->Read(GetRecordOffset(sector, end), &record, sizeof(record)) && IsValid(record)) {
+                return true;
+            }
+        }
+
+        sector = (sector + _sector_count - 1) % _sector_count;
+        SectorHeader header;
+        if (!ReadHeader(sector, header) || header.sequence != _head_sequence - 1) {
+            return false;
+        }
+        end = RECORDS_PER_SECTOR;
+    }
+    return false;
+}
+
+bool SampleLog::Open(int64_t now_us)
+{
+    std::lock_guard<decltype(_lock)> lock(_lock);
+    if (!_storage->IsValid()) {
+        return false;
+    }
+
+    _sector_count = _storage->GetSize() / FlashStorage::SECTOR_SIZE;
+    if (_sector_count < 2) {
+        ESP_LOGE(TAG, "Storage too small for a log");
+        return false;
+    }
+
+    bool has_head = false;
+    for (size_t sector = 0; sector < _sector_count; sector++) {
+        SectorHeader header;
+        if (ReadHeader(sector, header) && (!has_head || header.sequence > _head_sequence)) {
+            has_head = true;
+            _head_sector = sector;
+            _head_sequence = header.sequence;
+        }
+    }
+
+    const int64_t now_s = now_us / 1000000;
+    if (!has_head) {
+        ESP_LOGI(TAG, "No log found, formatting");
+        if (!StartSector(0, 1)) {
+            return false;
+        }
+        _has_records = false;
+        _time_offset_s = 0;
+        _is_open = true;
+        return true;
+    }
+
+    _next_record = FindFirstEmptyRecord(_head_sector);
+
+    Record last_record;
+    _has_records = FindLastRecord(last_record);
+    if (_has_records) {
+        _last_log_time_s = last_record.log_time_s;
+        // Unknown downtime, carry on right after the last record
+        _time_offset_s = static_cast<int64_t>(_last_log_time_s) + 1 - now_s;
+    } else {
+        _time_offset_s = 0;
+    }
+
+    ESP_LOGI(TAG, "Log head in sector %d (sequence %u), record %d", static_cast<int>(_head_sector), _head_sequence,
+             static_cast<int>(_next_record));
+    _is_open = true;
+    return true;
+}
+
+bool SampleLog::Append(int64_t timestamp_us, Temperature temperature)
+{
+    std::lock_guard<decltype(_lock)> lock(_lock);
+    if (!_is_open) {
+        return false;
+    }
+
+    if (!temperature.IsValid()) {
+        return true;
+    }
+
+    const int64_t log_time_s = timestamp_us / 1000000 + _time_offset_s;
+    if (log_time_s < 0 || (_has_records && log_time_s <= _last_log_time_s)) {
+        return true;
+    }
+
+    if (_next_record == RECORDS_PER_SECTOR) {
+        // Overwrites the oldest sector
+        if (!StartSector((_head_sector + 1) % _sector_count, _head_sequence + 1)) {
+            ESP_LOGE(TAG, "Could not start a new sector");
+            return false;
+        }
+    }
+
+    Record record = {static_cast<uint32_t>(log_time_s), temperature.GetSixteenths(), 0, 0};
+    record.crc = GetCrc(record);
+
+    // Skip the slot even if the write failed, it may be partially programmed
+    const size_t slot = _next_record++;
+    if (!_storage->Write(GetRecordOffset(_head_sector, slot), &record, sizeof(record))) {
+        return false;
+    }
+
+    _has_records = true;
+    _last_log_time_s = record.log_time_s;
+    return true;
+}
+
+size_t SampleLog::Replay(const ReplayCallback& callback)
+{
+    std::lock_guard<decltype(_lock)> lock(_lock);
+    if (!_is_open) {
+        return 0;
+    }
+
+    size_t replayed = 0;
+    std::vector<uint8_t> sector_data(FlashStorage::SECTOR_SIZE);
+
+    // Oldest sector first, the one after the head
+    for (size_t i = 1; i <= _sector_count; i++) {
+        const size_t sector = (_head_sector + i) % _sector_count;
+        const uint32_t expected_sequence = _head_sequence - static_cast<uint32_t>(_sector_count - i);
+        if (!_storage->Read(sector * FlashStorage::SECTOR_SIZE, sector_data.data(), sector_data.size())) {
+            continue;
+        }
+
+        SectorHeader header;
+        memcpy(&header, sector_data.data(), sizeof(header));
+        // Skips erased sectors and any left over from before the log last wrapped
+        if (header.magic != SECTOR_MAGIC || header.sequence != ~header.sequence_inverse || header.sequence != expected_sequence) {
+            continue;
+        }
+
+        for (size_t slot = 0; slot < RECORDS_PER_SECTOR; slot++) {
+            Record record;
+            memcpy(&record, sector_data.data() + sizeof(SectorHeader) + slot * sizeof(Record), sizeof(record));
+            if (IsEmpty(record)) {
+                break;
+            }
+            if (!IsValid(record)) {
+                continue;
+            }
+
+            const int64_t timestamp_s = static_cast<int64_t>(record.log_time_s) - _time_offset_s;
+            callback(timestamp_s * 1000000, Temperature::FromSixteenths(record.temperature));
+            ++replayed;
+        }
+    }
+
+    ESP_LOGI(TAG, "Replayed %d records", static_cast<int>(replayed));
+    return replayed;
+}
+
+uint32_t SampleLog::GetOldestSequence() const
+{
+    // Sequences start at 1, before the log first wrapped the older sectors were never used
+    return _head_sequence > _sector_count ? _head_sequence - static_cast<uint32_t>(_sector_count) + 1 : 1;
+}
+
+size_t SampleLog::GetSector(uint32_t sequence) const
+{
+    return (_head_sector + _sector_count - (_head_sequence - sequence)) % _sector_count;
+}
+
+bool SampleLog::ReadFirstLogTime(uint32_t sequence, uint32_t& log_time_s)
+{
+    const size_t sector = GetSector(sequence);
+    SectorHeader header;
+    if (!ReadHeader(sector, header) || header.sequence != sequence) {
+        return false;
+    }
+    const size_t end = sequence == _head_sequence ? _next_record : RECORDS_PER_SECTOR;
+    for (size_t slot = 0; slot < end; slot++) {
+        Record record;
+        if (_storage->Read(GetRecordOffset(sector, slot), &record, sizeof(record)) && IsValid(record)) {
+            log_time_s = record.log_time_s;
+            return true;
+        }
+    }
+    return false;
+}
+
+SampleLog::Cursor SampleLog::Seek(uint32_t log_time_s)
+{
+    std::lock_guard<decltype(_lock)> lock(_lock);
+    Cursor cursor;
+    cursor.first_log_time_s = log_time_s;
+    if (!_is_open) {
+        return cursor;
+    }
+
+    // Last sector whose first record isn't after log_time_s. Sectors that can't be read count as after it,
+    // which can only make Read start earlier than it needs to.
+    uint32_t low = GetOldestSequence();
+    uint32_t high = _head_sequence;
+    cursor.sector_sequence = low;
+    while (low <= high) {
+        const uint32_t middle = low + (high - low) / 2;
+        uint32_t first_log_time_s;
+        if (ReadFirstLogTime(middle, first_log_time_s) && first_log_time_s <= log_time_s) {
+            cursor.sector_sequence = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return cursor;
+}
+
+size_t SampleLog::Read(Cursor& cursor, Entry* entries, size_t max_count)
+{
+    std::lock_guard<decltype(_lock)> lock(_lock);
+    if (!_is_open) {
+        return 0;
+    }
+
+    const uint32_t oldest_sequence = GetOldestSequence();
+    if (cursor.sector_sequence < oldest_sequence) {
+        // Overwritten since the last Read, carry on with what is left
+        cursor.sector_sequence = oldest_sequence;
+        cursor.slot = 0;
+    }
+
+    size_t count = 0;
+    while (count < max_count && cursor.sector_sequence <= _head_sequence) {
+        const bool is_head = cursor.sector_sequence == _head_sequence;
+        const size_t sector = GetSector(cursor.sector_sequence);
+        const size_t end = is_head ? _next_record : RECORDS_PER_SECTOR;
+        SectorHeader header;
+        if (cursor.slot >= end || !ReadHeader(sector, header) || header.sequence != cursor.sector_sequence) {
+            if (is_head) {
+                // Caught up with Append
+                break;
+            }
+            ++cursor.sector_sequence;
+            cursor.slot = 0;
+            continue;
+        }
+
+        Record records[READ_BATCH_SIZE];
+        const size_t batch_size = std::min(READ_BATCH_SIZE, end - cursor.slot);
+        if (!_storage->Read(GetRecordOffset(sector, cursor.slot), records, batch_size * sizeof(Record))) {
+            break;
+        }
+        // Only advances past what was taken, the rest of the batch is read again next time
+        size_t i = 0;
+        for (; i < batch_size && count < max_count; i++) {
+            if (IsValid(records[i]) && records[i].log_time_s >= cursor.first_log_time_s) {
+                entries[count++] = {records[i].log_time_s, Temperature::FromSixteenths(records[i].temperature)};
+            }
+        }
+        cursor.slot += i;
+    }
+    return count;
+}
+
+int64_t SampleLog::GetTimeOffsetS()
+{
+    std::lock_guard<decltype(_lock)> lock(_lock);
+    return _time_offset_s;
+}
+
+bool SampleLog::IsEmpty(const Record& record)
+{
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&record);
+    for (size_t i = 0; i < sizeof(record); i++) {
+        if (bytes[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SampleLog::IsValid(const Record& record)
+{
+    return !IsEmpty(record) && record.crc == GetCrc(record);
+}
+
+uint8_t SampleLog::GetCrc(const Record& record)
+{
+    // CRC-8/MAXIM over everything but the CRC byte
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&record);
+    uint8_t crc = 0;
+    for (size_t i = 0; i < offsetof(Record, crc); i++) {
+        uint8_t byte = bytes[i];
+        for (int bit = 0; bit < 8; bit++) {
+            const bool mix = (crc ^ byte) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8C;
+            }
+            byte >>= 1;
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "FlashStorage.hpp"
+#include "Temperature.hpp"
+
+// Append-only temperature log in a flash partition, so history survives resets and brownouts.
+// Each sector starts with a header carrying a sequence number and holds fixed-size records with
+// their own CRC. Sectors are filled and erased round-robin, which spreads the wear evenly.
+// Opening only reads the sector headers and binary searches the newest sector for the end.
+//
+// Records are stamped on a log clock that carries on from the last record at every boot, so
+// replayed samples from before a reset come out with negative times since boot.
+class SampleLog {
+public:
+    using ReplayCallback = std::function<void(int64_t timestamp_us, Temperature temperature)>;
+
+    // A record as Read returns it. The log time is unique and increasing, so it doubles as the
+    // record's sequence number for readers picking up where they left off.
+    struct Entry {
+        uint32_t log_time_s;
+        Temperature temperature;
+    };
+
+    // Where Read carries on, from Seek
+    struct Cursor {
+        uint32_t sector_sequence = 0;
+        size_t slot = 0;
+        uint32_t first_log_time_s = 0; // Earlier records are skipped
+    };
+private:
+    struct SectorHeader {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t sequence_inverse; // ~sequence, catches torn or partial header writes
+        uint32_t reserved;
+    };
+
+    struct Record {
+        uint32_t log_time_s;
+        int16_t temperature; // 1/16 C
+        uint8_t reserved; // 0, so a written record is never all 0xFF
+        uint8_t crc;
+    };
+
+    static_assert(sizeof(SectorHeader) == 16, "Header layout is on flash");
+    static_assert(sizeof(Record) == 8, "Record layout is on flash");
+public:
+    static constexpr size_t RECORDS_PER_SECTOR = (FlashStorage::SECTOR_SIZE - sizeof(SectorHeader)) / sizeof(Record);
+private:
+    std::shared_ptr<FlashStorage> _storage;
+    std::mutex _lock;
+    bool _is_open = false;
+    size_t _sector_count = 0;
+    size_t _head_sector = 0;
+    uint32_t _head_sequence = 0;
+    size_t _next_record = 0; // Slot in the head sector
+    bool _has_records = false;
+    uint32_t _last_log_time_s = 0;
+    int64_t _time_offset_s = 0; // Log time minus time since boot
+
+    [[nodiscard]] size_t GetRecordOffset(size_t sector, size_t slot) const;
+    bool ReadHeader(size_t sector, SectorHeader& header);
+    bool StartSector(size_t sector, uint32_t sequence);
+    size_t FindFirstEmptyRecord(size_t sector);
+    bool FindLastRecord(Record& record);
+    [[nodiscard]] uint32_t GetOldestSequence() const;
+    [[nodiscard]] size_t GetSector(uint32_t sequence) const;
+    bool ReadFirstLogTime(uint32_t sequence, uint32_t& log_time_s);
+
+    static bool IsEmpty(const Record& record);
+    static bool IsValid(const Record& record);
+    static uint8_t GetCrc(const Record& record);
+public:
+    explicit SampleLog(const std::shared_ptr<FlashStorage>& storage);
+
+    // Finds the end of the log, formatting the storage if it holds no log. now_us is the current time since boot.
+    bool Open(int64_t now_us);
+
+    // Keeps at most one record per second, later samples within the same second are dropped
+    bool Append(int64_t timestamp_us, Temperature temperature);
+
+    // Calls back with every intact record, oldest first, timestamps relative to this boot. Returns the record count.
+    size_t Replay(const ReplayCallback& callback);
+
+    // Reading the log in pieces, e.g. to stream it out: the lock is only held for one Read at a time, so
+    // appends go on in between. Records overwritten before the cursor gets to them are left out.
+    // Cursor for the first record at or after log_time_s, found with a binary search over the sectors
+    Cursor Seek(uint32_t log_time_s);
+    // Copies up to max_count intact records, oldest first, and moves the cursor past them. 0 once it caught up.
+    size_t Read(Cursor& cursor, Entry* entries, size_t max_count);
+    // Log time minus time since boot, in seconds
+    [[nodiscard]] int64_t GetTimeOffsetS();
+};
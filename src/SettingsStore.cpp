@@ -0,0 +1,235 @@
+#include "SettingsStore.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "SettingsStore";
+static const char* BLOB_KEY = "settings";
+
+static constexpr uint32_t BLOB_MAGIC = 0x54455359; // "YSET"
+// Bump when the record layout changes, older blobs are then ignored
+static constexpr uint16_t BLOB_VERSION = 1;
+// Written once no change came in for this long, but never later than MAX_WRITE_DELAY_US after the first one
+static constexpr int64_t DEBOUNCE_US = 2000000;
+static constexpr int64_t MAX_WRITE_DELAY_US = 10000000;
+
+// Blob: header, then per record a name length byte, the name, a 16-bit data size and the data
+struct BlobHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_count;
+};
+
+SettingsStore::SettingsStore(const char* nvs_namespace)
+{
+    esp_err_t result;
+    _nvs_handle = nvs::open_nvs_handle(nvs_namespace, NVS_READWRITE, &result);
+    if (result != ESP_OK) {
+        ESP_LOGE(TAG, "Error opening NVS");
+        _nvs_handle = nullptr;
+    }
+    Load();
+
+    _worker = std::thread([this] {
+        this->TaskWorker();
+    });
+}
+
+SettingsStore::~SettingsStore()
+{
+    {
+        std::lock_guard<decltype(_lock)> lock(_lock);
+        _is_running = false;
+    }
+    _cv.notify_all();
+    _worker.join();
+    Flush();
+}
+
+void SettingsStore::Load()
+{
+    size_t size = 0;
+    if (!_nvs_handle || _nvs_handle->get_item_size(nvs::ItemType::BLOB, BLOB_KEY, size) != ESP_OK) {
+        ESP_LOGI(TAG, "No stored settings, using defaults");
+        return;
+    }
+
+    std::vector<uint8_t> blob(size);
+    BlobHeader header;
+    if (size < sizeof(header) || _nvs_handle->get_blob(BLOB_KEY, blob.data(), size) != ESP_OK) {
+        ESP_LOGE(TAG, "Error reading settings");
+        return;
+    }
+    memcpy(&header, blob.data(), sizeof(header));
+    if (header.magic != BLOB_MAGIC || header.version != BLOB_VERSION) {
+        ESP_LOGW(TAG, "Ignoring settings of version %d", header.version);
+        return;
+    }
+
+    size_t offset = sizeof(header);
+    for (uint16_t i = 0; i < header.record_count; i++) {
+        if (offset + 1 > size || offset + 1 + blob[offset] + sizeof(uint16_t) > size) {
+            break;
+        }
+        Record record;
+        const size_t name_length = blob[offset++];
+        record.name.assign(reinterpret_cast<const char*>(&blob[offset]), name_length);
+        offset += name_length;
+
+        uint16_t data_size;
+        memcpy(&data_size, &blob[offset], sizeof(data_size));
+        offset += sizeof(data_size);
+        if (offset + data_size > size) {
+            break;
+        }
+        record.data.assign(blob.begin() + offset, blob.begin() + offset + data_size);
+        offset += data_size;
+        _loaded.push_back(std::move(record));
+    }
+    if (_loaded.size() != header.record_count) {
+        ESP_LOGE(TAG, "Settings truncated after %d records", static_cast<int>(_loaded.size()));
+    }
+}
+
+bool SettingsStore::Find(const char* name, void* out, size_t size) const
+{
+    std::lock_guard<decltype(_lock)> lock(_lock);
+    const auto it = std::find_if(_loaded.begin(), _loaded.end(), [name](const Record& record) {
+        return record.name == name;
+    });
+    if (it == _loaded.end() || it->data.size() != size) {
+        return false;
+    }
+    memcpy(out, it->data.data(), size);
+    return true;
+}
+
+void SettingsStore::Register(const Entry* entry)
+{
+    std::lock_guard<decltype(_lock)> lock(_lock);
+    _entries.push_back(entry);
+}
+
+void SettingsStore::Unregister(const Entry* entry)
+{
+    std::lock_guard<decltype(_lock)> lock(_lock);
+    // Keep the last value as a plain record, it may still be waiting to be written
+    auto it = std::find_if(_loaded.begin(), _loaded.end(), [entry](const Record& record) {
+        return record.name == entry->GetName();
+    });
+    if (it == _loaded.end()) {
+        it = _loaded.insert(_loaded.end(), Record{entry->GetName(), {}});
+    }
+    it->data.resize(entry->GetSize());
+    entry->CopyValue(it->data.data());
+    _entries.erase(std::remove(_entries.begin(), _entries.end(), entry), _entries.end());
+}
+
+void SettingsStore::MarkDirty()
+{
+    {
+        std::lock_guard<decltype(_lock)> lock(_lock);
+        _last_change_us = esp_timer_get_time();
+        if (!_is_dirty) {
+            _is_dirty = true;
+            _first_change_us = _last_change_us;
+        }
+    }
+    _cv.notify_one();
+}
+
+std::vector<uint8_t> SettingsStore::Serialise() const
+{
+    std::vector<uint8_t> blob(sizeof(BlobHeader));
+    uint16_t record_count = 0;
+    const auto append = [&blob, &record_count](const char* name, const uint8_t* data, size_t size) {
+        const size_t name_length = std::min(strlen(name), MAX_NAME_LENGTH);
+        const auto data_size = static_cast<uint16_t>(size);
+        blob.push_back(static_cast<uint8_t>(name_length));
+        blob.insert(blob.end(), name, name + name_length);
+        blob.insert(blob.end(), reinterpret_cast<const uint8_t*>(&data_size), reinterpret_cast<const uint8_t*>(&data_size) + sizeof(data_size));
+        blob.insert(blob.end(), data, data + size);
+        ++record_count;
+    };
+
+    std::vector<uint8_t> value;
+    for (const auto* entry : _entries) {
+        value.resize(entry->GetSize());
+        entry->CopyValue(value.data());
+        append(entry->GetName(), value.data(), value.size());
+    }
+    // Keep what other firmware versions stored
+    for (const auto& record : _loaded) {
+        const bool is_registered = std::any_of(_entries.begin(), _entries.end(), [&record](const Entry* entry) {
+            return record.name == entry->GetName();
+        });
+        if (!is_registered) {
+            append(record.name.c_str(), record.data.data(), record.data.size());
+        }
+    }
+
+    const BlobHeader header = {BLOB_MAGIC, BLOB_VERSION, record_count};
+    memcpy(blob.data(), &header, sizeof(header));
+    return blob;
+}
+
+bool SettingsStore::Write(const std::vector<uint8_t>& blob)
+{
+    if (!_nvs_handle) {
+        return false;
+    }
+    if (_nvs_handle->set_blob(BLOB_KEY, blob.data(), blob.size()) != ESP_OK || _nvs_handle->commit() != ESP_OK) {
+        ESP_LOGE(TAG, "Error writing settings");
+        return false;
+    }
+    ESP_LOGI(TAG, "Wrote %d bytes of settings", static_cast<int>(blob.size()));
+    return true;
+}
+
+bool SettingsStore::Flush()
+{
+    std::vector<uint8_t> blob;
+    {
+        std::lock_guard<decltype(_lock)> lock(_lock);
+        if (!_is_dirty) {
+            return true;
+        }
+        _is_dirty = false;
+        blob = Serialise();
+    }
+    if (Write(blob)) {
+        return true;
+    }
+
+    // Try again after the debounce time, unless NVS never opened
+    if (_nvs_handle) {
+        MarkDirty();
+    }
+    return false;
+}
+
+void SettingsStore::TaskWorker()
+{
+    std::unique_lock<decltype(_lock)> lock(_lock);
+    while (_is_running) {
+        if (!_is_dirty) {
+            _cv.wait(lock);
+            continue;
+        }
+
+        const int64_t write_at_us = std::min(_last_change_us + DEBOUNCE_US, _first_change_us + MAX_WRITE_DELAY_US);
+        const int64_t now_us = esp_timer_get_time();
+        if (now_us < write_at_us) {
+            _cv.wait_for(lock, std::chrono::microseconds(write_at_us - now_us));
+            continue;
+        }
+
+        // The flash write happens outside the lock so setters never wait on it
+        lock.unlock();
+        Flush();
+        lock.lock();
+    }
+}
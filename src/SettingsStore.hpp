@@ -0,0 +1,115 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nvs.h"
+#include "nvs_handle.hpp"
+
+#include "DataBinding.hpp"
+
+// Every setting in one versioned NVS blob. It is read once at boot, values then live in RAM
+// (see PersistentValue), and changes are coalesced: the blob is written and committed from a
+// background thread once nothing changed for a short while, instead of one NVS write per value
+// on the request path.
+//
+// Records are keyed by name and size, so settings can be added or removed without a version bump;
+// records of settings this firmware doesn't know are written back untouched.
+class SettingsStore {
+public:
+    // What the store needs from a setting to write it out
+    class Entry {
+    public:
+        [[nodiscard]] virtual const char* GetName() const = 0;
+        [[nodiscard]] virtual size_t GetSize() const = 0;
+        virtual void CopyValue(void* out) const = 0;
+    protected:
+        ~Entry() = default;
+    };
+
+    static constexpr size_t MAX_NAME_LENGTH = 15; // Same as NVS keys
+private:
+    struct Record {
+        std::string name;
+        std::vector<uint8_t> data;
+    };
+
+    std::unique_ptr<nvs::NVSHandle> _nvs_handle;
+    std::vector<Record> _loaded; // As read at boot, plus unregistered entries
+
+    mutable std::mutex _lock;
+    std::condition_variable _cv;
+    std::vector<const Entry*> _entries;
+    bool _is_dirty = false;
+    int64_t _first_change_us = 0;
+    int64_t _last_change_us = 0;
+    bool _is_running = true;
+    std::thread _worker;
+
+    void Load();
+    // Serialises every entry, _lock held
+    std::vector<uint8_t> Serialise() const;
+    bool Write(const std::vector<uint8_t>& blob);
+    void TaskWorker();
+public:
+    explicit SettingsStore(const char* nvs_namespace);
+    ~SettingsStore(); // Writes pending changes
+
+    SettingsStore(const SettingsStore&) = delete;
+    SettingsStore& operator=(const SettingsStore&) = delete;
+
+    // Copies the value stored at boot into out. False if there is none of that size.
+    bool Find(const char* name, void* out, size_t size) const;
+
+    void Register(const Entry* entry);
+    void Unregister(const Entry* entry);
+
+    // Schedules a write of every entry
+    void MarkDirty();
+    // Writes pending changes now, false on NVS errors. A failed write is retried in the background.
+    bool Flush();
+};
+
+// A setting kept in RAM and persisted through a SettingsStore. Reads are lock free like any
+// DataSourceSeqLock; SetValue only marks the store dirty.
+template <typename T>
+class PersistentValue : public DataSourceSeqLock<T>, private SettingsStore::Entry {
+    std::shared_ptr<SettingsStore> _store;
+    const char* _name;
+    bool _is_loaded;
+
+    [[nodiscard]] const char* GetName() const override { return _name; }
+    [[nodiscard]] size_t GetSize() const override { return sizeof(T); }
+    void CopyValue(void* out) const override {
+        const T value = this->GetValue();
+        memcpy(out, &value, sizeof(T));
+    }
+public:
+    // name must outlive the value, e.g. a string literal
+    PersistentValue(const std::shared_ptr<SettingsStore>& store, const char* name, T default_value)
+        : DataSourceSeqLock<T>(default_value), _store(store), _name(name), _is_loaded(false) {
+        T loaded;
+        _is_loaded = _store->Find(_name, &loaded, sizeof(T));
+        if (_is_loaded) {
+            DataSourceSeqLock<T>::SetValue(loaded);
+        }
+        _store->Register(this);
+    }
+
+    ~PersistentValue() override {
+        _store->Unregister(this);
+    }
+
+    // False if the value is the default because nothing was stored yet
+    [[nodiscard]] bool IsLoaded() const { return _is_loaded; }
+
+    void SetValue(T value) override {
+        DataSourceSeqLock<T>::SetValue(value);
+        _store->MarkDirty();
+    }
+};
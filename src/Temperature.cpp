@@ -0,0 +1,132 @@
+#include "Temperature.hpp"
+
+#include <cmath>
+
+// 1/16 = 0.0625, four decimals represent every step exactly
+static constexpr int32_t FRACTION_SCALE = 10000;
+static constexpr int32_t FRACTION_PER_SIXTEENTH = FRACTION_SCALE / 16;
+static constexpr int FRACTION_DIGITS = 4;
+
+Temperature Temperature::FromFloat(float degrees)
+{
+    const long sixteenths = std::lroundf(degrees * 16.f);
+    if (sixteenths <= INVALID_SIXTEENTHS || sixteenths > std::numeric_limits<int16_t>::max()) {
+        return Invalid();
+    }
+    return Temperature(static_cast<int16_t>(sixteenths));
+}
+
+size_t Temperature::Format(char* buffer, size_t size) const
+{
+    static const char INVALID_TEXT[] = "null";
+    if (!IsValid()) {
+        if (size < sizeof(INVALID_TEXT)) {
+            return 0;
+        }
+        for (size_t i = 0; i < sizeof(INVALID_TEXT); i++) {
+            buffer[i] = INVALID_TEXT[i];
+        }
+        return sizeof(INVALID_TEXT) - 1;
+    }
+
+    // Built backwards into a scratch buffer: fraction, point, whole part, sign
+    char digits[MAX_FORMATTED_SIZE];
+    size_t length = 0;
+
+    const bool is_negative = _sixteenths < 0;
+    const int32_t magnitude = is_negative ? -static_cast<int32_t>(_sixteenths) : _sixteenths;
+    int32_t whole = magnitude >> 4;
+    int32_t fraction = (magnitude & 0x0F) * FRACTION_PER_SIXTEENTH;
+
+    if (fraction != 0) {
+        int fraction_digits = FRACTION_DIGITS;
+        while (fraction % 10 == 0) {
+            fraction /= 10;
+            --fraction_digits;
+        }
+        for (int i = 0; i < fraction_digits; i++) {
+            digits[length++] = static_cast<char>('0' + fraction % 10);
+            fraction /= 10;
+        }
+        digits[length++] = '.';
+    }
+
+    do {
+        digits[length++] = static_cast<char>('0' + whole % 10);
+        whole /= 10;
+    } while (whole > 0);
+
+    if (is_negative) {
+        digits[length++] = '-';
+    }
+
+    if (length + 1 > size) {
+        return 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+        buffer[i] = digits[length - 1 - i];
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+bool Temperature::Parse(const char* text, size_t length, Temperature& out)
+{
+    size_t position = 0;
+    const bool is_negative = position < length && text[position] == '-';
+    if (position < length && (text[position] == '-' || text[position] == '+')) {
+        ++position;
+    }
+
+    // Whole degrees, at most 4 digits fit the range
+    int32_t whole = 0;
+    int whole_digits = 0;
+    while (position < length && text[position] >= '0' && text[position] <= '9') {
+        if (++whole_digits > 4) {
+            return false;
+        }
+        whole = whole * 10 + (text[position++] - '0');
+    }
+
+    // Fraction in 1/10000, digits past the fourth only round
+    int32_t fraction = 0;
+    int fraction_digits = 0;
+    bool round_up = false;
+    if (position < length && text[position] == '.') {
+        ++position;
+        while (position < length && text[position] >= '0' && text[position] <= '9') {
+            if (fraction_digits < FRACTION_DIGITS) {
+                fraction = fraction * 10 + (text[position] - '0');
+            } else if (fraction_digits == FRACTION_DIGITS) {
+                round_up = text[position] >= '5';
+            }
+            ++fraction_digits;
+            ++position;
+        }
+    }
+
+    if (position != length || whole_digits + fraction_digits == 0) {
+        return false;
+    }
+    for (int i = fraction_digits; i < FRACTION_DIGITS; i++) {
+        fraction *= 10;
+    }
+    if (round_up) {
+        ++fraction;
+    }
+
+    // Nearest sixteenth, halves away from zero
+    int32_t sixteenths = (whole * FRACTION_SCALE + fraction) * 16 / FRACTION_SCALE;
+    if ((whole * FRACTION_SCALE + fraction) * 16 % FRACTION_SCALE >= FRACTION_SCALE / 2) {
+        ++sixteenths;
+    }
+    if (is_negative) {
+        sixteenths = -sixteenths;
+    }
+
+    if (sixteenths <= INVALID_SIXTEENTHS || sixteenths > std::numeric_limits<int16_t>::max()) {
+        return false;
+    }
+    out = Temperature(static_cast<int16_t>(sixteenths));
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// A temperature in 1/16 C, the DS18B20's native 12-bit step. Readings stay in this form through
+// filtering, alarms, history and storage, so none of it goes through the ESP32's soft-float
+// double path; text is only produced at the web edge, with integer formatting.
+class Temperature {
+    int16_t _sixteenths;
+
+    constexpr explicit Temperature(int16_t sixteenths) : _sixteenths(sixteenths) {}
+public:
+    static constexpr int16_t INVALID_SIXTEENTHS = std::numeric_limits<int16_t>::min();
+    static constexpr size_t MAX_FORMATTED_SIZE = 12; // "-2047.9375" and the terminator
+
+    // Invalid, e.g. no reading yet
+    constexpr Temperature() : _sixteenths(INVALID_SIXTEENTHS) {}
+
+    static constexpr Temperature Invalid() { return Temperature(); }
+    static constexpr Temperature FromSixteenths(int16_t sixteenths) { return Temperature(sixteenths); }
+    static constexpr Temperature FromDegrees(int16_t degrees) { return Temperature(static_cast<int16_t>(degrees * 16)); }
+    // Rounds to the nearest 1/16 C. For the filter's single precision math and the simulator.
+    static Temperature FromFloat(float degrees);
+
+    [[nodiscard]] constexpr bool IsValid() const { return _sixteenths != INVALID_SIXTEENTHS; }
+    [[nodiscard]] constexpr int16_t GetSixteenths() const { return _sixteenths; }
+    // Rounded towards minus infinity, like the DS18B20's alarm comparison
+    [[nodiscard]] constexpr int16_t GetFloorDegrees() const { return static_cast<int16_t>(_sixteenths >> 4); }
+    [[nodiscard]] float ToFloat() const { return _sixteenths / 16.f; }
+
+    constexpr bool operator==(Temperature other) const { return _sixteenths == other._sixteenths; }
+    constexpr bool operator!=(Temperature other) const { return _sixteenths != other._sixteenths; }
+    constexpr bool operator<(Temperature other) const { return _sixteenths < other._sixteenths; }
+    constexpr bool operator<=(Temperature other) const { return _sixteenths <= other._sixteenths; }
+    constexpr bool operator>(Temperature other) const { return _sixteenths > other._sixteenths; }
+    constexpr bool operator>=(Temperature other) const { return _sixteenths >= other._sixteenths; }
+
+    // Writes e.g. "21.5" or "-0.0625", "null" when invalid. Returns the length, or 0 if the buffer is too small.
+    size_t Format(char* buffer, size_t size) const;
+
+    // Parses a decimal such as "21", "21.5" or "-3.25", rounded to the nearest 1/16 C. False for anything else.
+    static bool Parse(const char* text, size_t length, Temperature& out);
+};
+
+static_assert(sizeof(Temperature) == sizeof(int16_t), "Stored as its raw value");
+static_assert(Temperature::FromDegrees(-1).GetFloorDegrees() == -1, "Floor of a negative whole degree");
+static_assert(Temperature::FromSixteenths(-1).GetFloorDegrees() == -1, "Floor rounds down");
@@ -0,0 +1,131 @@
+#include "TemperatureFilter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+TemperatureFilter::TemperatureFilter() : TemperatureFilter(Config{})
+{
+
+}
+
+TemperatureFilter::TemperatureFilter(const Config& config)
+{
+    SetConfig(config);
+}
+
+void TemperatureFilter::SetConfig(const Config& config)
+{
+    _config = config;
+    _config.median_window = std::min(std::max<size_t>(_config.median_window, 1), MAX_MEDIAN_WINDOW);
+    if (_config.median_window % 2 == 0) {
+        --_config.median_window;
+    }
+    Reset();
+}
+
+void TemperatureFilter::Reset()
+{
+    _has_accepted = false;
+    _consecutive_rejects = 0;
+    _median_next = 0;
+    _median_count = 0;
+    _has_estimate = false;
+}
+
+bool TemperatureFilter::IsPlausible(int64_t timestamp_us, Temperature raw) const
+{
+    // Both in 1/16 C
+    const float margin = _config.slew_margin_c * 16.f;
+    const auto distance = [](Temperature a, Temperature b) {
+        return std::abs(static_cast<int32_t>(a.GetSixteenths()) - b.GetSixteenths());
+    };
+
+    // A sensor that browned out reads exactly 85C until its next conversion
+    if (_config.reject_power_on_value && raw == POWER_ON_TEMP &&
+        (!_has_accepted || distance(_last_accepted, POWER_ON_TEMP) > margin)) {
+        return false;
+    }
+
+    if (_config.max_slew_c_per_s > 0.f && _has_accepted) {
+        const float elapsed_s = std::max<int64_t>(timestamp_us - _last_accepted_us, 0) / 1e6f;
+        const float max_change = _config.max_slew_c_per_s * 16.f * elapsed_s + margin;
+        if (distance(raw, _last_accepted) > max_change) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Temperature TemperatureFilter::GetMedian(Temperature raw)
+{
+    _median_window[_median_next] = raw;
+    _median_next = (_median_next + 1) % _config.median_window;
+    _median_count = std::min(_median_count + 1, _config.median_window);
+
+    std::array<Temperature, MAX_MEDIAN_WINDOW> sorted;
+    std::copy(_median_window.begin(), _median_window.begin() + _median_count, sorted.begin());
+    auto middle = sorted.begin() + _median_count / 2;
+    std::nth_element(sorted.begin(), middle, sorted.begin() + _median_count);
+    return *middle;
+}
+
+Temperature TemperatureFilter::Smooth(int64_t timestamp_us, Temperature value)
+{
+    if (!_has_estimate) {
+        _has_estimate = true;
+        _estimate = value.ToFloat();
+        _estimate_variance = _config.kalman_measurement_noise;
+        _estimate_us = timestamp_us;
+        return value;
+    }
+
+    const float measurement = value.ToFloat();
+    const float elapsed_s = std::max<int64_t>(timestamp_us - _estimate_us, 0) / 1e6f;
+    _estimate_us = timestamp_us;
+
+    switch (_config.smoothing) {
+        case Smoothing_T::EMA: {
+            // Same time constant whatever the sample period
+            const float alpha = _config.ema_time_constant_s > 0.f ? 1.f - std::exp(-elapsed_s / _config.ema_time_constant_s) : 1.f;
+            _estimate += alpha * (measurement - _estimate);
+            break;
+        }
+        case Smoothing_T::KALMAN: {
+            // Random walk model: the variance grows with time, each reading pulls it back down
+            _estimate_variance += _config.kalman_process_noise * elapsed_s;
+            const float gain = _estimate_variance / (_estimate_variance + _config.kalman_measurement_noise);
+            _estimate += gain * (measurement - _estimate);
+            _estimate_variance *= 1.f - gain;
+            break;
+        }
+        case Smoothing_T::NONE:
+        default:
+            _estimate = measurement;
+            break;
+    }
+    return Temperature::FromFloat(_estimate);
+}
+
+TemperatureFilter::Output TemperatureFilter::Process(int64_t timestamp_us, Temperature raw)
+{
+    const Temperature last_filtered = _has_estimate ? Temperature::FromFloat(_estimate) : Temperature::Invalid();
+    if (!raw.IsValid()) {
+        return {raw, last_filtered, true};
+    }
+
+    if (!IsPlausible(timestamp_us, raw) && ++_consecutive_rejects <= _config.max_consecutive_rejects) {
+        return {raw, last_filtered, true};
+    }
+
+    if (_consecutive_rejects > _config.max_consecutive_rejects) {
+        // Persisted too long to be a glitch, start over from the new level
+        Reset();
+    }
+    _consecutive_rejects = 0;
+    _has_accepted = true;
+    _last_accepted = raw;
+    _last_accepted_us = timestamp_us;
+
+    return {raw, Smooth(timestamp_us, GetMedian(raw)), false};
+}
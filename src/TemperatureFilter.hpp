@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "Temperature.hpp"
+
+// Conditions one sensor's readings before they are published: drops the 85C power-on value and
+// readings that move faster than the probe physically can, takes the median of the last few to
+// remove single sample spikes, then smooths with an EMA or a 1-D Kalman filter. Fixed memory,
+// constant time per sample, the guards and the median work on the raw 1/16 C steps. Both the raw and the filtered value come out, consumers pick one.
+class TemperatureFilter {
+public:
+    static constexpr size_t MAX_MEDIAN_WINDOW = 7;
+    static constexpr Temperature POWER_ON_TEMP = Temperature::FromDegrees(85);
+
+    enum Smoothing_T {
+        NONE,
+        EMA,
+        KALMAN
+    };
+
+    struct Config {
+        bool reject_power_on_value = true;
+        float max_slew_c_per_s = 1.f; // 0 disables the slew guard
+        float slew_margin_c = 0.5f; // Always allowed on top of the slew rate, one 9-bit step
+        int max_consecutive_rejects = 3; // After that many the reading is taken as a real step change
+        size_t median_window = 3; // Odd, 1 disables it
+        Smoothing_T smoothing = Smoothing_T::KALMAN;
+        float ema_time_constant_s = 2.f;
+        float kalman_process_noise = 0.01f; // C^2/s, how fast the true temperature may wander
+        float kalman_measurement_noise = 0.004f; // C^2, about a 1/16 C step
+    };
+
+    // raw is what the sensor said, filtered is invalid until a reading was accepted
+    struct Output {
+        Temperature raw;
+        Temperature filtered;
+        bool is_rejected;
+    };
+private:
+    Config _config;
+
+    bool _has_accepted = false;
+    Temperature _last_accepted;
+    int64_t _last_accepted_us = 0;
+    int _consecutive_rejects = 0;
+
+    std::array<Temperature, MAX_MEDIAN_WINDOW> _median_window;
+    size_t _median_next = 0;
+    size_t _median_count = 0;
+
+    bool _has_estimate = false;
+    float _estimate = 0.f; // In C, rounded back to 1/16 C on the way out
+    float _estimate_variance = 0.f;
+    int64_t _estimate_us = 0;
+
+    bool IsPlausible(int64_t timestamp_us, Temperature raw) const;
+    Temperature GetMedian(Temperature raw);
+    Temperature Smooth(int64_t timestamp_us, Temperature value);
+public:
+    TemperatureFilter();
+    explicit TemperatureFilter(const Config& config);
+
+    void SetConfig(const Config& config);
+    [[nodiscard]] const Config& GetConfig() const { return _config; }
+    void Reset();
+
+    // Invalid readings pass through as rejected without touching the state
+    Output Process(int64_t timestamp_us, Temperature raw);
+};
@@ -0,0 +1,128 @@
+#include "TemperatureHistory.hpp"
+
+#include <algorithm>
+
+// The slowest sampling plan reads every 5s, hold values across that
+static constexpr int64_t HOLD_S = 10;
+static constexpr uint32_t SECONDS_PER_MINUTE = TemperatureHistory::MINUTE_PERIOD_S / TemperatureHistory::RAW_PERIOD_S;
+static constexpr uint32_t MINUTES_PER_TEN_MINUTES = TemperatureHistory::TEN_MINUTE_PERIOD_S / TemperatureHistory::MINUTE_PERIOD_S;
+
+void TemperatureHistory::Accumulator::Add(Sixteenths value)
+{
+    sum += value;
+    ++count;
+    min = std::min(min, value);
+    max = std::max(max, value);
+}
+
+void TemperatureHistory::Accumulator::Merge(const Accumulator& other)
+{
+    sum += other.sum;
+    count += other.count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+TemperatureHistory::Aggregate TemperatureHistory::Accumulator::ToAggregate() const
+{
+    if (count == 0) {
+        return {INVALID, INVALID, INVALID};
+    }
+    // Rounded to nearest, halves away from zero
+    const auto mean = static_cast<Sixteenths>((2 * sum + (sum < 0 ? -count : count)) / (2 * count));
+    return {min, mean, max};
+}
+
+void TemperatureHistory::Add(int64_t timestamp_us, Temperature temperature)
+{
+    const int64_t second = timestamp_us / 1000000;
+    if (!_has_samples) {
+        _has_samples = true;
+        _start_time_s = second;
+        _current_second = second;
+    }
+
+    // Samples arriving late for a second that is already closed are dropped
+    while (_current_second < second) {
+        CloseSecond();
+        ++_current_second;
+    }
+
+    const auto value = temperature.GetSixteenths();
+    if (second == _current_second && value != INVALID) {
+        _second.Add(value);
+    }
+}
+
+void TemperatureHistory::CloseSecond()
+{
+    Sixteenths value = INVALID;
+    if (_second.count > 0) {
+        value = _second.ToAggregate().mean;
+        _last_value = value;
+        _last_value_second = _current_second;
+    } else if (_last_value != INVALID && _current_second - _last_value_second <= HOLD_S) {
+        value = _last_value;
+    }
+    _second = Accumulator();
+
+    _raw.Push(value);
+    if (value != INVALID) {
+        _minute.Add(value);
+        if (!_archive_encoder.Append(_current_second, value)) {
+            _archive.Push(_archive_encoder.GetBlock());
+            _archive_encoder.Reset();
+            _archive_encoder.Append(_current_second, value);
+        }
+    }
+
+    if (++_seconds_in_minute < SECONDS_PER_MINUTE) {
+        return;
+    }
+    _minutes.Push(_minute.ToAggregate());
+    if (_minute.count > 0) {
+        _ten_minute.Merge(_minute);
+    }
+    _minute = Accumulator();
+    _seconds_in_minute = 0;
+
+    if (++_minutes_in_ten_minute < MINUTES_PER_TEN_MINUTES) {
+        return;
+    }
+    _ten_minutes.Push(_ten_minute.ToAggregate());
+    _ten_minute = Accumulator();
+    _minutes_in_ten_minute = 0;
+}
+
+template <typename T, size_t N>
+TemperatureHistory::Series<T> TemperatureHistory::GetSeries(const HistoryRing<T, N>& ring, int64_t period_s, size_t max_entries) const
+{
+    Series<T> series;
+    series.period_s = period_s;
+    const uint32_t first_index = ring.Snapshot(series.entries, max_entries);
+    // Every tier starts at the first raw second, entry i of a tier starts i periods later
+    series.first_time_s = series.entries.empty() ? 0 : _start_time_s + first_index * period_s;
+    return series;
+}
+
+TemperatureHistory::Series<TemperatureHistory::Sixteenths> TemperatureHistory::GetRaw(size_t max_entries) const
+{
+    return GetSeries(_raw, RAW_PERIOD_S, max_entries);
+}
+
+TemperatureHistory::Series<TemperatureHistory::Aggregate> TemperatureHistory::GetMinutes(size_t max_entries) const
+{
+    return GetSeries(_minutes, MINUTE_PERIOD_S, max_entries);
+}
+
+TemperatureHistory::Series<TemperatureHistory::Aggregate> TemperatureHistory::GetTenMinutes(size_t max_entries) const
+{
+    return GetSeries(_ten_minutes, TEN_MINUTE_PERIOD_S, max_entries);
+}
+
+std::vector<SampleBlock> TemperatureHistory::GetArchive(size_t max_blocks) const
+{
+    std::vector<SampleBlock> blocks;
+    _archive.Snapshot(blocks, max_blocks);
+    return blocks;
+}
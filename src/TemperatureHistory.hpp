@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "HistoryRing.hpp"
+#include "SampleCodec.hpp"
+#include "Temperature.hpp"
+
+// Fixed memory temperature history in three tiers: one value per second for the last 10 minutes,
+// min/mean/max per minute for 4 hours and per 10 minutes for 48 hours, about 4.4KB in total.
+// Older per-second values are also kept compressed in an archive of SampleBlocks, another 4KB
+// that holds a couple of hours depending on how noisy the probe is.
+// Temperatures are kept in 1/16 C like the DS18B20 registers. Add is called from a single
+// producer (the sampler), readers take snapshots without locking it out.
+class TemperatureHistory {
+public:
+    using Sixteenths = int16_t;
+    static constexpr Sixteenths INVALID = Temperature::INVALID_SIXTEENTHS; // No reading for that slot
+
+    struct Aggregate {
+        Sixteenths min;
+        Sixteenths mean;
+        Sixteenths max;
+
+        [[nodiscard]] bool IsValid() const { return mean != INVALID; }
+    };
+
+    template <typename T>
+    struct Series {
+        int64_t first_time_s = 0; // Start of the first entry, seconds since boot
+        int64_t period_s = 0;
+        std::vector<T> entries; // Oldest first
+    };
+
+    static constexpr int64_t RAW_PERIOD_S = 1;
+    static constexpr int64_t MINUTE_PERIOD_S = 60;
+    static constexpr int64_t TEN_MINUTE_PERIOD_S = 600;
+private:
+    // Sums in sixteenths over the raw seconds of the slot being built
+    struct Accumulator {
+        int32_t sum = 0;
+        int32_t count = 0;
+        Sixteenths min = std::numeric_limits<Sixteenths>::max();
+        Sixteenths max = std::numeric_limits<Sixteenths>::min();
+
+        void Add(Sixteenths value);
+        void Merge(const Accumulator& other);
+        [[nodiscard]] Aggregate ToAggregate() const;
+    };
+
+    HistoryRing<Sixteenths, 600> _raw;
+    HistoryRing<Aggregate, 240> _minutes;
+    HistoryRing<Aggregate, 288> _ten_minutes;
+    HistoryRing<SampleBlock, 16> _archive; // Full blocks only, timestamps in seconds
+    SampleEncoder _archive_encoder;
+
+    // Written once before the first push, read after the ring counts
+    int64_t _start_time_s = 0;
+
+    // Producer state
+    bool _has_samples = false;
+    int64_t _current_second = 0;
+    Accumulator _second;
+    Accumulator _minute;
+    Accumulator _ten_minute;
+    uint32_t _seconds_in_minute = 0;
+    uint32_t _minutes_in_ten_minute = 0;
+    Sixteenths _last_value = INVALID;
+    int64_t _last_value_second = 0;
+
+    void CloseSecond();
+
+    template <typename T, size_t N>
+    Series<T> GetSeries(const HistoryRing<T, N>& ring, int64_t period_s, size_t max_entries) const;
+public:
+    // Producer only. Seconds with no sample repeat the previous one for a short while, then read INVALID.
+    // Timestamps are since boot and may be negative for samples replayed from before it.
+    void Add(int64_t timestamp_us, Temperature temperature);
+
+    [[nodiscard]] Series<Sixteenths> GetRaw(size_t max_entries = SIZE_MAX) const;
+    [[nodiscard]] Series<Aggregate> GetMinutes(size_t max_entries = SIZE_MAX) const;
+    [[nodiscard]] Series<Aggregate> GetTenMinutes(size_t max_entries = SIZE_MAX) const;
+    // Oldest first, decode with SampleDecoder. The newest seconds are only in GetRaw until a block fills up.
+    [[nodiscard]] std::vector<SampleBlock> GetArchive(size_t max_blocks = SIZE_MAX) const;
+};
@@ -0,0 +1,138 @@
+#include "TemperatureTrend.hpp"
+
+#include <cmath>
+
+static constexpr float SIXTEENTHS_PER_MS_TO_C_PER_S = 1000.f / 16.f;
+
+void TemperatureTrend::Reset()
+{
+    _first = 0;
+    _count = 0;
+    _sum_t = 0;
+    _sum_y = 0;
+    _sum_tt = 0;
+    _sum_ty = 0;
+    _sum_yy = 0;
+    _fit = Fit();
+}
+
+void TemperatureTrend::AddToSums(const Point& point, int64_t sign)
+{
+    const int64_t t = point.time_ms - _base_ms;
+    _sum_t += sign * t;
+    _sum_y += sign * point.value;
+    _sum_tt += sign * t * t;
+    _sum_ty += sign * t * point.value;
+    _sum_yy += sign * point.value * point.value;
+}
+
+void TemperatureTrend::RemoveOldest()
+{
+    AddToSums(_points[_first], -1);
+    _first = (_first + 1) % WINDOW_SIZE;
+    --_count;
+    if (_count == 0) {
+        return;
+    }
+
+    // Move the origin to the new oldest point so the sums stay small. With t' = t - d:
+    // sum(t') = sum(t) - n*d, sum(t'^2) = sum(t^2) - 2*d*sum(t) + n*d^2, sum(t'*y) = sum(t*y) - d*sum(y)
+    const int64_t shift_ms = _points[_first].time_ms - _base_ms;
+    const auto count = static_cast<int64_t>(_count);
+    _sum_tt += -2 * shift_ms * _sum_t + count * shift_ms * shift_ms;
+    _sum_t -= count * shift_ms;
+    _sum_ty -= shift_ms * _sum_y;
+    _base_ms += shift_ms;
+}
+
+bool TemperatureTrend::Add(int64_t timestamp_us, Temperature temperature)
+{
+    if (!temperature.IsValid()) {
+        return false;
+    }
+    if (_count > 0) {
+        if (timestamp_us - _last_us < MIN_SPACING_US) {
+            return false;
+        }
+        // After a gap longer than the window nothing in it is recent enough to extrapolate from
+        if (timestamp_us - _last_us > WINDOW_US) {
+            Reset();
+        }
+    }
+
+    const Point point = {timestamp_us / 1000, temperature.GetSixteenths()};
+    while (_count == WINDOW_SIZE || (_count > 0 && (point.time_ms - _base_ms) * 1000 > WINDOW_US)) {
+        RemoveOldest();
+    }
+    if (_count == 0) {
+        _base_ms = point.time_ms;
+    }
+
+    _points[(_first + _count) % WINDOW_SIZE] = point;
+    ++_count;
+    _last_us = timestamp_us;
+    AddToSums(point, 1);
+
+    UpdateFit();
+    return true;
+}
+
+void TemperatureTrend::UpdateFit()
+{
+    _fit.time_us = _last_us;
+    _fit.sample_count = static_cast<uint16_t>(_count);
+    if (_count < MIN_FIT_SAMPLES) {
+        _fit.value = Temperature::Invalid();
+        return;
+    }
+
+    // Exact up to here, n times the usual centred sums
+    const auto n = static_cast<int64_t>(_count);
+    const int64_t s_tt = n * _sum_tt - _sum_t * _sum_t;
+    const int64_t s_ty = n * _sum_ty - _sum_t * _sum_y;
+    const int64_t s_yy = n * _sum_yy - _sum_y * _sum_y;
+    if (s_tt <= 0) {
+        _fit.value = Temperature::Invalid();
+        return;
+    }
+
+    // Per millisecond, in 1/16 C
+    const float slope = static_cast<float>(s_ty) / static_cast<float>(s_tt);
+    const float intercept = (static_cast<float>(_sum_y) - slope * static_cast<float>(_sum_t)) / static_cast<float>(n);
+    const float last_t = static_cast<float>(_last_us / 1000 - _base_ms);
+
+    // Residual sum of squares, times n
+    const float explained = static_cast<float>(s_ty) * static_cast<float>(s_ty) / static_cast<float>(s_tt);
+    const float residual = std::max(static_cast<float>(s_yy) - explained, 0.f);
+    const float residual_variance = residual / static_cast<float>(n * (n - 2));
+    const float slope_error = std::sqrt(residual_variance * static_cast<float>(n) / static_cast<float>(s_tt));
+
+    _fit.value = Temperature::FromFloat((intercept + slope * last_t) / 16.f);
+    _fit.slope_c_per_s = slope * SIXTEENTHS_PER_MS_TO_C_PER_S;
+    _fit.slope_error_c_per_s = slope_error * SIXTEENTHS_PER_MS_TO_C_PER_S;
+    _fit.r_squared = s_yy > 0 ? explained / static_cast<float>(s_yy) : 1.f;
+}
+
+TemperatureTrend::Crossing TemperatureTrend::GetCrossing(const Fit& fit, Temperature threshold, int64_t now_us)
+{
+    Crossing crossing;
+    if (!fit.IsValid() || !threshold.IsValid()) {
+        return crossing;
+    }
+
+    const float distance_c = (threshold.GetSixteenths() - fit.value.GetSixteenths()) / 16.f;
+    if (distance_c == 0.f) {
+        crossing.is_approaching = true;
+        return crossing;
+    }
+    if (fit.slope_c_per_s == 0.f || (distance_c > 0.f) != (fit.slope_c_per_s > 0.f)) {
+        return crossing;
+    }
+
+    const float since_fit_s = std::max<int64_t>(now_us - fit.time_us, 0) / 1e6f;
+    crossing.is_approaching = true;
+    crossing.eta_s = std::max(distance_c / fit.slope_c_per_s - since_fit_s, 0.f);
+    // d/slope moves by d*err/slope^2 for a one standard error change in the slope
+    crossing.error_s = std::fabs(distance_c) * fit.slope_error_c_per_s / (fit.slope_c_per_s * fit.slope_c_per_s);
+    return crossing;
+}
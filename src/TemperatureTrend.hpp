@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "Temperature.hpp"
+
+// Least squares line through the last minute of readings, to tell when a threshold will be reached.
+// The running sums are integers taken relative to the oldest reading, so they are exact and adding
+// or dropping a reading is O(1) without the drift a floating point sliding window accumulates. Over a
+// minute the cooling/heating curve of a pot of milk is close enough to straight that a line does
+// as well as an exponential fit, without having to guess the ambient temperature.
+class TemperatureTrend {
+public:
+    static constexpr size_t WINDOW_SIZE = 60;
+    static constexpr int64_t WINDOW_US = 60000000;
+    static constexpr int64_t MIN_SPACING_US = 1000000; // Faster samples are skipped, they'd only shorten the window
+    static constexpr size_t MIN_FIT_SAMPLES = 5;
+
+    struct Fit {
+        int64_t time_us = 0; // Of the newest reading
+        Temperature value; // Fitted value at time_us, invalid until there are MIN_FIT_SAMPLES readings
+        float slope_c_per_s = 0.f;
+        float slope_error_c_per_s = 0.f; // One standard error
+        float r_squared = 0.f; // How much of the variation the line explains, 1 for a perfectly flat reading
+        uint16_t sample_count = 0;
+
+        [[nodiscard]] bool IsValid() const { return value.IsValid(); }
+    };
+
+    struct Crossing {
+        bool is_approaching = false; // False when moving away or flat, the other fields are meaningless then
+        float eta_s = 0.f; // From now_us, 0 if it should already have crossed
+        float error_s = 0.f; // One standard error, from the slope's
+    };
+private:
+    struct Point {
+        int64_t time_ms;
+        int16_t value; // 1/16 C
+    };
+
+    std::array<Point, WINDOW_SIZE> _points;
+    size_t _first = 0;
+    size_t _count = 0;
+    int64_t _base_ms = 0; // Origin of the sums, the oldest point
+    int64_t _last_us = 0;
+
+    int64_t _sum_t = 0;
+    int64_t _sum_y = 0;
+    int64_t _sum_tt = 0;
+    int64_t _sum_ty = 0;
+    int64_t _sum_yy = 0;
+
+    Fit _fit;
+
+    void AddToSums(const Point& point, int64_t sign);
+    void RemoveOldest();
+    void UpdateFit();
+public:
+    // Producer only. Returns true when the reading was taken and the fit updated.
+    bool Add(int64_t timestamp_us, Temperature temperature);
+    void Reset();
+
+    [[nodiscard]] const Fit& GetFit() const { return _fit; }
+
+    static Crossing GetCrossing(const Fit& fit, Temperature threshold, int64_t now_us);
+};
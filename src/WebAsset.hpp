@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// A file from html/, bundled into flash at build time by copy_html.py (see WebAssets.hpp)
+struct WebAsset {
+    const char* path;
+    const char* mime_type;
+    const char* etag; // Hash of the file, quoted as it goes in the header
+    bool is_gzipped; // Left as is when gzip doesn't make it smaller
+    const uint8_t* body;
+    size_t size;
+};
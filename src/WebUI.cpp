@@ -1,39 +1,93 @@
 #include "WebUI.hpp"
 
-#include <sstream>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
 #include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <unistd.h>
 
-#include "WebForm.hpp"
+#include "WebAssets.hpp"
+#include "HistoryExport.hpp"
+#include "JsonReader.hpp"
+#include "JsonWriter.hpp"
 
 #include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
 
 static const char *TAG = "WebUI";
-
-WebUI::WebUI(const std::shared_ptr<DataBinding<double>> &temperature_source,
-             const std::shared_ptr<DataBinding<std::pair<double, double>>> &alarm_threshold_binding) : _config(HTTPD_DEFAULT_CONFIG()), _handle(nullptr),
-                                                                                                       _temperature_source(temperature_source),
-                                                                                                       _alarm_threshold_binding(alarm_threshold_binding)
+static constexpr uint16_t MAX_URI_HANDLERS = 16;
+static constexpr size_t HTTPD_STACK_SIZE = 6144;
+// WebSocket close status "Try Again Later", sent to stream clients over MAX_STREAM_CLIENTS
+static constexpr uint16_t WS_CLOSE_TRY_AGAIN_LATER = 1013;
+// Bounds the longest token of a request body, e.g. a string value
+static constexpr size_t JSON_BODY_BUFFER_SIZE = 128;
+static constexpr size_t MAX_JSON_KEY_LENGTH = 15;
+// Responses are sent in chunks of this size
+static constexpr size_t JSON_CHUNK_SIZE = 256;
+// Responses with an ETag are kept but revalidated on every load, a match costs a 304 instead of the body
+static const char *CACHE_CONTROL = "no-cache";
+static constexpr size_t MAX_IF_NONE_MATCH_LENGTH = 96;
+static constexpr size_t MAX_QUERY_LENGTH = 96;
+
+const WebUI::Route WebUI::ROUTES[] = {
+    {"/current_temp", HTTP_GET, &WebUI::HandleGetTemp, false},
+    {"/thresholds", HTTP_GET, &WebUI::HandleGetThresholds, false},
+    {"/eta", HTTP_GET, &WebUI::HandleGetEta, false},
+    {"/history", HTTP_GET, &WebUI::HandleGetHistory, false},
+    {"/thresholds", HTTP_POST, &WebUI::HandlePost, false},
+    {"/rules", HTTP_GET, &WebUI::HandleGetRules, false},
+    {"/rules", HTTP_POST, &WebUI::HandlePostRule, false},
+    {"/rules", HTTP_DELETE, &WebUI::HandleDeleteRule, false},
+    // WebSocket frames come in through the handshake's route too
+    {"/stream", HTTP_GET, &WebUI::HandleStream, true},
+    // Anything else is looked up in html/, httpd matches routes in this order
+    {"/*", HTTP_GET, &WebUI::HandleGetAsset, false},
+};
+
+WebUI::WebUI(const std::shared_ptr<DataBinding<Temperature>> &temperature_source,
+             const std::shared_ptr<DataBinding<std::pair<Temperature, Temperature>>> &alarm_threshold_binding,
+             const std::shared_ptr<Alarm> &alarm_rules,
+             const std::shared_ptr<DataBinding<TemperatureTrend::Fit>> &trend_source,
+             const std::shared_ptr<const TemperatureHistory> &history,
+             const std::shared_ptr<SampleLog> &sample_log) : _config(HTTPD_DEFAULT_CONFIG()), _handle(nullptr),
+                                                                         _temperature_source(temperature_source),
+                                                                         _alarm_threshold_binding(alarm_threshold_binding),
+                                                                         _alarm_rules(alarm_rules),
+                                                                         _trend_source(trend_source),
+                                                                         _history(history),
+                                                                         _sample_log(sample_log),
+                                                                         _boot_id(esp_random())
 {
+    _config.max_uri_handlers = MAX_URI_HANDLERS;
+    // History exports keep a chunk, a batch of records and the encoder on the stack while lwIP sends
+    _config.stack_size = HTTPD_STACK_SIZE;
+    _config.uri_match_fn = httpd_uri_match_wildcard;
+    // Found by HandleRequest and the close hook. The close hook drops stream clients before their descriptor is reused
+    _config.global_user_ctx = this;
+    _config.global_user_ctx_free_fn = [](void *) {}; // Owned by app_main, not the server
+    _config.close_fn = &WebUI::HandleClose;
     if (httpd_start(&_handle, &_config) != ESP_OK)
     {
         ESP_LOGE(TAG, "Error starting web server!");
         return;
     }
 
-    RegisterHandler(HTTP_GET, "/", [&](httpd_req_t *req) {
-        return HandleGetForm(req);
-    });
-
-    RegisterHandler(HTTP_GET, "/current_temp", [&](httpd_req_t *req) {
-        return HandleGetTemp(req);
-    });
-
-    RegisterHandler(HTTP_GET, "/thresholds", [&](httpd_req_t *req) {
-        return HandleGetThresholds(req);
-    });
+    for (const auto &route : ROUTES)
+    {
+        httpd_uri_t uri_handle = {};
+        uri_handle.uri = route.uri;
+        uri_handle.method = route.method;
+        uri_handle.user_ctx = const_cast<Route *>(&route);
+        uri_handle.handler = &WebUI::HandleRequest;
+        uri_handle.is_websocket = route.is_websocket;
+        httpd_register_uri_handler(_handle, &uri_handle);
+    }
 
-    RegisterHandler(HTTP_POST, "/thresholds", [&](httpd_req_t *req) {
-        return HandlePost(req);
+    _temperature_source->Subscribe([this](const Temperature &temperature) {
+        OnTemperature(temperature);
     });
 }
 
@@ -45,167 +99,685 @@ WebUI::~WebUI()
     }
 }
 
-esp_err_t WebUI::HandleGetForm(httpd_req_t *req)
+static const WebAsset *FindAsset(std::string_view path)
 {
-    ESP_LOGI(TAG, "Processing GET form request");
-    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
-    httpd_resp_send(req, gz_compressed_form, sizeof(gz_compressed_form));
-    return ESP_OK;
+    for (const auto &asset : WEB_ASSETS)
+    {
+        if (path == asset.path)
+        {
+            return &asset;
+        }
+    }
+    return nullptr;
 }
 
-esp_err_t WebUI::HandleGetTemp(httpd_req_t *req)
+// If-None-Match is a list of tags, possibly weak (W/"..."), or *
+static bool IsNotModified(httpd_req_t *req, const char *etag)
 {
-    const auto temp_string = std::to_string(_temperature_source->GetValue());
-    return httpd_resp_send(req, temp_string.c_str(), HTTPD_RESP_USE_STRLEN);
+    char value[MAX_IF_NONE_MATCH_LENGTH];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", value, sizeof(value)) != ESP_OK)
+    {
+        return false;
+    }
+    return strcmp(value, "*") == 0 || strstr(value, etag) != nullptr;
 }
 
-esp_err_t WebUI::HandleGetThresholds(httpd_req_t *req)
+esp_err_t WebUI::HandleGetAsset(httpd_req_t *req)
 {
-    const auto low_hi_values = _alarm_threshold_binding->GetValue();
-    std::stringstream ss;
-    ss << "{\"low\":\"";
-    ss << low_hi_values.first;
-    ss << "\", \"high\":\"";
-    ss << low_hi_values.second;
-    ss << "\"}";
+    std::string_view path(req->uri);
+    path = path.substr(0, path.find('?'));
+    const WebAsset *asset = FindAsset(path);
+    if (asset == nullptr)
+    {
+        return httpd_resp_send_404(req);
+    }
+
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", CACHE_CONTROL);
+    if (IsNotModified(req, asset->etag))
+    {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, nullptr, 0);
+    }
 
-    return httpd_resp_send(req, ss.str().c_str(), HTTPD_RESP_USE_STRLEN);
+    ESP_LOGI(TAG, "Sending %s", asset->path);
+    httpd_resp_set_type(req, asset->mime_type);
+    if (asset->is_gzipped)
+    {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
+    return httpd_resp_send(req, reinterpret_cast<const char *>(asset->body), asset->size);
 }
 
-esp_err_t WebUI::HandlePost(httpd_req_t *req)
+static void WriteTemperature(JsonWriter &writer, Temperature temperature)
 {
-    ESP_LOGI(TAG, "Handling POST to set thresholds...");
-    std::array<char, 256> body_buf;
+    char buffer[Temperature::MAX_FORMATTED_SIZE];
+    writer.Raw({buffer, temperature.Format(buffer, sizeof(buffer))});
+}
+
+static bool SendChunk(void *context, const char *data, size_t size)
+{
+    return httpd_resp_send_chunk(static_cast<httpd_req_t *>(context), data, size) == ESP_OK;
+}
 
-    const size_t recv_size = std::min(req->content_len, body_buf.size());
+static int ReceiveBody(void *context, char *buffer, size_t size)
+{
+    static constexpr int MAX_TIMEOUTS = 3;
+    int result = HTTPD_SOCK_ERR_TIMEOUT;
+    for (int i = 0; i < MAX_TIMEOUTS && result == HTTPD_SOCK_ERR_TIMEOUT; i++)
+    {
+        result = httpd_req_recv(static_cast<httpd_req_t *>(context), buffer, size);
+    }
+    return result;
+}
 
-    const int ec = httpd_req_recv(req, body_buf.data(), recv_size);
-    if (ec <= 0)
+// Calls on_member(key, token, text) for each member of the JSON object in the request body, read
+// in chunks straight from the socket. Members whose value is an object or array are skipped.
+// False if the body isn't one well formed object.
+template <typename OnMember>
+static bool ReceiveJsonObject(httpd_req_t *req, OnMember on_member)
+{
+    char buffer[JSON_BODY_BUFFER_SIZE];
+    JsonReader reader(buffer, sizeof(buffer), &ReceiveBody, req);
+    if (reader.Next() != JsonReader::Token_T::BEGIN_OBJECT)
     {
-        ESP_LOGE(TAG, "Failed to receive POSTed data ! %d", ec);
-        return ESP_FAIL;
+        return false;
     }
 
-    const auto parsed_json = ParseJsonKeyValuePairs(std::string(body_buf.data()));
+    char key[MAX_JSON_KEY_LENGTH];
+    while (true)
+    {
+        auto token = reader.Next();
+        if (token == JsonReader::Token_T::END_OBJECT)
+        {
+            break;
+        }
+        if (token != JsonReader::Token_T::KEY)
+        {
+            return false;
+        }
+        // Reading the value may reuse the buffer under the key. Keys too long to keep match nothing.
+        const auto key_text = reader.GetText();
+        const size_t key_length = key_text.size() <= sizeof(key) ? key_text.size() : 0;
+        memcpy(key, key_text.data(), key_length);
 
-    if (parsed_json.size() != 2)
+        token = reader.Next();
+        if (token == JsonReader::Token_T::BEGIN_OBJECT || token == JsonReader::Token_T::BEGIN_ARRAY)
+        {
+            if (!reader.Skip(token))
+            {
+                return false;
+            }
+            continue;
+        }
+        if (token == JsonReader::Token_T::ERROR)
+        {
+            return false;
+        }
+        on_member(std::string_view(key, key_length), token, reader.GetText());
+    }
+    return reader.Next() == JsonReader::Token_T::END;
+}
+
+template <typename Format>
+esp_err_t WebUI::SendCached(httpd_req_t *req, CachedResponse &cache, uint32_t version, Format format)
+{
+    if (!cache.is_valid || cache.version != version)
     {
-        ESP_LOGE(TAG, "Expected 2 key-value pairs, got: %d", parsed_json.size());
+        // The value read by format may already be newer than version, then the next request formats it again
+        cache.length = format(cache.body, sizeof(cache.body));
+        snprintf(cache.etag, sizeof(cache.etag), "\"%08" PRIx32 "-%" PRIu32 "\"", _boot_id, version);
+        cache.version = version;
+        cache.is_valid = true;
     }
 
-    double low_thresh = -300.;
-    double high_thresh = low_thresh;
+    httpd_resp_set_hdr(req, "ETag", cache.etag);
+    httpd_resp_set_hdr(req, "Cache-Control", CACHE_CONTROL);
+    if (IsNotModified(req, cache.etag))
+    {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, nullptr, 0);
+    }
+    return httpd_resp_send(req, cache.body, cache.length);
+}
+
+esp_err_t WebUI::HandleGetTemp(httpd_req_t *req)
+{
+    static_assert(Temperature::MAX_FORMATTED_SIZE <= CachedResponse::MAX_BODY_SIZE, "Temperature doesn't fit");
+    return SendCached(req, _temperature_response, _temperature_source->GetVersion(), [this](char *buffer, size_t size) {
+        return _temperature_source->GetValue().Format(buffer, size);
+    });
+}
 
-    for (const auto &k_v : parsed_json)
+esp_err_t WebUI::HandleStream(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET)
     {
-        if (k_v.first == "low")
+        // Handshake done, from now on the client only listens
         {
-            low_thresh = std::stod(k_v.second);
+            std::lock_guard<decltype(_stream_lock)> lock(_stream_lock);
+            if (_stream_fd_count < _stream_fds.size())
+            {
+                _stream_fds[_stream_fd_count++] = httpd_req_to_sockfd(req);
+                return ESP_OK;
+            }
         }
-        else if (k_v.first == "high")
+
+        // httpd already answered the upgrade, so turn the client away with a close frame rather than
+        // a dropped connection. The page falls back to polling.
+        ESP_LOGW(TAG, "Too many stream clients");
+        uint8_t status[2] = {WS_CLOSE_TRY_AGAIN_LATER >> 8, WS_CLOSE_TRY_AGAIN_LATER & 0xFF};
+        httpd_ws_frame_t frame = {};
+        frame.final = true;
+        frame.type = HTTPD_WS_TYPE_CLOSE;
+        frame.payload = status;
+        frame.len = sizeof(status);
+        httpd_ws_send_frame(req, &frame);
+        return ESP_FAIL;
+    }
+
+    // Nothing is expected from the client, drop what it sends
+    uint8_t payload[16];
+    httpd_ws_frame_t frame = {};
+    frame.payload = payload;
+    return httpd_ws_recv_frame(req, &frame, sizeof(payload));
+}
+
+void WebUI::HandleClose(httpd_handle_t handle, int sockfd)
+{
+    auto this_obj = static_cast<WebUI *>(httpd_get_global_user_ctx(handle));
+    {
+        std::lock_guard<decltype(this_obj->_stream_lock)> lock(this_obj->_stream_lock);
+        this_obj->RemoveStreamClient(sockfd);
+    }
+    close(sockfd);
+}
+
+void WebUI::RemoveStreamClient(int sockfd)
+{
+    const auto end = _stream_fds.begin() + _stream_fd_count;
+    const auto it = std::find(_stream_fds.begin(), end, sockfd);
+    if (it != end)
+    {
+        *it = *(end - 1);
+        --_stream_fd_count;
+    }
+}
+
+void WebUI::OnTemperature(Temperature temperature)
+{
+    std::lock_guard<decltype(_stream_lock)> lock(_stream_lock);
+    if (_stream_fd_count == 0)
+    {
+        return;
+    }
+    _stream_length = temperature.Format(_stream_buffer, sizeof(_stream_buffer));
+    // A send still waiting in the httpd queue picks up the new value instead
+    if (!_is_stream_send_queued && httpd_queue_work(_handle, &WebUI::SendStream, this) == ESP_OK)
+    {
+        _is_stream_send_queued = true;
+    }
+}
+
+void WebUI::SendStream(void *arg)
+{
+    auto this_obj = static_cast<WebUI *>(arg);
+    char payload[Temperature::MAX_FORMATTED_SIZE];
+    httpd_ws_frame_t frame = {};
+    std::array<int, MAX_STREAM_CLIENTS> fds;
+    size_t fd_count;
+    {
+        // Copied so a slow client never holds up the sampler
+        std::lock_guard<decltype(this_obj->_stream_lock)> lock(this_obj->_stream_lock);
+        this_obj->_is_stream_send_queued = false;
+        memcpy(payload, this_obj->_stream_buffer, this_obj->_stream_length);
+        frame.len = this_obj->_stream_length;
+        fds = this_obj->_stream_fds;
+        fd_count = this_obj->_stream_fd_count;
+    }
+
+    frame.final = true;
+    frame.type = HTTPD_WS_TYPE_TEXT;
+    frame.payload = reinterpret_cast<uint8_t *>(payload);
+    for (size_t i = 0; i < fd_count; i++)
+    {
+        if (httpd_ws_send_frame_async(this_obj->_handle, fds[i], &frame) != ESP_OK)
         {
-            high_thresh = std::stod(k_v.second);
+            // HandleClose removes it
+            ESP_LOGW(TAG, "Dropping stream client %d", fds[i]);
+            httpd_sess_trigger_close(this_obj->_handle, fds[i]);
         }
     }
+}
 
-    if (low_thresh > -300. && high_thresh > -300.)
+esp_err_t WebUI::HandleGetThresholds(httpd_req_t *req)
+{
+    return SendCached(req, _thresholds_response, _alarm_threshold_binding->GetVersion(), [this](char *buffer, size_t size) {
+        const auto low_hi_values = _alarm_threshold_binding->GetValue();
+        char low[Temperature::MAX_FORMATTED_SIZE];
+        char high[Temperature::MAX_FORMATTED_SIZE];
+
+        JsonWriter writer(buffer, size);
+        writer.BeginObject();
+        writer.Key("low");
+        writer.String({low, low_hi_values.first.Format(low, sizeof(low))});
+        writer.Key("high");
+        writer.String({high, low_hi_values.second.Format(high, sizeof(high))});
+        writer.EndObject();
+        return writer.GetLength();
+    });
+}
+
+static void WriteCrossing(JsonWriter &writer, const TemperatureTrend::Fit &trend, Temperature threshold, int64_t now_us)
+{
+    const auto crossing = TemperatureTrend::GetCrossing(trend, threshold, now_us);
+    if (!crossing.is_approaching)
     {
-        ESP_LOGI(TAG, "Setting low,high alarm thresholds to %lf, %lf", low_thresh, high_thresh);
-        _alarm_threshold_binding->SetValue(std::make_pair(low_thresh, high_thresh));
-        return httpd_resp_send(req, "", 0);
+        writer.Null();
+        return;
     }
+    writer.BeginObject();
+    writer.Key("eta");
+    writer.Integer(static_cast<int64_t>(crossing.eta_s));
+    writer.Key("error");
+    writer.Integer(static_cast<int64_t>(crossing.error_s));
+    writer.EndObject();
+}
 
-    ESP_LOGE(TAG, "Could not read low, high thresholds. Not updating");
+esp_err_t WebUI::HandleGetEta(httpd_req_t *req)
+{
+    // Seconds until each threshold is reached, null when not heading towards it
+    const auto trend = _trend_source->GetValue();
+    const auto low_hi_values = _alarm_threshold_binding->GetValue();
+    const int64_t now_us = esp_timer_get_time();
 
-    return httpd_resp_send_err(req, httpd_err_code_t::HTTPD_400_BAD_REQUEST, nullptr);
+    char buffer[JSON_CHUNK_SIZE];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.BeginObject();
+    writer.Key("rate");
+    if (trend.IsValid())
+    {
+        writer.Number(trend.slope_c_per_s);
+        writer.Key("rate_error");
+        writer.Number(trend.slope_error_c_per_s);
+        writer.Key("r2");
+        writer.Number(trend.r_squared);
+    }
+    else
+    {
+        writer.Null();
+    }
+    writer.Key("low");
+    WriteCrossing(writer, trend, low_hi_values.first, now_us);
+    writer.Key("high");
+    WriteCrossing(writer, trend, low_hi_values.second, now_us);
+    writer.EndObject();
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, writer.GetData(), writer.GetLength());
+}
+
+template <typename T, typename Getter>
+static void WriteHistoryArray(JsonWriter &writer, const char *name, const std::vector<T> &entries, Getter get_value)
+{
+    writer.Key(name);
+    writer.BeginArray();
+    for (const auto &entry : entries)
+    {
+        WriteTemperature(writer, Temperature::FromSixteenths(get_value(entry)));
+    }
+    writer.EndArray();
 }
 
-void WebUI::RegisterHandler(httpd_method_t type, const std::string &uri, const std::function<esp_err_t(httpd_req_t *)> &handler)
+static void WriteAggregateSeries(JsonWriter &writer, const TemperatureHistory::Series<TemperatureHistory::Aggregate> &series)
 {
-    httpd_uri_t uri_handle;
-    uri_handle.uri = uri.c_str();
-    uri_handle.method = type;
-    uri_handle.user_ctx = this;
-    uri_handle.handler = &WebUI::HandleRequest;
+    writer.BeginObject();
+    writer.Key("start");
+    writer.Integer(series.first_time_s);
+    writer.Key("period");
+    writer.Integer(series.period_s);
+    WriteHistoryArray(writer, "min", series.entries, [](const TemperatureHistory::Aggregate &aggregate) { return aggregate.min; });
+    WriteHistoryArray(writer, "mean", series.entries, [](const TemperatureHistory::Aggregate &aggregate) { return aggregate.mean; });
+    WriteHistoryArray(writer, "max", series.entries, [](const TemperatureHistory::Aggregate &aggregate) { return aggregate.max; });
+    writer.EndObject();
+}
+
+// Bounds for the since/from/to parameters, so adding the log's time offset can't overflow
+static constexpr int64_t MAX_EXPORT_TIME_S = int64_t(1) << 40;
 
-    _registered_handlers.push_back({uri, type, handler});
-    httpd_register_uri_handler(_handle, &uri_handle);
+// False if key is there but isn't an integer, value is left alone if it's missing
+static bool GetQueryInteger(const char *query, const char *key, int64_t &value)
+{
+    char text[24];
+    const esp_err_t result = httpd_query_key_value(query, key, text, sizeof(text));
+    if (result == ESP_ERR_NOT_FOUND)
+    {
+        return true;
+    }
+    if (result != ESP_OK || !JsonReader::ParseInteger(text, value))
+    {
+        return false;
+    }
+    value = std::clamp(value, -MAX_EXPORT_TIME_S, MAX_EXPORT_TIME_S);
+    return true;
 }
 
-std::vector<std::pair<std::string, std::string>> WebUI::ParseJsonKeyValuePairs(const std::string &json)
+esp_err_t WebUI::ExportHistory(httpd_req_t *req, const char *query, std::string_view format_name)
 {
-    if (json.empty() || json[0] != '{')
+    HistoryExport::Format_T format;
+    if (!HistoryExport::ParseFormat(format_name, format))
     {
-        ESP_LOGE(TAG, "Cannot parse json: %s", json.c_str());
-        return {};
+        return httpd_resp_send_err(req, httpd_err_code_t::HTTPD_400_BAD_REQUEST, "Format is csv, ndjson or binary");
     }
 
-    ESP_LOGI(TAG, "Parsing JSON: %s", json.c_str());
-    const auto remove_whitespace_quotes = [](std::string &in_str) -> std::string & {
-        auto next_it = in_str.begin();
+    // since is a record's log time (its seq), from and to are times since boot like everywhere else
+    const int64_t time_offset_s = _sample_log->GetTimeOffsetS();
+    int64_t since = 0;
+    int64_t from = -MAX_EXPORT_TIME_S;
+    int64_t to = MAX_EXPORT_TIME_S;
+    if (!GetQueryInteger(query, "since", since) || !GetQueryInteger(query, "from", from) || !GetQueryInteger(query, "to", to))
+    {
+        return httpd_resp_send_err(req, httpd_err_code_t::HTTPD_400_BAD_REQUEST, "since, from and to are integers");
+    }
+    const int64_t first = std::max({since, from + time_offset_s, int64_t(0)});
+    const int64_t last = std::min(to + time_offset_s, int64_t(UINT32_MAX));
 
-        while (next_it != in_str.end())
+    httpd_resp_set_type(req, HistoryExport::GetContentType(format));
+    HistoryExport history_export(*_sample_log, format, &SendChunk, req);
+    if (!history_export.Write(first, last, time_offset_s))
+    {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, nullptr, 0);
+}
+
+esp_err_t WebUI::HandleGetHistory(httpd_req_t *req)
+{
+    // ?format= exports the whole log in flash, see ExportHistory
+    const size_t query_length = httpd_req_get_url_query_len(req);
+    if (query_length > 0)
+    {
+        char query[MAX_QUERY_LENGTH];
+        char format[8];
+        if (query_length >= sizeof(query) || httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK)
         {
-            auto next_space_it = std::find_if(next_it, in_str.end(), [](char c) {
-                return std::isspace(c) || c == '"';
-            });
-            if (next_space_it != in_str.end())
-            {
-                next_space_it = in_str.erase(next_space_it);
-            }
-            next_it = next_space_it;
+            return httpd_resp_send_err(req, httpd_err_code_t::HTTPD_400_BAD_REQUEST, "Query too long");
         }
-        return in_str;
-    };
+        if (httpd_query_key_value(query, "format", format, sizeof(format)) != ESP_ERR_NOT_FOUND)
+        {
+            return ExportHistory(req, query, format);
+        }
+    }
 
-    std::vector<std::pair<std::string, std::string>> ret_kv_pairs;
-    auto index = 1;
-    bool is_key_not_value = true;
+    // Streamed out in JSON_CHUNK_SIZE chunks, the document is never held in memory
+    httpd_resp_set_type(req, "application/json");
+    char buffer[JSON_CHUNK_SIZE];
+    JsonWriter writer(buffer, sizeof(buffer), &SendChunk, req);
+
+    const auto raw = _history->GetRaw();
+    writer.BeginObject();
+    writer.Key("raw");
+    writer.BeginObject();
+    writer.Key("start");
+    writer.Integer(raw.first_time_s);
+    writer.Key("period");
+    writer.Integer(raw.period_s);
+    WriteHistoryArray(writer, "values", raw.entries, [](TemperatureHistory::Sixteenths value) { return value; });
+    writer.EndObject();
+
+    writer.Key("minute");
+    WriteAggregateSeries(writer, _history->GetMinutes());
+    writer.Key("ten_minute");
+    WriteAggregateSeries(writer, _history->GetTenMinutes());
+    writer.EndObject();
+
+    if (!writer.Flush())
+    {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, nullptr, 0);
+}
 
-    std::pair<std::string, std::string> current_kv;
-    while (true)
+esp_err_t WebUI::HandlePost(httpd_req_t *req)
+{
+    ESP_LOGI(TAG, "Handling POST to set thresholds...");
+    Temperature low_thresh;
+    Temperature high_thresh;
+
+    // Values may be numbers or strings, e.g. {"low":"20.5","high":30}
+    const bool is_object = ReceiveJsonObject(req, [&](std::string_view key, JsonReader::Token_T, std::string_view value) {
+        if (key == "low")
+        {
+            Temperature::Parse(value.data(), value.size(), low_thresh);
+        }
+        else if (key == "high")
+        {
+            Temperature::Parse(value.data(), value.size(), high_thresh);
+        }
+    });
+
+    if (is_object && low_thresh.IsValid() && high_thresh.IsValid() && low_thresh < high_thresh)
     {
-        auto next_index = json.find_first_of(":,}", index);
+        ESP_LOGI(TAG, "Setting low,high alarm thresholds to %.4f, %.4f", low_thresh.ToFloat(), high_thresh.ToFloat());
+        if (_alarm_rules->SetThresholds(std::make_pair(low_thresh, high_thresh)))
+        {
+            return httpd_resp_send(req, "", 0);
+        }
+    }
+
+    ESP_LOGE(TAG, "Could not read low < high thresholds, or they were rejected. Not updating");
+
+    return httpd_resp_send_err(req, httpd_err_code_t::HTTPD_400_BAD_REQUEST, nullptr);
+}
+
+static const char *const RULE_KIND_NAMES[] = {"above", "below", "rising", "falling"};
+static const char *const RULE_ALARM_NAMES[] = {"none", "low", "high"};
 
-        if (next_index == std::string::npos)
+template <size_t N>
+static int FindName(const char *const (&names)[N], std::string_view name)
+{
+    for (size_t i = 0; i < N; i++)
+    {
+        if (name == names[i])
         {
-            break;
+            return static_cast<int>(i);
         }
+    }
+    return -1;
+}
 
-        auto str = json.substr(index, next_index - index);
-        if (is_key_not_value)
+esp_err_t WebUI::HandleGetRules(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    char buffer[JSON_CHUNK_SIZE];
+    JsonWriter writer(buffer, sizeof(buffer), &SendChunk, req);
+    writer.BeginArray();
+    for (const auto &rule_active : _alarm_rules->GetRules())
+    {
+        const auto &rule = rule_active.first;
+        writer.BeginObject();
+        writer.Key("id");
+        writer.Integer(rule.id);
+        writer.Key("kind");
+        writer.String(RULE_KIND_NAMES[rule.kind]);
+        writer.Key("sensor");
+        if (rule.sensor == AlarmRules::PRIMARY_SENSOR)
         {
-            current_kv.first = std::move(remove_whitespace_quotes(str));
-            is_key_not_value = false;
+            writer.String("primary");
         }
         else
         {
-            current_kv.second = std::move(remove_whitespace_quotes(str));
-            ret_kv_pairs.push_back(std::move(current_kv));
-            current_kv = std::make_pair("", "");
-            is_key_not_value = true;
+            char sensor_id[13];
+            snprintf(sensor_id, sizeof(sensor_id), "%012llx", static_cast<unsigned long long>(rule.sensor));
+            writer.String(sensor_id);
         }
-        index = next_index + 1;
+        writer.Key("level");
+        WriteTemperature(writer, rule.level);
+        writer.Key("hysteresis");
+        WriteTemperature(writer, rule.hysteresis);
+        writer.Key("hold");
+        writer.Integer(rule.hold_s);
+        writer.Key("requires");
+        if (rule.requires_id == AlarmRules::NO_RULE)
+        {
+            writer.Null();
+        }
+        else
+        {
+            writer.Integer(rule.requires_id);
+        }
+        writer.Key("alarm");
+        writer.String(RULE_ALARM_NAMES[rule.alarm]);
+        writer.Key("active");
+        writer.Bool(rule_active.second);
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    if (!writer.Flush())
+    {
+        return ESP_FAIL;
     }
+    return httpd_resp_send_chunk(req, nullptr, 0);
+}
 
-    return ret_kv_pairs;
+// Integers may come as numbers or strings, e.g. "hold":600 or "hold":"600"
+static bool ParseUnsigned(std::string_view text, uint64_t max, uint64_t &out)
+{
+    int64_t value;
+    if (!JsonReader::ParseInteger(text, value) || value < 0 || static_cast<uint64_t>(value) > max)
+    {
+        return false;
+    }
+    out = static_cast<uint64_t>(value);
+    return true;
 }
 
-esp_err_t WebUI::HandleRequest(httpd_req_t *req)
+// The 12 hex digit serial number of a sensor
+static bool ParseSensorId(std::string_view text, AlarmRules::SensorId &out)
 {
+    if (text.empty() || text.size() > 12)
+    {
+        return false;
+    }
+    AlarmRules::SensorId sensor = 0;
+    for (const char c : text)
+    {
+        const char lower = static_cast<char>(c | 0x20);
+        if (c >= '0' && c <= '9')
+        {
+            sensor = (sensor << 4) | static_cast<AlarmRules::SensorId>(c - '0');
+        }
+        else if (lower >= 'a' && lower <= 'f')
+        {
+            sensor = (sensor << 4) | static_cast<AlarmRules::SensorId>(lower - 'a' + 10);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    out = sensor;
+    return sensor != AlarmRules::PRIMARY_SENSOR;
+}
+
+esp_err_t WebUI::HandlePostRule(httpd_req_t *req)
+{
+    // Adds one rule, e.g. {"kind":"above","sensor":"primary","level":45,"hysteresis":0.5,"hold":600,"alarm":"high"}
+    Alarm::Rule rule;
+    bool is_valid = true;
+    const bool is_object = ReceiveJsonObject(req, [&](std::string_view key, JsonReader::Token_T token, std::string_view value) {
+        uint64_t number = 0;
+        if (key == "kind")
+        {
+            const int kind = FindName(RULE_KIND_NAMES, value);
+            is_valid = is_valid && kind >= 0;
+            rule.kind = static_cast<AlarmRules::Kind_T>(kind);
+        }
+        else if (key == "sensor")
+        {
+            if (value == "primary")
+            {
+                rule.sensor = AlarmRules::PRIMARY_SENSOR;
+            }
+            else
+            {
+                is_valid = is_valid && ParseSensorId(value, rule.sensor);
+            }
+        }
+        else if (key == "level")
+        {
+            is_valid = is_valid && Temperature::Parse(value.data(), value.size(), rule.level);
+        }
+        else if (key == "hysteresis")
+        {
+            is_valid = is_valid && Temperature::Parse(value.data(), value.size(), rule.hysteresis);
+        }
+        else if (key == "hold")
+        {
+            is_valid = is_valid && ParseUnsigned(value, AlarmRules::MAX_HOLD_S, number);
+            rule.hold_s = static_cast<uint32_t>(number);
+        }
+        else if (key == "requires")
+        {
+            if (token == JsonReader::Token_T::NULL_VALUE || value == "null")
+            {
+                rule.requires_id = AlarmRules::NO_RULE;
+            }
+            else
+            {
+                is_valid = is_valid && ParseUnsigned(value, AlarmRules::NO_RULE - 1, number);
+                rule.requires_id = static_cast<uint16_t>(number);
+            }
+        }
+        else if (key == "alarm")
+        {
+            const int alarm = FindName(RULE_ALARM_NAMES, value);
+            is_valid = is_valid && alarm > 0;
+            rule.alarm = static_cast<Alarm::Alarm_T>(alarm);
+        }
+    });
 
-    auto this_obj = static_cast<WebUI *>(req->user_ctx);
-    const auto &handler_list = this_obj->_registered_handlers;
+    const int id = is_object && is_valid && rule.level.IsValid() ? _alarm_rules->AddRule(rule) : -1;
+    if (id < 0)
+    {
+        ESP_LOGE(TAG, "Could not add rule");
+        return httpd_resp_send_err(req, httpd_err_code_t::HTTPD_400_BAD_REQUEST, nullptr);
+    }
+
+    char buffer[32];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.BeginObject();
+    writer.Key("id");
+    writer.Integer(id);
+    writer.EndObject();
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, writer.GetData(), writer.GetLength());
+}
 
-    auto found_handler_it = std::find_if(handler_list.begin(), handler_list.end(), [&](const RequestHandler &handler) {
-        return req->method == handler.method && handler.uri == std::string(req->uri);
+esp_err_t WebUI::HandleDeleteRule(httpd_req_t *req)
+{
+    // {"id":3}, the built-in threshold rules can't be removed
+    uint64_t id = AlarmRules::NO_RULE;
+    const bool is_object = ReceiveJsonObject(req, [&](std::string_view key, JsonReader::Token_T, std::string_view value) {
+        if (key == "id" && !ParseUnsigned(value, AlarmRules::NO_RULE - 1, id))
+        {
+            id = AlarmRules::NO_RULE;
+        }
     });
 
-    if (found_handler_it == handler_list.end())
+    if (is_object && id < AlarmRules::NO_RULE && _alarm_rules->RemoveRule(static_cast<uint16_t>(id)))
     {
-        ESP_LOGE(TAG, "Could not find handler for URI %s", req->uri);
-        return httpd_resp_send_404(req);
+        return httpd_resp_send(req, "", 0);
     }
 
-    return found_handler_it->handler_fn(req);
+    ESP_LOGE(TAG, "Could not remove rule");
+    return httpd_resp_send_err(req, httpd_err_code_t::HTTPD_400_BAD_REQUEST, nullptr);
+}
+
+esp_err_t WebUI::HandleRequest(httpd_req_t *req)
+{
+    auto this_obj = static_cast<WebUI *>(httpd_get_global_user_ctx(req->handle));
+    const auto route = static_cast<const Route *>(req->user_ctx);
+    return (this_obj->*route->handler)(req);
 }
@@ -1,37 +1,94 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <memory>
-#include <functional>
+#include <mutex>
+#include <string_view>
 #include <vector>
 
 #include "esp_http_server.h"
+#include "Alarm.hpp"
 #include "DataBinding.hpp"
+#include "SampleLog.hpp"
+#include "Temperature.hpp"
+#include "TemperatureHistory.hpp"
+#include "TemperatureTrend.hpp"
 
 class WebUI {
-    struct RequestHandler {
-        std::string uri;
+public:
+    static constexpr size_t MAX_STREAM_CLIENTS = 4; // Out of CONFIG_LWIP_MAX_SOCKETS, the rest is left for requests
+private:
+    // Registered with httpd as the user_ctx, so a request goes straight to its handler without any matching
+    struct Route {
+        const char* uri;
         httpd_method_t method;
-        std::function<esp_err_t(httpd_req_t*)> handler_fn;
+        esp_err_t (WebUI::*handler)(httpd_req_t*);
+        bool is_websocket;
+    };
+    static const Route ROUTES[];
+
+    // Body of a GET that only depends on one binding, formatted again when the binding's version moves.
+    // Only touched from handlers, which all run on the httpd task.
+    struct CachedResponse {
+        static constexpr size_t MAX_BODY_SIZE = 64;
+        bool is_valid = false;
+        uint32_t version = 0;
+        char etag[24]; // "<boot id>-<version>"
+        char body[MAX_BODY_SIZE];
+        size_t length = 0;
     };
 
-    std::vector<RequestHandler> _registered_handlers;
     httpd_config_t _config;
     httpd_handle_t _handle;
-    std::shared_ptr<DataBinding<double>> _temperature_source;
-    std::shared_ptr<DataBinding<std::pair<double, double>>> _alarm_threshold_binding;
+    std::shared_ptr<DataBinding<Temperature>> _temperature_source;
+    std::shared_ptr<DataBinding<std::pair<Temperature, Temperature>>> _alarm_threshold_binding;
+    std::shared_ptr<Alarm> _alarm_rules;
+    std::shared_ptr<DataBinding<TemperatureTrend::Fit>> _trend_source;
+    std::shared_ptr<const TemperatureHistory> _history;
+    std::shared_ptr<SampleLog> _sample_log;
+
+    // Tells versions from before a reset apart, they start over at 0
+    uint32_t _boot_id;
+    CachedResponse _temperature_response;
+    CachedResponse _thresholds_response;
+
+    // WebSocket clients of /stream, each sample is formatted once and sent to all of them
+    std::mutex _stream_lock;
+    std::array<int, MAX_STREAM_CLIENTS> _stream_fds;
+    size_t _stream_fd_count = 0;
+    char _stream_buffer[Temperature::MAX_FORMATTED_SIZE];
+    size_t _stream_length = 0;
+    bool _is_stream_send_queued = false;
 
     static esp_err_t HandleRequest(httpd_req_t *req);
+    static void HandleClose(httpd_handle_t handle, int sockfd);
+    static void SendStream(void* arg); // Runs on the httpd task
+    void OnTemperature(Temperature temperature);
+    void RemoveStreamClient(int sockfd); // Call with _stream_lock held
+    // Sends cache, calling format(buffer, size) -> length first if it is older than version. Sends
+    // 304 when the client's If-None-Match has this version.
+    template <typename Format>
+    esp_err_t SendCached(httpd_req_t *req, CachedResponse &cache, uint32_t version, Format format);
 
-    esp_err_t HandleGetForm(httpd_req_t *req);
+    esp_err_t HandleGetAsset(httpd_req_t *req);
     esp_err_t HandleGetTemp(httpd_req_t *req);
     esp_err_t HandleGetThresholds(httpd_req_t *req);
+    esp_err_t HandleGetEta(httpd_req_t *req);
+    esp_err_t HandleGetHistory(httpd_req_t *req);
+    esp_err_t ExportHistory(httpd_req_t *req, const char *query, std::string_view format_name);
     esp_err_t HandlePost(httpd_req_t *req);
-
-    void RegisterHandler(httpd_method_t type, const std::string& uri, const std::function<esp_err_t(httpd_req_t*)>& handler);
+    esp_err_t HandleGetRules(httpd_req_t *req);
+    esp_err_t HandlePostRule(httpd_req_t *req);
+    esp_err_t HandleDeleteRule(httpd_req_t *req);
+    esp_err_t HandleStream(httpd_req_t *req);
     
-    static std::vector<std::pair<std::string, std::string>> ParseJsonKeyValuePairs(const std::string& json);
 public:
-    WebUI(const std::shared_ptr<DataBinding<double>>& temperature_source,
-    const std::shared_ptr<DataBinding<std::pair<double, double>>>& alarm_threshold_binding);
+    WebUI(const std::shared_ptr<DataBinding<Temperature>>& temperature_source,
+    const std::shared_ptr<DataBinding<std::pair<Temperature, Temperature>>>& alarm_threshold_binding,
+    const std::shared_ptr<Alarm>& alarm_rules,
+    const std::shared_ptr<DataBinding<TemperatureTrend::Fit>>& trend_source,
+    const std::shared_ptr<const TemperatureHistory>& history,
+    const std::shared_ptr<SampleLog>& sample_log);
     ~WebUI();
 };
\ No newline at end of file
@@ -16,39 +16,55 @@
 #include "nvs_flash.h"
 #include "WebUI.hpp"
 
-#include "DS18B20.hpp"
+#include "AdaptiveSampler.hpp"
+#include "ConversionScheduler.hpp"
+#include "DS18B20BusGroup.hpp"
 #include "mDns.hpp"
 #include "DataBinding.hpp"
 #include "WifiStation.hpp"
 #include "Audio.hpp"
+#include "Melody.hpp"
 #include "Alarm.hpp"
+#include "SettingsStore.hpp"
+#include "TemperatureHistory.hpp"
+#include "PartitionFlashStorage.hpp"
+#include "SampleLog.hpp"
+#include "EventDispatcher.hpp"
+#include "TemperatureFilter.hpp"
+#include "TemperatureTrend.hpp"
 
 static const char* TAG = "main";
 
 #define AUDIO_GPIO_PIN GPIO_NUM_21
-#define TEMP_SENSOR_GPIO_PIN GPIO_NUM_12
+// One 1-Wire bus per pin, read in parallel
+#define TEMP_SENSOR_GPIO_PINS {GPIO_NUM_12}
 
-extern "C" {
-	void app_main(void);
-}
+// The alarm is event driven, the main loop only looks after the WiFi connection
+static constexpr auto WIFI_CHECK_PERIOD = std::chrono::seconds(5);
 
-struct TemperatureTaskData {
-  std::shared_ptr<DS18B20> temp_sensor;
-  std::shared_ptr<DataBinding<double>> data_source;
-};
+// Two second notes with two second rests
+static constexpr std::string_view HIGH_ALARM_MELODY = "high:d=4,o=4,b=30:a,p,a,p,a";
+static constexpr std::string_view LOW_ALARM_MELODY = "low:d=4,o=4,b=30:g,p,g,p,g";
 
-void TemperatureTaskWorker(void * param)
+// A flapping alarm doesn't pile up beeps, the tune is only queued again once it finished
+static void PlayAlarm(Audio& audio, Alarm::Alarm_T alarm_type)
 {
-  std::unique_ptr<TemperatureTaskData> data = std::unique_ptr<TemperatureTaskData>(static_cast<TemperatureTaskData*>(param));
-
-  while (true) {
-    auto temp = data->temp_sensor->ReadTemperature();
-    if (temp != DS18B20::INVALID_TEMP) {
-      data->data_source->SetValue(temp);
-    }
+  switch (alarm_type) {
+    case Alarm::Alarm_T::HIGH:
+      audio.PlayTune(Melody::Compiled<HIGH_ALARM_MELODY>, Audio::Priority_T::ALARM);
+      break;
+    case Alarm::Alarm_T::LOW:
+      audio.PlayTune(Melody::Compiled<LOW_ALARM_MELODY>, Audio::Priority_T::ALARM);
+      break;
+      default:
+      break;
   }
 }
 
+extern "C" {
+	void app_main(void);
+}
+
 void app_main(void)
 {
   esp_err_t ret = nvs_flash_init();
@@ -65,17 +81,82 @@ void app_main(void)
   WifiStation station(WIFI_SSID, WIFI_PASSWORD);
   mDns::AddHttpService("yogalarm", "Yogurt Alarm");
 
-  auto temp_sensor = std::make_shared<DS18B20>(TEMP_SENSOR_GPIO_PIN);
-  auto temperature_source = std::make_shared<DataSourceSingleValue<double>>(DS18B20::INVALID_TEMP);
-  auto alarm = std::make_shared<Alarm>();
+  auto temp_sensors = std::make_shared<DS18B20BusGroup>(std::vector<gpio_num_t> TEMP_SENSOR_GPIO_PINS);
+  auto temperature_source = std::make_shared<DataSourceSeqLock<Temperature>>(Temperature::Invalid());
+  // Every sensor, and the primary one's raw and filtered value side by side, for the alarm rules
+  auto reading_source = std::make_shared<DataSourceSeqLock<AlarmRules::Readings>>(AlarmRules::Readings());
+  auto filter = std::make_shared<TemperatureFilter>();
+  auto trend = std::make_shared<TemperatureTrend>();
+  auto trend_source = std::make_shared<DataSourceSeqLock<TemperatureTrend::Fit>>(TemperatureTrend::Fit());
+  auto settings = std::make_shared<SettingsStore>("storage");
+  auto alarm = std::make_shared<Alarm>(settings);
+  auto history = std::make_shared<TemperatureHistory>();
+
+  // Rebuild the history from flash before new samples come in
+  auto sample_log = std::make_shared<SampleLog>(std::make_shared<PartitionFlashStorage>("samplelog"));
+  if (sample_log->Open(esp_timer_get_time())) {
+    sample_log->Replay([&history](int64_t timestamp_us, Temperature temperature) {
+      history->Add(timestamp_us, temperature);
+    });
+  } else {
+    ESP_LOGE(TAG, "Sample log unavailable, history won't survive a reset");
+  }
 
   Audio audio(AUDIO_GPIO_PIN);
 
 
-  WebUI _web_ui(temperature_source, alarm);
+  WebUI _web_ui(temperature_source, alarm, alarm, trend_source, history, sample_log);
 
-  TaskHandle_t temperature_task;
-  xTaskCreate(TemperatureTaskWorker, "Temperature Task", 3072, new TemperatureTaskData {temp_sensor, temperature_source}, tskIDLE_PRIORITY + 3, &temperature_task);
+  ConversionScheduler conversion_scheduler;
+  AdaptiveSampler sampler(temp_sensors, alarm, trend_source, conversion_scheduler,
+                          [temperature_source, reading_source, filter, trend, trend_source, history, sample_log](const DS18B20BusGroup::Sample& sample) {
+    AlarmRules::Readings readings;
+    readings.timestamp_us = sample.timestamp_us;
+    readings.is_partial = sample.is_partial;
+    for (const auto& sensor_reading : sample.readings) {
+      if (readings.sensor_count == AlarmRules::MAX_SENSORS) {
+        break;
+      }
+      readings.sensor_ids[readings.sensor_count] = AlarmRules::GetSensorId(sensor_reading.rom_code);
+      readings.sensor_values[readings.sensor_count] = sensor_reading.temperature;
+      ++readings.sensor_count;
+    }
+
+    // Alarm Search reads only have the flagged sensors. The filter, the UI and the history only take
+    // full reads, the primary value stays the one from the last of those.
+    const auto* primary = sample.GetPrimary();
+    if (sample.is_partial || primary == nullptr || !primary->IsValid()) {
+      if (sample.is_partial) {
+        readings.primary = reading_source->GetValue().primary;
+      }
+      reading_source->SetValue(readings);
+      return;
+    }
+
+    const auto filtered = filter->Process(sample.timestamp_us, primary->temperature);
+    readings.primary = filtered;
+    reading_source->SetValue(readings);
+    // Rejected glitches don't make it to the UI or the history
+    if (!filtered.is_rejected) {
+      temperature_source->SetValue(filtered.filtered);
+      history->Add(sample.timestamp_us, filtered.filtered);
+      if (trend->Add(sample.timestamp_us, filtered.filtered)) {
+        trend_source->SetValue(trend->GetFit());
+      }
+      sample_log->Append(sample.timestamp_us, filtered.filtered);
+    }
+  });
+
+  // Evaluate the alarm as soon as a reading or threshold changes
+  EventDispatcher dispatcher;
+  reading_source->Subscribe(dispatcher.Defer<AlarmRules::Readings>([alarm, &audio](const AlarmRules::Readings& readings) {
+    PlayAlarm(audio, alarm->Evaluate(readings));
+  }));
+  alarm->Subscribe(dispatcher.Defer<std::pair<Temperature, Temperature>>([alarm, reading_source, &audio](const std::pair<Temperature, Temperature>&) {
+    PlayAlarm(audio, alarm->Evaluate(reading_source->GetValue()));
+  }));
+
+  sampler.Start();
  
 
   while(true) {
@@ -84,28 +165,6 @@ void app_main(void)
       station.Connect();
     }
 
-    switch (alarm->Evaluate(temperature_source->GetValue())){ 
-      case Alarm::Alarm_T::HIGH:
-        audio.PlayTune({
-        Audio::Beep{std::chrono::seconds(2), 440},
-        Audio::Beep{std::chrono::seconds(2), -1},
-        Audio::Beep{std::chrono::seconds(2), 440},
-        Audio::Beep{std::chrono::seconds(2), -1},
-        Audio::Beep{std::chrono::seconds(2), 440}
-        });
-        break;
-      case Alarm::Alarm_T::LOW:
-        audio.PlayTune({
-        Audio::Beep{std::chrono::seconds(2), 392},
-        Audio::Beep{std::chrono::seconds(2), -1},
-        Audio::Beep{std::chrono::seconds(2), 392},
-        Audio::Beep{std::chrono::seconds(2), -1},
-        Audio::Beep{std::chrono::seconds(2), 392}
-        });
-        break;
-        default:
-        break;
-    }
-    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    std::this_thread::sleep_for(WIFI_CHECK_PERIOD);
   }
 }
\ No newline at end of file
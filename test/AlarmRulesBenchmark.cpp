@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Benchmark.hpp"
+
+#include "AlarmRules.hpp"
+
+namespace {
+    constexpr size_t RULE_COUNT = AlarmRules::MAX_RULES;
+    constexpr size_t SENSOR_COUNT = AlarmRules::MAX_SENSORS;
+    constexpr size_t SAMPLE_COUNT = 2000;
+    constexpr size_t COMPILE_REPEAT_COUNT = 20;
+
+    // Every kind, levels around room temperature, some holds and some rules requiring an earlier one
+    std::vector<AlarmRules::Rule> MakeRules(std::mt19937& random)
+    {
+        std::uniform_int_distribution<int> kind(AlarmRules::ABOVE, AlarmRules::FALLING);
+        std::uniform_int_distribution<size_t> sensor(0, SENSOR_COUNT - 1);
+        std::uniform_int_distribution<int> level(15 * 16, 35 * 16);
+        std::uniform_int_distribution<int> rate(1, 3 * 16);
+        std::uniform_int_distribution<int> hysteresis(0, 2 * 16);
+        std::uniform_int_distribution<int> hold_s(0, 600);
+        std::uniform_int_distribution<int> one_in(0, 7);
+
+        std::vector<AlarmRules::Rule> rules(RULE_COUNT);
+        for (size_t i = 0; i < RULE_COUNT; i++) {
+            auto& rule = rules[i];
+            rule.id = static_cast<uint16_t>(i);
+            rule.kind = static_cast<AlarmRules::Kind_T>(kind(random));
+            rule.sensor = 0xA0 + sensor(random);
+            const bool is_rate = rule.kind == AlarmRules::RISING || rule.kind == AlarmRules::FALLING;
+            rule.level = Temperature::FromSixteenths(static_cast<int16_t>(is_rate ? rate(random) : level(random)));
+            rule.hysteresis = Temperature::FromSixteenths(static_cast<int16_t>(hysteresis(random)));
+            rule.hold_s = one_in(random) < 2 ? static_cast<uint32_t>(hold_s(random)) : 0;
+            if (i > 0 && one_in(random) == 0) {
+                rule.requires_id = static_cast<uint16_t>(std::uniform_int_distribution<size_t>(0, i - 1)(random));
+            }
+            rule.alarm = rule.kind == AlarmRules::BELOW || rule.kind == AlarmRules::FALLING ? AlarmRules::LOW : AlarmRules::HIGH;
+        }
+        return rules;
+    }
+
+    // Every sensor once a second, each wandering on its own between about 10 and 40C
+    std::vector<AlarmRules::Readings> MakeSamples(std::mt19937& random)
+    {
+        std::uniform_int_distribution<int> step(-3, 3);
+        std::vector<int> sixteenths(SENSOR_COUNT, 25 * 16);
+        std::vector<AlarmRules::Readings> samples(SAMPLE_COUNT);
+        for (size_t i = 0; i < SAMPLE_COUNT; i++) {
+            auto& readings = samples[i];
+            readings.timestamp_us = static_cast<int64_t>(i) * 1000000;
+            readings.sensor_count = SENSOR_COUNT;
+            for (size_t j = 0; j < SENSOR_COUNT; j++) {
+                sixteenths[j] = std::min(std::max(sixteenths[j] + step(random), 10 * 16), 40 * 16);
+                readings.sensor_ids[j] = 0xA0 + j;
+                readings.sensor_values[j] = Temperature::FromSixteenths(static_cast<int16_t>(sixteenths[j]));
+            }
+        }
+        return samples;
+    }
+}
+
+int main()
+{
+    std::mt19937 random(16);
+    const auto rules = MakeRules(random);
+    const auto samples = MakeSamples(random);
+
+    const auto compile = Benchmark::Measure(COMPILE_REPEAT_COUNT, [&]() {
+        AlarmRules compiled;
+        Benchmark::KeepAlive(compiled.SetRules(rules));
+    });
+
+    AlarmRules compiled;
+    if (!compiled.SetRules(rules)) {
+        printf("The rules were rejected\n");
+        return 1;
+    }
+    size_t sample_index = 0;
+    size_t alarm_count = 0;
+    const auto evaluate = Benchmark::Measure(SAMPLE_COUNT - 1, [&]() {
+        const auto& readings = samples[sample_index++];
+        alarm_count += compiled.Evaluate(readings, Temperature::FromDegrees(25)) != AlarmRules::NONE ? 1 : 0;
+    });
+
+    printf("%zu rules over %zu sensors, %zu samples, %zu alarms\n", rules.size(), SENSOR_COUNT, SAMPLE_COUNT, alarm_count);
+    printf("compile:  %10.1f ns/rule %10.1f cycles/rule\n", compile.ns / RULE_COUNT, compile.cycles / RULE_COUNT);
+    printf("evaluate: %10.1f ns/sample %8.1f cycles/sample, %.2f ns/rule %.1f cycles/rule\n",
+           evaluate.ns, evaluate.cycles, evaluate.ns / RULE_COUNT, evaluate.cycles / RULE_COUNT);
+    return 0;
+}
@@ -0,0 +1,250 @@
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#include "TestHarness.hpp"
+
+#include "AlarmRules.hpp"
+
+namespace {
+    using Rule = AlarmRules::Rule;
+
+    constexpr AlarmRules::SensorId PROBE = 0x0000000000A1;
+    constexpr AlarmRules::SensorId OTHER_PROBE = 0x0000000000B2;
+
+    Temperature Degrees(float degrees)
+    {
+        return Temperature::FromFloat(degrees);
+    }
+
+    Rule MakeRule(uint16_t id, AlarmRules::Kind_T kind, float level, AlarmRules::SensorId sensor = AlarmRules::PRIMARY_SENSOR)
+    {
+        Rule rule;
+        rule.id = id;
+        rule.kind = kind;
+        rule.level = Degrees(level);
+        rule.sensor = sensor;
+        rule.alarm = kind == AlarmRules::BELOW || kind == AlarmRules::FALLING ? AlarmRules::LOW : AlarmRules::HIGH;
+        return rule;
+    }
+
+    AlarmRules::Readings MakeReadings(double time_s, std::initializer_list<std::pair<AlarmRules::SensorId, float>> sensors = {}, bool is_partial = false)
+    {
+        AlarmRules::Readings readings;
+        readings.timestamp_us = static_cast<int64_t>(time_s * 1000000);
+        readings.is_partial = is_partial;
+        for (const auto& sensor : sensors) {
+            readings.sensor_ids[readings.sensor_count] = sensor.first;
+            readings.sensor_values[readings.sensor_count] = Degrees(sensor.second);
+            ++readings.sensor_count;
+        }
+        return readings;
+    }
+
+    // Primary sensor only
+    AlarmRules::Alarm_T EvaluatePrimary(AlarmRules& rules, double time_s, float degrees)
+    {
+        return rules.Evaluate(MakeReadings(time_s), Degrees(degrees));
+    }
+}
+
+TEST(AboveFiresAfterHold)
+{
+    AlarmRules rules;
+    auto rule = MakeRule(1, AlarmRules::ABOVE, 30);
+    rule.hold_s = 10;
+    CHECK(rules.SetRules({rule}));
+
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 0, 31));
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 9.9, 31));
+    CHECK_EQUAL(AlarmRules::HIGH, EvaluatePrimary(rules, 10, 31));
+    CHECK(rules.IsActive(1));
+    // Fires once, not again on every sample while active
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 11, 31));
+
+    // Dipping below the level restarts the hold
+    CHECK(rules.SetRules({}));
+    CHECK(rules.SetRules({rule}));
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 20, 31));
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 25, 29));
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 30, 31));
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 39, 31));
+    CHECK_EQUAL(AlarmRules::HIGH, EvaluatePrimary(rules, 40, 31));
+}
+
+TEST(HysteresisKeepsRuleActive)
+{
+    AlarmRules rules;
+    CHECK(rules.SetRules({MakeRule(1, AlarmRules::ABOVE, 30)}));
+
+    CHECK_EQUAL(AlarmRules::HIGH, EvaluatePrimary(rules, 0, 30));
+    // Inside the default 0.5C band it stays active and doesn't fire again
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 1, 29.5f));
+    CHECK(rules.IsActive(1));
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 2, 30.5f));
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 3, 29.4375f));
+    CHECK(!rules.IsActive(1));
+    CHECK_EQUAL(AlarmRules::HIGH, EvaluatePrimary(rules, 4, 30));
+}
+
+TEST(BelowIsMirrored)
+{
+    AlarmRules rules;
+    auto rule = MakeRule(1, AlarmRules::BELOW, 10);
+    rule.hysteresis = Degrees(1);
+    CHECK(rules.SetRules({rule}));
+
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 0, 10.0625f));
+    CHECK_EQUAL(AlarmRules::LOW, EvaluatePrimary(rules, 1, 10));
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 2, 11));
+    CHECK(rules.IsActive(1));
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 3, 11.0625f));
+    CHECK(!rules.IsActive(1));
+}
+
+TEST(RisingUsesRateOverPeriod)
+{
+    AlarmRules rules;
+    CHECK(rules.SetRules({MakeRule(1, AlarmRules::RISING, 1)}));
+
+    // 0.5C in 10s is 3C/min, only known once 10s have passed
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 0, 20));
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 5, 20.25f));
+    CHECK_EQUAL(AlarmRules::HIGH, EvaluatePrimary(rules, 10, 20.5f));
+    // Flat for the next period clears it
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 20, 20.5f));
+    CHECK(!rules.IsActive(1));
+}
+
+TEST(RequiredRuleGates)
+{
+    AlarmRules rules;
+    // Listed before the rule it requires, compiling puts it after
+    auto gated = MakeRule(2, AlarmRules::ABOVE, 25, PROBE);
+    gated.requires_id = 1;
+    CHECK(rules.SetRules({gated, MakeRule(1, AlarmRules::ABOVE, 30)}));
+    CHECK_EQUAL(1, rules.GetRules()[0].id);
+
+    CHECK_EQUAL(AlarmRules::NONE, rules.Evaluate(MakeReadings(0, {{PROBE, 26}}), Degrees(20)));
+    CHECK(!rules.IsActive(2));
+    CHECK_EQUAL(AlarmRules::HIGH, rules.Evaluate(MakeReadings(1, {{PROBE, 26}}), Degrees(31)));
+    CHECK(rules.IsActive(1));
+    CHECK(rules.IsActive(2));
+    // Drops out with the rule it requires
+    CHECK_EQUAL(AlarmRules::NONE, rules.Evaluate(MakeReadings(2, {{PROBE, 26}}), Degrees(20)));
+    CHECK(!rules.IsActive(2));
+}
+
+TEST(BadRuleSetsAreRejected)
+{
+    AlarmRules rules;
+    const auto good = MakeRule(1, AlarmRules::ABOVE, 30);
+    CHECK(rules.SetRules({good}));
+
+    CHECK(!rules.SetRules({good, good}));
+
+    auto missing = MakeRule(2, AlarmRules::ABOVE, 30);
+    missing.requires_id = 7;
+    CHECK(!rules.SetRules({missing}));
+
+    auto first = MakeRule(2, AlarmRules::ABOVE, 30);
+    auto second = MakeRule(3, AlarmRules::ABOVE, 30);
+    first.requires_id = 3;
+    second.requires_id = 2;
+    CHECK(!rules.SetRules({first, second}));
+
+    auto too_long = MakeRule(2, AlarmRules::ABOVE, 30);
+    too_long.hold_s = AlarmRules::MAX_HOLD_S + 1;
+    CHECK(!rules.SetRules({too_long}));
+    too_long.hold_s = AlarmRules::MAX_HOLD_S;
+    CHECK(rules.SetRules({good, too_long}));
+
+    auto bad_kind = MakeRule(4, AlarmRules::ABOVE, 30);
+    bad_kind.kind = static_cast<AlarmRules::Kind_T>(AlarmRules::FALLING + 1);
+    CHECK(!rules.SetRules({good, bad_kind}));
+    auto no_alarm = MakeRule(4, AlarmRules::ABOVE, 30);
+    no_alarm.alarm = AlarmRules::NONE;
+    CHECK(!rules.SetRules({good, no_alarm}));
+    auto bad_alarm = MakeRule(4, AlarmRules::ABOVE, 30);
+    bad_alarm.alarm = static_cast<AlarmRules::Alarm_T>(7);
+    CHECK(!rules.SetRules({good, bad_alarm}));
+
+    // A rejected set leaves the rules as they were
+    CHECK(!rules.SetRules({good, good}));
+    CHECK_EQUAL(2u, rules.GetRules().size());
+}
+
+TEST(LongestHoldDoesNotOverflow)
+{
+    AlarmRules rules;
+    auto rule = MakeRule(1, AlarmRules::ABOVE, 30);
+    rule.hold_s = AlarmRules::MAX_HOLD_S;
+    CHECK(rules.SetRules({rule}));
+
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, 0, 31));
+    CHECK_EQUAL(AlarmRules::NONE, EvaluatePrimary(rules, AlarmRules::MAX_HOLD_S - 1, 31));
+    CHECK_EQUAL(AlarmRules::HIGH, EvaluatePrimary(rules, AlarmRules::MAX_HOLD_S, 31));
+}
+
+TEST(UnchangedRulesKeepTheirState)
+{
+    AlarmRules rules;
+    const auto rule = MakeRule(1, AlarmRules::ABOVE, 30);
+    CHECK(rules.SetRules({rule}));
+    CHECK_EQUAL(AlarmRules::HIGH, EvaluatePrimary(rules, 0, 31));
+
+    CHECK(rules.SetRules({rule, MakeRule(2, AlarmRules::BELOW, 10)}));
+    CHECK(rules.IsActive(1));
+
+    // An edited rule starts over
+    auto edited = rule;
+    edited.level = Degrees(29);
+    CHECK(rules.SetRules({edited}));
+    CHECK(!rules.IsActive(1));
+}
+
+TEST(PartialReadsKeepHoldOfAbsentSensors)
+{
+    AlarmRules rules;
+    auto rule = MakeRule(1, AlarmRules::ABOVE, 30, PROBE);
+    rule.hold_s = 10;
+    auto primary_rule = MakeRule(2, AlarmRules::ABOVE, 30);
+    primary_rule.hold_s = 10;
+    CHECK(rules.SetRules({rule, primary_rule}));
+
+    CHECK_EQUAL(AlarmRules::NONE, rules.Evaluate(MakeReadings(0, {{PROBE, 31}, {OTHER_PROBE, 20}}), Degrees(31)));
+    // Alarm Search reads that only flagged another sensor, the primary value isn't updated either
+    CHECK_EQUAL(AlarmRules::NONE, rules.Evaluate(MakeReadings(5, {{OTHER_PROBE, 50}}, true), Temperature::Invalid()));
+    CHECK_EQUAL(AlarmRules::HIGH, rules.Evaluate(MakeReadings(10, {{OTHER_PROBE, 50}}, true), Temperature::Invalid()));
+    CHECK(rules.IsActive(1));
+    CHECK(rules.IsActive(2));
+
+    // A full read without the sensor means it is gone, its hold starts over
+    CHECK(rules.SetRules({}));
+    CHECK(rules.SetRules({rule}));
+    CHECK_EQUAL(AlarmRules::NONE, rules.Evaluate(MakeReadings(20, {{PROBE, 31}}), Degrees(20)));
+    CHECK_EQUAL(AlarmRules::NONE, rules.Evaluate(MakeReadings(25, {}), Degrees(20)));
+    CHECK_EQUAL(AlarmRules::NONE, rules.Evaluate(MakeReadings(30, {{PROBE, 31}}), Degrees(20)));
+    CHECK(!rules.IsActive(1));
+}
+
+TEST(AlarmBandCoversSensorRules)
+{
+    AlarmRules rules;
+    CHECK(rules.SetRules({MakeRule(0, AlarmRules::BELOW, 5), MakeRule(1, AlarmRules::ABOVE, 45),
+                          MakeRule(2, AlarmRules::ABOVE, 35.5f, PROBE), MakeRule(3, AlarmRules::BELOW, 10, PROBE),
+                          MakeRule(4, AlarmRules::RISING, 1, OTHER_PROBE)}));
+
+    // The primary sensor's rules apply to every sensor, any of them may be the primary one
+    const auto probe_band = rules.GetAlarmBand(PROBE);
+    CHECK(probe_band.first == Degrees(10));
+    CHECK(probe_band.second == Degrees(35.5f));
+    const auto other_band = rules.GetAlarmBand(OTHER_PROBE);
+    CHECK(other_band.first == Degrees(5));
+    CHECK(other_band.second == Degrees(45));
+
+    // With no rules nothing gets flagged
+    CHECK(rules.SetRules({}));
+    CHECK(rules.GetAlarmBand(PROBE).first == Temperature::FromDegrees(-55));
+    CHECK(rules.GetAlarmBand(PROBE).second == Temperature::FromDegrees(125));
+}
@@ -0,0 +1,95 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Benchmark.hpp"
+
+#include "DataBinding.hpp"
+#include "Temperature.hpp"
+
+namespace {
+    using Thresholds = std::pair<Temperature, Temperature>;
+
+    constexpr auto RUN_TIME = std::chrono::milliseconds(300);
+    const int READER_COUNTS[] = {1, 2, 4, 8};
+
+    struct Contention {
+        double ns_per_read;
+        uint64_t write_count;
+    };
+
+    // Readers call GetValue in a loop while one writer calls SetValue as fast as it can, the worst
+    // case of the sensor task against the main loop and the HTTP handlers
+    Contention Run(DataBinding<Thresholds>& binding, int reader_count)
+    {
+        std::atomic<bool> is_started{false};
+        std::atomic<bool> is_running{true};
+        std::atomic<uint64_t> write_count{0};
+        std::vector<double> ns_per_read(reader_count);
+
+        std::thread writer([&] {
+            while (!is_started.load()) {
+                std::this_thread::yield();
+            }
+            uint64_t writes = 0;
+            while (is_running.load(std::memory_order_relaxed)) {
+                const auto level = Temperature::FromSixteenths(static_cast<int16_t>(writes & 0x3FF));
+                binding.SetValue({level, level});
+                ++writes;
+            }
+            write_count = writes;
+        });
+
+        std::vector<std::thread> readers;
+        for (int i = 0; i < reader_count; i++) {
+            readers.emplace_back([&, i] {
+                while (!is_started.load()) {
+                    std::this_thread::yield();
+                }
+                uint64_t reads = 0;
+                const auto start = std::chrono::steady_clock::now();
+                while (is_running.load(std::memory_order_relaxed)) {
+                    Benchmark::KeepAlive(binding.GetValue());
+                    ++reads;
+                }
+                const auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                ns_per_read[i] = reads > 0 ? ns / static_cast<double>(reads) : 0.;
+            });
+        }
+
+        is_started = true;
+        std::this_thread::sleep_for(RUN_TIME);
+        is_running = false;
+        writer.join();
+        for (auto& reader : readers) {
+            reader.join();
+        }
+
+        double total_ns = 0.;
+        for (const double ns : ns_per_read) {
+            total_ns += ns;
+        }
+        return {total_ns / reader_count, write_count.load()};
+    }
+}
+
+int main()
+{
+    // With fewer cores than threads the time a reader spends descheduled counts too
+    printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    printf("readers  seqlock ns/read (writes)   mutex ns/read (writes)\n");
+    for (const int reader_count : READER_COUNTS) {
+        DataSourceSeqLock<Thresholds> seq_lock({Temperature::FromDegrees(4), Temperature::FromDegrees(30)});
+        DataSourceSingleValue<Thresholds> single_value({Temperature::FromDegrees(4), Temperature::FromDegrees(30)});
+        const auto seq_lock_result = Run(seq_lock, reader_count);
+        const auto single_value_result = Run(single_value, reader_count);
+        printf("%7d  %15.1f (%8llu)   %13.1f (%8llu)\n", reader_count,
+               seq_lock_result.ns_per_read, static_cast<unsigned long long>(seq_lock_result.write_count),
+               single_value_result.ns_per_read, static_cast<unsigned long long>(single_value_result.write_count));
+    }
+    return 0;
+}
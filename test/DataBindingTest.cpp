@@ -0,0 +1,129 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "TestHarness.hpp"
+
+#include "DataBinding.hpp"
+
+namespace {
+    // Every field is derived from the counter, so a torn read breaks the pattern
+    struct Pattern {
+        uint32_t counter;
+        uint32_t words[5];
+        uint8_t tail[3]; // Not a whole number of words
+
+        static Pattern Make(uint32_t counter) {
+            Pattern pattern = {};
+            pattern.counter = counter;
+            for (uint32_t i = 0; i < 5; i++) {
+                pattern.words[i] = counter * (i + 3) ^ 0xA5A5A5A5;
+            }
+            for (uint32_t i = 0; i < 3; i++) {
+                pattern.tail[i] = static_cast<uint8_t>(counter >> (8 * i));
+            }
+            return pattern;
+        }
+
+        [[nodiscard]] bool IsIntact() const {
+            const Pattern expected = Make(counter);
+            for (size_t i = 0; i < 5; i++) {
+                if (words[i] != expected.words[i]) {
+                    return false;
+                }
+            }
+            return tail[0] == expected.tail[0] && tail[1] == expected.tail[1] && tail[2] == expected.tail[2];
+        }
+    };
+
+    constexpr uint32_t WRITES_PER_WRITER = 200000;
+    constexpr int READER_COUNT = 4;
+}
+
+TEST(SeqLockReadersNeverSeeTornValues)
+{
+    DataSourceSeqLock<Pattern> binding(Pattern::Make(0));
+    std::atomic<bool> is_writing{true};
+    std::atomic<int> torn_reads{0};
+    std::atomic<int> stale_reads{0};
+    std::atomic<uint64_t> read_count{0};
+
+    // Readers also check the version contract: a value read after a version is at least that new
+    std::vector<std::thread> readers;
+    for (int i = 0; i < READER_COUNT; i++) {
+        readers.emplace_back([&] {
+            uint32_t last_counter = 0;
+            uint64_t reads = 0;
+            while (is_writing.load(std::memory_order_relaxed)) {
+                const uint32_t version = binding.GetVersion();
+                const Pattern value = binding.GetValue();
+                if (!value.IsIntact()) {
+                    ++torn_reads;
+                }
+                if (value.counter < version || value.counter < last_counter) {
+                    ++stale_reads;
+                }
+                last_counter = value.counter;
+                ++reads;
+            }
+            read_count += reads;
+        });
+    }
+
+    // A single writer, so the counter and the version move in step
+    for (uint32_t counter = 1; counter <= WRITES_PER_WRITER; counter++) {
+        binding.SetValue(Pattern::Make(counter));
+    }
+    is_writing = false;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    CHECK_EQUAL(0, torn_reads.load());
+    CHECK_EQUAL(0, stale_reads.load());
+    CHECK(read_count.load() > 0);
+    CHECK_EQUAL(WRITES_PER_WRITER, binding.GetVersion());
+    CHECK_EQUAL(WRITES_PER_WRITER, binding.GetValue().counter);
+}
+
+TEST(SeqLockSerializesWriters)
+{
+    DataSourceSeqLock<Pattern> binding(Pattern::Make(0));
+    std::atomic<int> torn_reads{0};
+    std::atomic<int> notified{0};
+    binding.Subscribe([&notified](const Pattern& value) {
+        if (value.IsIntact()) {
+            ++notified;
+        }
+    });
+
+    // Writers race each other, readers must still only ever see whole values
+    constexpr int WRITER_COUNT = 3;
+    constexpr uint32_t WRITES = WRITES_PER_WRITER / 10;
+    std::atomic<int> writers_left{WRITER_COUNT};
+    std::vector<std::thread> threads;
+    for (int writer = 0; writer < WRITER_COUNT; writer++) {
+        threads.emplace_back([&, writer] {
+            for (uint32_t i = 0; i < WRITES; i++) {
+                binding.SetValue(Pattern::Make(writer * WRITES + i));
+            }
+            --writers_left;
+        });
+    }
+    threads.emplace_back([&] {
+        while (writers_left.load() > 0) {
+            if (!binding.GetValue().IsIntact()) {
+                ++torn_reads;
+            }
+        }
+    });
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK_EQUAL(0, torn_reads.load());
+    CHECK_EQUAL(static_cast<int>(WRITER_COUNT * WRITES), notified.load());
+    CHECK_EQUAL(WRITER_COUNT * WRITES, binding.GetVersion());
+    CHECK(binding.GetValue().IsIntact());
+}
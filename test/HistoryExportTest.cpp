@@ -0,0 +1,334 @@
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TestHarness.hpp"
+
+#include "AllocationCounter.hpp"
+#include "HistoryExport.hpp"
+#include "SampleCodec.hpp"
+#include "SampleLog.hpp"
+#include "TempImage.hpp"
+
+namespace {
+    constexpr size_t SECTOR_COUNT = 3;
+    constexpr size_t LARGE_SECTOR_COUNT = 4096; // A 16MB partition, about 2M records
+
+    // Five records from a previous boot and two from this one, log times 1 to 7 with an offset of 6
+    std::unique_ptr<SampleLog> OpenSmallLog(const TempImage& image)
+    {
+        {
+            SampleLog log(image.Open());
+            log.Open(0);
+            const int16_t sixteenths[] = {344, 345, -1, 1600, 0};
+            for (int i = 0; i < 5; i++) {
+                log.Append((i + 1) * 1000000LL, Temperature::FromSixteenths(sixteenths[i]));
+            }
+        }
+        auto log = std::make_unique<SampleLog>(image.Open());
+        log->Open(0);
+        log->Append(0, Temperature::FromSixteenths(318));
+        log->Append(1000000, Temperature::FromDegrees(20));
+        return log;
+    }
+
+    bool AppendToString(void* context, const char* data, size_t size)
+    {
+        static_cast<std::string*>(context)->append(data, size);
+        return true;
+    }
+
+    std::string Export(SampleLog& log, HistoryExport::Format_T format, int64_t first, int64_t last)
+    {
+        std::string out;
+        HistoryExport history_export(log, format, &AppendToString, &out);
+        CHECK(history_export.Write(first, last, log.GetTimeOffsetS()));
+        return out;
+    }
+
+    // Collects the output in a buffer sized up front, so the sink itself never allocates
+    struct BoundedSink {
+        std::vector<char> data;
+        size_t length = 0;
+        size_t chunk_count = 0;
+        size_t max_chunk_size = 0;
+
+        explicit BoundedSink(size_t capacity) : data(capacity) {}
+
+        static bool Append(void* context, const char* chunk, size_t size) {
+            auto* sink = static_cast<BoundedSink*>(context);
+            if (sink->length + size > sink->data.size()) {
+                return false;
+            }
+            memcpy(sink->data.data() + sink->length, chunk, size);
+            sink->length += size;
+            ++sink->chunk_count;
+            sink->max_chunk_size = size > sink->max_chunk_size ? size : sink->max_chunk_size;
+            return true;
+        }
+    };
+
+    uint64_t ReadLittleEndian(const char* data, size_t size)
+    {
+        uint64_t value = 0;
+        for (size_t i = 0; i < size; i++) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+        }
+        return value;
+    }
+
+    // Records of the large log: one a second with a 30 s gap every 97, so the blocks aren't all the same size
+    uint32_t GetRecordTime(size_t i)
+    {
+        return static_cast<uint32_t>(i + 1 + (i / 97) * 30);
+    }
+
+    Temperature GetRecordTemperature(size_t i)
+    {
+        return Temperature::FromSixteenths(static_cast<int16_t>(200 + (i * 37) % 200));
+    }
+
+    // Checks the export against GetRecordTime/GetRecordTemperature as it streams past, holding on to
+    // no more than one row or block, so a log of millions of records doesn't need its output in memory
+    struct VerifyingSink {
+        static constexpr size_t HEADER_SIZE = 16;
+        static constexpr size_t BLOCK_HEADER_SIZE = 4;
+
+        HistoryExport::Format_T format;
+        int64_t time_offset_s;
+        bool is_header_done = false;
+        bool is_valid = true;
+        size_t next_record = 0;
+        size_t max_chunk_size = 0;
+        char pending[BLOCK_HEADER_SIZE + SampleBlock::SIZE];
+        size_t pending_length = 0;
+
+        VerifyingSink(HistoryExport::Format_T format, int64_t time_offset_s) : format(format), time_offset_s(time_offset_s) {}
+
+        static bool Append(void* context, const char* chunk, size_t size) {
+            auto* sink = static_cast<VerifyingSink*>(context);
+            sink->max_chunk_size = size > sink->max_chunk_size ? size : sink->max_chunk_size;
+            for (size_t i = 0; i < size && sink->is_valid; i++) {
+                sink->Consume(chunk[i]);
+            }
+            return true;
+        }
+
+        void Consume(char c) {
+            if (pending_length == sizeof(pending)) {
+                is_valid = false;
+                return;
+            }
+            pending[pending_length++] = c;
+            if (format != HistoryExport::Format_T::BINARY) {
+                if (c == '\n') {
+                    CheckRow();
+                    pending_length = 0;
+                }
+            } else if (!is_header_done) {
+                if (pending_length == HEADER_SIZE) {
+                    is_valid = memcmp(pending, "YSLB\x01\0\0\0", 8) == 0 &&
+                               static_cast<int64_t>(ReadLittleEndian(pending + 8, 8)) == time_offset_s;
+                    is_header_done = true;
+                    pending_length = 0;
+                }
+            } else if (pending_length >= BLOCK_HEADER_SIZE &&
+                       pending_length == BLOCK_HEADER_SIZE + (ReadLittleEndian(pending + 2, 2) + 7) / 8) {
+                CheckBlock();
+                pending_length = 0;
+            }
+        }
+
+        void CheckRow() {
+            char expected[HistoryExport::MAX_ROW_SIZE];
+            int length;
+            if (format == HistoryExport::Format_T::CSV && !is_header_done) {
+                length = snprintf(expected, sizeof(expected), "seq,time,temperature\n");
+                is_header_done = true;
+            } else {
+                char temperature[Temperature::MAX_FORMATTED_SIZE];
+                const int temperature_length = static_cast<int>(GetRecordTemperature(next_record).Format(temperature, sizeof(temperature)));
+                const uint32_t log_time_s = GetRecordTime(next_record);
+                const long long time_s = static_cast<long long>(log_time_s) - time_offset_s;
+                length = format == HistoryExport::Format_T::CSV ?
+                    snprintf(expected, sizeof(expected), "%u,%lld,%.*s\n", log_time_s, time_s, temperature_length, temperature) :
+                    snprintf(expected, sizeof(expected), "{\"seq\":%u,\"time\":%lld,\"temperature\":%.*s}\n",
+                             log_time_s, time_s, temperature_length, temperature);
+                ++next_record;
+            }
+            is_valid = static_cast<size_t>(length) == pending_length && memcmp(expected, pending, pending_length) == 0;
+        }
+
+        void CheckBlock() {
+            SampleBlock block;
+            block.sample_count = static_cast<uint16_t>(ReadLittleEndian(pending, 2));
+            block.bit_count = static_cast<uint16_t>(ReadLittleEndian(pending + 2, 2));
+            block.data.fill(0);
+            memcpy(block.data.data(), pending + BLOCK_HEADER_SIZE, pending_length - BLOCK_HEADER_SIZE);
+
+            SampleDecoder decoder(block);
+            SampleDecoder::Sample sample;
+            size_t decoded_count = 0;
+            while (is_valid && decoder.Next(sample)) {
+                is_valid = sample.timestamp == GetRecordTime(next_record) &&
+                           sample.value == GetRecordTemperature(next_record).GetSixteenths();
+                ++next_record;
+                ++decoded_count;
+            }
+            is_valid = is_valid && decoded_count == block.sample_count;
+        }
+    };
+
+    // Decodes the blocks after the 16 byte header, false if they don't add up
+    bool DecodeBinary(const char* data, size_t size, std::vector<SampleDecoder::Sample>& samples)
+    {
+        size_t offset = 16;
+        while (offset < size) {
+            if (offset + 4 > size) {
+                return false;
+            }
+            SampleBlock block;
+            block.sample_count = static_cast<uint16_t>(ReadLittleEndian(data + offset, 2));
+            block.bit_count = static_cast<uint16_t>(ReadLittleEndian(data + offset + 2, 2));
+            const size_t byte_count = (block.bit_count + 7) / 8;
+            offset += 4;
+            if (byte_count > block.data.size() || offset + byte_count > size) {
+                return false;
+            }
+            block.data.fill(0);
+            memcpy(block.data.data(), data + offset, byte_count);
+            offset += byte_count;
+            if (!SampleDecoder::DecodeBlock(block, samples)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string ToHex(const std::string& data)
+    {
+        std::string hex;
+        char byte[3];
+        for (char c : data) {
+            snprintf(byte, sizeof(byte), "%02x", static_cast<uint8_t>(c));
+            hex += byte;
+        }
+        return hex;
+    }
+}
+
+TEST(CsvMatchesGolden)
+{
+    TempImage image("HistoryExportTest_Csv", SECTOR_COUNT);
+    auto log = OpenSmallLog(image);
+    CHECK_EQUAL(6, log->GetTimeOffsetS());
+
+    CHECK_EQUAL(std::string("seq,time,temperature\n"
+                            "1,-5,21.5\n"
+                            "2,-4,21.5625\n"
+                            "3,-3,-0.0625\n"
+                            "4,-2,100\n"
+                            "5,-1,0\n"
+                            "6,0,19.875\n"
+                            "7,1,20\n"),
+                Export(*log, HistoryExport::Format_T::CSV, 0, UINT32_MAX));
+
+    // Both ends are inclusive
+    CHECK_EQUAL(std::string("seq,time,temperature\n"
+                            "3,-3,-0.0625\n"
+                            "4,-2,100\n"),
+                Export(*log, HistoryExport::Format_T::CSV, 3, 4));
+    CHECK_EQUAL(std::string("seq,time,temperature\n"), Export(*log, HistoryExport::Format_T::CSV, 5, 4));
+    CHECK_EQUAL(std::string("seq,time,temperature\n"), Export(*log, HistoryExport::Format_T::CSV, 8, UINT32_MAX));
+}
+
+TEST(NdjsonMatchesGolden)
+{
+    TempImage image("HistoryExportTest_Ndjson", SECTOR_COUNT);
+    auto log = OpenSmallLog(image);
+
+    CHECK_EQUAL(std::string("{\"seq\":5,\"time\":-1,\"temperature\":0}\n"
+                            "{\"seq\":6,\"time\":0,\"temperature\":19.875}\n"
+                            "{\"seq\":7,\"time\":1,\"temperature\":20}\n"),
+                Export(*log, HistoryExport::Format_T::NDJSON, 5, UINT32_MAX));
+    CHECK(Export(*log, HistoryExport::Format_T::NDJSON, 5, 4).empty());
+}
+
+TEST(BinaryMatchesGolden)
+{
+    TempImage image("HistoryExportTest_Binary", SECTOR_COUNT);
+    auto log = OpenSmallLog(image);
+
+    // Every multi-byte field is little endian: the offset of 6, then one block of 7 samples in 186 bits
+    const std::string binary = Export(*log, HistoryExport::Format_T::BINARY, 0, UINT32_MAX);
+    CHECK_EQUAL(std::string("59534c4201000000" "0600000000000000"
+                            "0700ba00" "000000000000000101588144e02b3706413831fdc04f8900"),
+                ToHex(binary));
+
+    std::vector<SampleDecoder::Sample> samples;
+    CHECK(DecodeBinary(binary.data(), binary.size(), samples));
+    const int16_t expected[] = {344, 345, -1, 1600, 0, 318, 320};
+    CHECK_EQUAL(7u, samples.size());
+    for (size_t i = 0; i < samples.size() && i < 7; i++) {
+        CHECK_EQUAL(static_cast<int64_t>(i + 1), samples[i].timestamp);
+        CHECK_EQUAL(expected[i], samples[i].value);
+    }
+
+    // An empty range is just the header
+    CHECK_EQUAL(std::string("59534c4201000000" "0600000000000000"),
+                ToHex(Export(*log, HistoryExport::Format_T::BINARY, 8, UINT32_MAX)));
+}
+
+TEST(FullLogExportsInBoundedMemory)
+{
+    TempImage image("HistoryExportTest_Full", LARGE_SECTOR_COUNT);
+    SampleLog log(image.Open());
+    CHECK(log.Open(0));
+    const size_t record_count = LARGE_SECTOR_COUNT * SampleLog::RECORDS_PER_SECTOR;
+    for (size_t i = 0; i < record_count; i++) {
+        CHECK(log.Append(GetRecordTime(i) * 1000000LL, GetRecordTemperature(i)));
+    }
+
+    const HistoryExport::Format_T formats[] = {HistoryExport::Format_T::CSV, HistoryExport::Format_T::NDJSON,
+                                               HistoryExport::Format_T::BINARY};
+    for (const auto format : formats) {
+        VerifyingSink sink(format, log.GetTimeOffsetS());
+        const size_t allocations_before = AllocationCounter::GetCount();
+        HistoryExport history_export(log, format, &VerifyingSink::Append, &sink);
+        CHECK(history_export.Write(0, UINT32_MAX, log.GetTimeOffsetS()));
+        // Nothing grows with the log: no heap, and no chunk bigger than the one buffer
+        CHECK_EQUAL(0u, AllocationCounter::GetCount() - allocations_before);
+        CHECK(sink.max_chunk_size <= HistoryExport::CHUNK_SIZE);
+        CHECK(sink.is_valid);
+        CHECK_EQUAL(record_count, sink.next_record);
+        CHECK_EQUAL(0u, sink.pending_length);
+    }
+}
+
+TEST(FailingSinkStopsTheExport)
+{
+    TempImage image("HistoryExportTest_Failing", SECTOR_COUNT);
+    SampleLog log(image.Open());
+    CHECK(log.Open(0));
+    for (int i = 1; i <= 200; i++) {
+        log.Append(i * 1000000LL, Temperature::FromDegrees(20));
+    }
+
+    BoundedSink sink(HistoryExport::CHUNK_SIZE);
+    HistoryExport history_export(log, HistoryExport::Format_T::NDJSON, &BoundedSink::Append, &sink);
+    CHECK(!history_export.Write(0, UINT32_MAX, log.GetTimeOffsetS()));
+    CHECK_EQUAL(1u, sink.chunk_count);
+}
+
+TEST(FormatNames)
+{
+    HistoryExport::Format_T format;
+    CHECK(HistoryExport::ParseFormat("csv", format) && format == HistoryExport::Format_T::CSV);
+    CHECK(HistoryExport::ParseFormat("ndjson", format) && format == HistoryExport::Format_T::NDJSON);
+    CHECK(HistoryExport::ParseFormat("binary", format) && format == HistoryExport::Format_T::BINARY);
+    CHECK(!HistoryExport::ParseFormat("CSV", format));
+    CHECK(!HistoryExport::ParseFormat("", format));
+    CHECK_EQUAL(std::string("text/csv"), HistoryExport::GetContentType(HistoryExport::Format_T::CSV));
+}
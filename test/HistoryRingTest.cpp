@@ -0,0 +1,100 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "TestHarness.hpp"
+
+#include "HistoryRing.hpp"
+
+namespace {
+    // Every field is derived from the index, so a torn copy breaks the pattern
+    struct Entry {
+        uint32_t index;
+        uint32_t words[3];
+        uint8_t tail[2]; // Not a whole number of words
+
+        static Entry Make(uint32_t index) {
+            Entry entry = {};
+            entry.index = index;
+            for (uint32_t i = 0; i < 3; i++) {
+                entry.words[i] = index * (i + 5) ^ 0x5A5A5A5A;
+            }
+            entry.tail[0] = static_cast<uint8_t>(index);
+            entry.tail[1] = static_cast<uint8_t>(index >> 8);
+            return entry;
+        }
+
+        [[nodiscard]] bool IsIntact() const {
+            const Entry expected = Make(index);
+            return words[0] == expected.words[0] && words[1] == expected.words[1] && words[2] == expected.words[2] &&
+                   tail[0] == expected.tail[0] && tail[1] == expected.tail[1];
+        }
+    };
+
+    constexpr size_t CAPACITY = 32;
+    constexpr uint32_t PUSH_COUNT = 200000;
+    constexpr int READER_COUNT = 4;
+}
+
+TEST(SnapshotKeepsTheNewestEntries)
+{
+    HistoryRing<Entry, CAPACITY> ring;
+    std::vector<Entry> out;
+    CHECK_EQUAL(0u, ring.Snapshot(out));
+    CHECK(out.empty());
+
+    for (uint32_t i = 0; i < CAPACITY + 5; i++) {
+        ring.Push(Entry::Make(i));
+    }
+    CHECK_EQUAL(static_cast<uint32_t>(CAPACITY + 5), ring.GetCount());
+    // The oldest slot is the one the next Push overwrites, so a full ring gives one entry less
+    CHECK_EQUAL(6u, ring.Snapshot(out));
+    CHECK_EQUAL(CAPACITY - 1, out.size());
+    CHECK_EQUAL(6u, out.front().index);
+    CHECK_EQUAL(static_cast<uint32_t>(CAPACITY + 4), out.back().index);
+
+    CHECK_EQUAL(static_cast<uint32_t>(CAPACITY + 2), ring.Snapshot(out, 3));
+    CHECK_EQUAL(3u, out.size());
+    CHECK(out[0].IsIntact() && out[1].IsIntact() && out[2].IsIntact());
+}
+
+TEST(ReadersNeverSeeTornEntries)
+{
+    HistoryRing<Entry, CAPACITY> ring;
+    std::atomic<bool> is_writing{true};
+    std::atomic<int> bad_snapshots{0};
+    std::atomic<uint64_t> entry_count{0};
+
+    // Whatever survives a snapshot is intact and numbered from the first entry it returns
+    std::vector<std::thread> readers;
+    for (int i = 0; i < READER_COUNT; i++) {
+        readers.emplace_back([&] {
+            std::vector<Entry> out;
+            uint64_t entries = 0;
+            while (is_writing.load(std::memory_order_relaxed)) {
+                const uint32_t first = ring.Snapshot(out);
+                for (size_t j = 0; j < out.size(); j++) {
+                    if (!out[j].IsIntact() || out[j].index != first + j) {
+                        ++bad_snapshots;
+                        break;
+                    }
+                }
+                entries += out.size();
+            }
+            entry_count += entries;
+        });
+    }
+
+    for (uint32_t i = 0; i < PUSH_COUNT; i++) {
+        ring.Push(Entry::Make(i));
+    }
+    is_writing = false;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    CHECK_EQUAL(0, bad_snapshots.load());
+    CHECK(entry_count.load() > 0);
+    CHECK_EQUAL(PUSH_COUNT, ring.GetCount());
+}
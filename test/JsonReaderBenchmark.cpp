@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Benchmark.hpp"
+
+#include "JsonReader.hpp"
+
+namespace {
+    constexpr size_t JSON_BODY_BUFFER_SIZE = 128; // As WebUI::ReceiveJsonObject
+    constexpr size_t REPEAT_COUNT = 20000;
+
+    // WebUI::ParseJsonKeyValuePairs as it was before JsonReader, kept as the baseline with its
+    // logging dropped. Flat objects only: every value is copied out and stripped of spaces and quotes
+    // one erase at a time.
+    std::vector<std::pair<std::string, std::string>> ParseJsonKeyValuePairs(const std::string& json)
+    {
+        if (json.empty() || json[0] != '{') {
+            return {};
+        }
+
+        const auto remove_whitespace_quotes = [](std::string& in_str) -> std::string& {
+            auto next_it = in_str.begin();
+            while (next_it != in_str.end()) {
+                auto next_space_it = std::find_if(next_it, in_str.end(), [](char c) {
+                    return std::isspace(c) || c == '"';
+                });
+                if (next_space_it != in_str.end()) {
+                    next_space_it = in_str.erase(next_space_it);
+                }
+                next_it = next_space_it;
+            }
+            return in_str;
+        };
+
+        std::vector<std::pair<std::string, std::string>> ret_kv_pairs;
+        auto index = 1;
+        bool is_key_not_value = true;
+
+        std::pair<std::string, std::string> current_kv;
+        while (true) {
+            auto next_index = json.find_first_of(":,}", index);
+            if (next_index == std::string::npos) {
+                break;
+            }
+
+            auto str = json.substr(index, next_index - index);
+            if (is_key_not_value) {
+                current_kv.first = std::move(remove_whitespace_quotes(str));
+                is_key_not_value = false;
+            } else {
+                current_kv.second = std::move(remove_whitespace_quotes(str));
+                ret_kv_pairs.push_back(std::move(current_kv));
+                current_kv = std::make_pair("", "");
+                is_key_not_value = true;
+            }
+            index = next_index + 1;
+        }
+        return ret_kv_pairs;
+    }
+
+    // Stands in for httpd_req_recv, handing out as much of the body as fits
+    struct BodySource {
+        const std::string* body;
+        size_t offset;
+
+        static int Receive(void* context, char* buffer, size_t size) {
+            auto* source = static_cast<BodySource*>(context);
+            const size_t count = std::min(size, source->body->size() - source->offset);
+            memcpy(buffer, source->body->data() + source->offset, count);
+            source->offset += count;
+            return static_cast<int>(count);
+        }
+    };
+
+    // Keys in the body, -1 if it doesn't parse
+    int CountKeys(const std::string& body)
+    {
+        BodySource source = {&body, 0};
+        char buffer[JSON_BODY_BUFFER_SIZE];
+        JsonReader reader(buffer, sizeof(buffer), &BodySource::Receive, &source);
+        int key_count = 0;
+        while (true) {
+            const auto token = reader.Next();
+            if (token == JsonReader::Token_T::END) {
+                return key_count;
+            }
+            if (token == JsonReader::Token_T::ERROR) {
+                return -1;
+            }
+            key_count += token == JsonReader::Token_T::KEY ? 1 : 0;
+        }
+    }
+
+    // Pretty printed settings, flat so the old parser can take it too
+    std::string MakeLargeBody()
+    {
+        std::string body = "{\n";
+        for (int i = 0; body.size() < 2000; i++) {
+            body += "  \"setting_" + std::to_string(i) + "\": \"" + std::to_string(i * 37 % 1000) + ".25\",\n";
+        }
+        body += "  \"last\": 1\n}";
+        return body;
+    }
+}
+
+int main()
+{
+    const std::string bodies[] = {
+        R"({"low": "4.5", "high": "30.5"})",
+        R"({"kind": "above", "sensor": "28ff641e0316a1", "level": "30.5", "hysteresis": "0.5", "hold": 600, "alarm": "high"})",
+        MakeLargeBody(),
+    };
+
+    printf("%6s %5s %18s %22s\n", "bytes", "keys", "old ns (MB/s)", "JsonReader ns (MB/s)");
+    for (const auto& body : bodies) {
+        size_t old_count = 0;
+        int new_count = 0;
+        const auto old_parser = Benchmark::Measure(REPEAT_COUNT, [&]() {
+            old_count = ParseJsonKeyValuePairs(std::string(body.data(), body.size())).size();
+        });
+        const auto reader = Benchmark::Measure(REPEAT_COUNT, [&]() { new_count = CountKeys(body); });
+        if (new_count < 0 || static_cast<size_t>(new_count) != old_count) {
+            printf("The parsers disagree on a %zu byte body: %zu and %d keys\n", body.size(), old_count, new_count);
+            return 1;
+        }
+        printf("%6zu %5d %10.0f (%5.1f) %14.0f (%5.1f)\n", body.size(), new_count,
+               old_parser.ns, body.size() * 1000. / old_parser.ns, reader.ns, body.size() * 1000. / reader.ns);
+    }
+    return 0;
+}
@@ -0,0 +1,383 @@
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TestHarness.hpp"
+
+#include "JsonReader.hpp"
+
+namespace {
+    using Token_T = JsonReader::Token_T;
+    using Tokens = std::vector<std::pair<Token_T, std::string>>;
+
+    // Stands in for httpd_req_recv, hands the input out chunk_size bytes at a time
+    struct ChunkSource {
+        std::string text;
+        size_t chunk_size;
+        size_t offset = 0;
+
+        static int Read(void* context, char* buffer, size_t size) {
+            auto* source = static_cast<ChunkSource*>(context);
+            size_t count = source->text.size() - source->offset;
+            count = count < source->chunk_size ? count : source->chunk_size;
+            count = count < size ? count : size;
+            memcpy(buffer, source->text.data() + source->offset, count);
+            source->offset += count;
+            return static_cast<int>(count);
+        }
+    };
+
+    // Every token up to and including END or ERROR. Each token consumes input, so the count is bounded.
+    Tokens ReadAll(JsonReader& reader, size_t input_length)
+    {
+        Tokens tokens;
+        while (tokens.size() <= input_length + 1) {
+            const Token_T token = reader.Next();
+            tokens.emplace_back(token, std::string(reader.GetText()));
+            if (token == Token_T::END || token == Token_T::ERROR) {
+                break;
+            }
+        }
+        return tokens;
+    }
+
+    Tokens Parse(const std::string& text)
+    {
+        std::string copy = text;
+        JsonReader reader(copy.data(), copy.size());
+        return ReadAll(reader, text.size());
+    }
+
+    Tokens ParseChunked(const std::string& text, size_t buffer_size, size_t chunk_size)
+    {
+        ChunkSource source = {text, chunk_size};
+        std::vector<char> buffer(buffer_size);
+        JsonReader reader(buffer.data(), buffer.size(), &ChunkSource::Read, &source);
+        return ReadAll(reader, text.size());
+    }
+
+    Token_T GetLast(const Tokens& tokens)
+    {
+        return tokens.empty() ? Token_T::ERROR : tokens.back().first;
+    }
+
+    bool IsValid(const std::string& text)
+    {
+        return GetLast(Parse(text)) == Token_T::END;
+    }
+
+    // The text of the single string value in text
+    std::string ParseString(const std::string& text)
+    {
+        const Tokens tokens = Parse(text);
+        if (tokens.size() != 2 || tokens[0].first != Token_T::STRING || tokens[1].first != Token_T::END) {
+            return "<error>";
+        }
+        return tokens[0].second;
+    }
+
+    // Random well formed documents, strings drawn from characters that need escaping too
+    class DocumentGenerator {
+        std::mt19937 _random;
+
+        int Pick(int count) { return std::uniform_int_distribution<int>(0, count - 1)(_random); }
+
+        void AppendWhitespace(std::string& out) {
+            static const char WHITESPACE[] = " \t\r\n";
+            while (Pick(4) == 0) {
+                out += WHITESPACE[Pick(4)];
+            }
+        }
+
+        void AppendString(std::string& out) {
+            static const char* const PIECES[] = {"a", "Z", "7", " ", "\\\"", "\\\\", "\\/", "\\n", "\\t", "\\b",
+                                                 "\\u0041", "\\u00e9", "\\u20AC", "\\ud83d\\ude00", "\\uD800", "\xC3\xA9"};
+            out += '"';
+            for (int count = Pick(8); count > 0; count--) {
+                out += PIECES[Pick(sizeof(PIECES) / sizeof(PIECES[0]))];
+            }
+            out += '"';
+        }
+
+        void AppendNumber(std::string& out) {
+            static const char* const NUMBERS[] = {"0", "-0", "7", "-12", "3.25", "1e3", "-2.5E-4", "6.02e+23", "9223372036854775807"};
+            out += NUMBERS[Pick(sizeof(NUMBERS) / sizeof(NUMBERS[0]))];
+        }
+
+    public:
+        explicit DocumentGenerator(uint32_t seed) : _random(seed) {}
+
+        void AppendValue(std::string& out, int depth) {
+            AppendWhitespace(out);
+            switch (Pick(depth < 4 ? 8 : 6)) {
+                case 0: AppendString(out); break;
+                case 1: AppendNumber(out); break;
+                case 2: out += "true"; break;
+                case 3: out += "false"; break;
+                case 4: out += "null"; break;
+                case 5: AppendNumber(out); break;
+                case 6: {
+                    out += '[';
+                    for (int i = 0, count = Pick(4); i < count; i++) {
+                        if (i > 0) {
+                            out += ',';
+                        }
+                        AppendValue(out, depth + 1);
+                    }
+                    AppendWhitespace(out);
+                    out += ']';
+                    break;
+                }
+                default: {
+                    out += '{';
+                    for (int i = 0, count = Pick(4); i < count; i++) {
+                        if (i > 0) {
+                            out += ',';
+                        }
+                        AppendWhitespace(out);
+                        AppendString(out);
+                        AppendWhitespace(out);
+                        out += ':';
+                        AppendValue(out, depth + 1);
+                    }
+                    AppendWhitespace(out);
+                    out += '}';
+                    break;
+                }
+            }
+            AppendWhitespace(out);
+        }
+
+        // Flips, drops or inserts a few bytes
+        std::string Mutate(std::string text) {
+            static const char INTERESTING[] = "{}[]:,\"\\-.eE0u \x01\xFF";
+            for (int count = 1 + Pick(3); count > 0; count--) {
+                const size_t at = text.empty() ? 0 : static_cast<size_t>(Pick(static_cast<int>(text.size())));
+                switch (Pick(3)) {
+                    case 0:
+                        if (!text.empty()) {
+                            text[at] = INTERESTING[Pick(sizeof(INTERESTING) - 1)];
+                        }
+                        break;
+                    case 1:
+                        if (!text.empty()) {
+                            text.erase(at, 1);
+                        }
+                        break;
+                    default:
+                        text.insert(text.begin() + at, INTERESTING[Pick(sizeof(INTERESTING) - 1)]);
+                        break;
+                }
+            }
+            return text;
+        }
+
+        std::string RandomBytes() {
+            std::string text(Pick(40), '\0');
+            for (char& c : text) {
+                c = static_cast<char>(Pick(256));
+            }
+            return text;
+        }
+
+        size_t PickChunkSize() { return 1 + Pick(8); }
+    };
+
+    constexpr uint32_t FUZZ_SEED = 0x5EED;
+    constexpr int FUZZ_ITERATIONS = 3000;
+    // Larger than any token the generator makes, so chunking can't change the outcome
+    constexpr size_t FUZZ_BUFFER_SIZE = 256;
+}
+
+TEST(ReadsNestedDocument)
+{
+    const Tokens tokens = Parse(R"( {"rules": [{"id": 3, "level": "-2.5"}, true, null], "empty": {}, "none": []} )");
+    const Tokens expected = {
+        {Token_T::BEGIN_OBJECT, ""}, {Token_T::KEY, "rules"}, {Token_T::BEGIN_ARRAY, ""},
+        {Token_T::BEGIN_OBJECT, ""}, {Token_T::KEY, "id"}, {Token_T::NUMBER, "3"},
+        {Token_T::KEY, "level"}, {Token_T::STRING, "-2.5"}, {Token_T::END_OBJECT, ""},
+        {Token_T::TRUE, ""}, {Token_T::NULL_VALUE, ""}, {Token_T::END_ARRAY, ""},
+        {Token_T::KEY, "empty"}, {Token_T::BEGIN_OBJECT, ""}, {Token_T::END_OBJECT, ""},
+        {Token_T::KEY, "none"}, {Token_T::BEGIN_ARRAY, ""}, {Token_T::END_ARRAY, ""},
+        {Token_T::END_OBJECT, ""}, {Token_T::END, ""}};
+    CHECK(tokens == expected);
+}
+
+TEST(EscapesAreUnescaped)
+{
+    CHECK_EQUAL(std::string("\"\\/\b\f\n\r\t"), ParseString(R"("\"\\\/\b\f\n\r\t")"));
+    CHECK_EQUAL(std::string("A\xC3\xA9\xE2\x82\xAC"), ParseString(R"("\u0041\u00e9\u20AC")"));
+    CHECK_EQUAL(std::string("a\0b", 3), ParseString(R"("a\u0000b")"));
+    // Surrogate pairs become one 4 byte character, in either case
+    CHECK_EQUAL(std::string("\xF0\x9F\x98\x80"), ParseString(R"("\ud83d\ude00")"));
+    CHECK_EQUAL(std::string("\xF0\x9F\x98\x80"), ParseString(R"("\uD83D\uDE00")"));
+    // Lone surrogates are kept as they are, and so is whatever follows them
+    CHECK_EQUAL(std::string("\xED\xA0\xBD"), ParseString(R"("\ud83d")"));
+    CHECK_EQUAL(std::string("\xED\xA0\xBD" "A"), ParseString(R"("\ud83d\u0041")"));
+    CHECK_EQUAL(std::string("\xED\xB8\x80"), ParseString(R"("\ude00")"));
+    // Anything that isn't ASCII passes through untouched
+    CHECK_EQUAL(std::string("\xC3\xA9"), ParseString("\"\xC3\xA9\""));
+
+    CHECK(!IsValid(R"("\x")"));
+    CHECK(!IsValid(R"("\u12G4")"));
+    CHECK(!IsValid(R"("\u12")"));
+    CHECK(!IsValid(R"("\ud83d\u12")"));
+    CHECK(!IsValid("\"tab\there\""));
+    CHECK(!IsValid(R"("unterminated)"));
+    CHECK(!IsValid(R"("escape at the end\)"));
+}
+
+TEST(KeysAreUnescaped)
+{
+    const Tokens tokens = Parse(R"({"k\u00e9y" : 1})");
+    CHECK(tokens.size() == 5);
+    CHECK(tokens[1] == std::make_pair(Token_T::KEY, std::string("k\xC3\xA9y")));
+}
+
+TEST(NestingIsLimited)
+{
+    const std::string deepest = std::string(JsonReader::MAX_DEPTH, '[') + std::string(JsonReader::MAX_DEPTH, ']');
+    CHECK(IsValid(deepest));
+
+    const std::string too_deep = std::string(JsonReader::MAX_DEPTH + 1, '[') + std::string(JsonReader::MAX_DEPTH + 1, ']');
+    const Tokens tokens = Parse(too_deep);
+    CHECK_EQUAL(static_cast<size_t>(JsonReader::MAX_DEPTH + 1), tokens.size());
+    CHECK(GetLast(tokens) == Token_T::ERROR);
+
+    // Objects count the same
+    std::string objects;
+    for (int i = 0; i <= JsonReader::MAX_DEPTH; i++) {
+        objects += R"({"a":)";
+    }
+    objects += "1" + std::string(JsonReader::MAX_DEPTH + 1, '}');
+    CHECK(!IsValid(objects));
+
+    // Skipping a deep value leaves the reader after it
+    std::string text = R"({"skip":)" + deepest.substr(1, deepest.size() - 2) + R"(,"next":true})";
+    JsonReader reader(text.data(), text.size());
+    CHECK(reader.Next() == Token_T::BEGIN_OBJECT);
+    CHECK(reader.Next() == Token_T::KEY);
+    CHECK(reader.Skip(reader.Next()));
+    CHECK(reader.Next() == Token_T::KEY);
+    CHECK(reader.GetText() == "next");
+    CHECK(reader.Next() == Token_T::TRUE);
+    CHECK(reader.Next() == Token_T::END_OBJECT);
+    CHECK(reader.Next() == Token_T::END);
+}
+
+TEST(NumberGrammarIsStrict)
+{
+    for (const char* number : {"0", "-0", "7", "-12", "3.25", "0.5", "1e3", "1E+3", "-2.5e-4", "10"}) {
+        const Tokens tokens = Parse(number);
+        CHECK(tokens.size() == 2 && tokens[0] == std::make_pair(Token_T::NUMBER, std::string(number)));
+    }
+    for (const char* number : {"01", "-01", "1.", ".5", "-", "+1", "1e", "1e+", "1.e3", "--1", "0x10", "1.5.2", "Infinity", "NaN"}) {
+        CHECK(!IsValid(number));
+    }
+
+    int64_t value = 0;
+    CHECK(JsonReader::ParseInteger("9223372036854775807", value));
+    CHECK_EQUAL(INT64_MAX, value);
+    CHECK(JsonReader::ParseInteger("-42", value));
+    CHECK_EQUAL(-42, value);
+    CHECK(!JsonReader::ParseInteger("9223372036854775808", value));
+    CHECK(!JsonReader::ParseInteger("1.5", value));
+    CHECK(!JsonReader::ParseInteger("-", value));
+    CHECK(!JsonReader::ParseInteger("", value));
+}
+
+TEST(MalformedDocumentsFail)
+{
+    for (const char* text : {"", "   ", "{} x", "[1,]", "[,1]", "[1 2]", "1 2", R"({"a"})", R"({"a":1,})", R"({"a" 1})",
+                             "{1:2}", "{'a':1}", "[1}", "{]", "]", "tru", "nul", "True", "[", R"({"a":)"}) {
+        CHECK(!IsValid(text));
+    }
+}
+
+TEST(ErrorsAreSticky)
+{
+    std::string text = R"([1, x, 2])";
+    JsonReader reader(text.data(), text.size());
+    CHECK(reader.Next() == Token_T::BEGIN_ARRAY);
+    CHECK(reader.Next() == Token_T::NUMBER);
+    CHECK(reader.Next() == Token_T::ERROR);
+    CHECK(reader.GetText().empty());
+    CHECK(reader.Next() == Token_T::ERROR);
+    CHECK(reader.Next() == Token_T::ERROR);
+}
+
+TEST(ChunkedInputMatchesInMemory)
+{
+    const std::string text = R"({"name": "probe \u00e9\ud83d\ude00", "values": [-1.5e2, 0, 12345678], "on": false})";
+    const Tokens expected = Parse(text);
+    CHECK(GetLast(expected) == Token_T::END);
+    for (size_t chunk_size = 1; chunk_size <= 9; chunk_size++) {
+        CHECK(ParseChunked(text, 40, chunk_size) == expected);
+    }
+
+    // The input source failing ends the document early
+    const Tokens cut = ParseChunked(text.substr(0, 30), 40, 3);
+    CHECK(GetLast(cut) == Token_T::ERROR);
+}
+
+TEST(TokensMustFitTheBuffer)
+{
+    constexpr size_t BUFFER_SIZE = 16;
+    // Quotes included, the buffer holds the whole token
+    const std::string fits = "[\"" + std::string(BUFFER_SIZE - 2, 'x') + "\"]";
+    CHECK(GetLast(ParseChunked(fits, BUFFER_SIZE, 1)) == Token_T::END);
+    CHECK(GetLast(ParseChunked(fits, BUFFER_SIZE, BUFFER_SIZE)) == Token_T::END);
+
+    const std::string too_long = "[\"" + std::string(BUFFER_SIZE - 1, 'x') + "\"]";
+    CHECK(GetLast(ParseChunked(too_long, BUFFER_SIZE, 1)) == Token_T::ERROR);
+    CHECK(GetLast(ParseChunked(too_long, BUFFER_SIZE, BUFFER_SIZE)) == Token_T::ERROR);
+
+    const std::string long_number = "[" + std::string(BUFFER_SIZE + 1, '1') + "]";
+    CHECK(GetLast(ParseChunked(long_number, BUFFER_SIZE, 5)) == Token_T::ERROR);
+
+    // A long document of short tokens is fine
+    std::string many = "[";
+    for (int i = 0; i < 200; i++) {
+        many += (i > 0 ? ", " : "") + std::to_string(i);
+    }
+    many += "]";
+    CHECK(GetLast(ParseChunked(many, BUFFER_SIZE, 7)) == Token_T::END);
+}
+
+TEST(FuzzValidDocuments)
+{
+    DocumentGenerator generator(FUZZ_SEED);
+    for (int i = 0; i < FUZZ_ITERATIONS; i++) {
+        std::string text;
+        generator.AppendValue(text, 0);
+        const Tokens tokens = Parse(text);
+        if (GetLast(tokens) != Token_T::END) {
+            printf("Rejected valid document: %s\n", text.c_str());
+        }
+        CHECK(GetLast(tokens) == Token_T::END);
+        CHECK(ParseChunked(text, FUZZ_BUFFER_SIZE, generator.PickChunkSize()) == tokens);
+    }
+}
+
+TEST(FuzzMutatedDocuments)
+{
+    // Broken input must end in END or ERROR without running off the buffer, the same whether it
+    // comes in at once or in chunks. Best run under -fsanitize=address.
+    DocumentGenerator generator(FUZZ_SEED + 1);
+    int error_count = 0;
+    for (int i = 0; i < FUZZ_ITERATIONS; i++) {
+        std::string text;
+        generator.AppendValue(text, 0);
+        text = i % 4 == 0 ? generator.RandomBytes() : generator.Mutate(text);
+
+        const Tokens tokens = Parse(text);
+        const Token_T last = GetLast(tokens);
+        CHECK(last == Token_T::END || last == Token_T::ERROR);
+        CHECK(ParseChunked(text, FUZZ_BUFFER_SIZE, generator.PickChunkSize()) == tokens);
+        error_count += last == Token_T::ERROR ? 1 : 0;
+    }
+    // Most mutations break the document, make sure they are actually being caught
+    CHECK(error_count > FUZZ_ITERATIONS / 2);
+}
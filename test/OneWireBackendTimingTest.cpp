@@ -0,0 +1,282 @@
+#include "TestHarness.hpp"
+#include "FakeIdf.hpp"
+
+#include "OneWireBitBangBackend.hpp"
+#include "OneWirePin.hpp"
+#include "OneWireRmtBackend.hpp"
+#include "OneWireTiming.hpp"
+#include "OneWireUartBackend.hpp"
+
+using namespace OneWireTiming;
+
+// Every backend has to put the same slots on the bus. Each one's output is turned into low times,
+// sample points and slot lengths in nanoseconds and checked against the same OneWireTiming windows:
+// the RMT items at the clock the channels were configured with, the UART frames at their baud
+// rate and the bit-banged line on the clock its delays move.
+namespace {
+    constexpr uint64_t APB_CLK_HZ = 80000000;
+
+    struct Captured {
+        uint64_t tick_ns = 0;
+        uint16_t rx_idle_ticks = 0;
+        std::vector<FakeIdf::RmtWrite> writes;
+    };
+
+    template <typename Operation>
+    Captured Capture(Operation operation)
+    {
+        FakeIdf::ClearRmt();
+        OneWireRmtBackend backend(GPIO_NUM_12);
+        CHECK(backend.IsValid());
+
+        Captured captured;
+        const auto& configs = FakeIdf::GetRmtConfigs();
+        CHECK_EQUAL(2u, configs.size());
+        if (configs.size() != 2) {
+            return captured;
+        }
+        CHECK_EQUAL(RMT_MODE_TX, configs[0].rmt_mode);
+        CHECK_EQUAL(RMT_MODE_RX, configs[1].rmt_mode);
+        CHECK_EQUAL(configs[0].clk_div, configs[1].clk_div);
+        captured.tick_ns = 1000000000ULL * configs[0].clk_div / APB_CLK_HZ;
+        captured.rx_idle_ticks = configs[1].rx_config.idle_threshold;
+
+        operation(backend);
+        captured.writes = FakeIdf::GetRmtWrites();
+        return captured;
+    }
+
+    uint64_t GetLowNs(const rmt_item32_t& item, uint64_t tick_ns)
+    {
+        return item.duration0 * tick_ns;
+    }
+
+    uint64_t GetSlotNs(const rmt_item32_t& item, uint64_t tick_ns)
+    {
+        return (item.duration0 + item.duration1) * tick_ns;
+    }
+
+    bool IsLowThenHigh(const rmt_item32_t& item)
+    {
+        return item.level0 == 0 && item.level1 == 1 && item.duration0 > 0 && item.duration1 > 0;
+    }
+
+    // A UART frame is a low start bit, 8 data bits LSB first and a high stop bit. Sent on the
+    // open drain line the slot stays low through the start bit and every leading 0 data bit.
+    constexpr size_t UART_FRAME_BITS = 10;
+
+    uint64_t GetUartBitNs(uint32_t baud_rate)
+    {
+        return 1000000000ULL / baud_rate;
+    }
+
+    uint64_t GetUartLowNs(uint8_t frame, uint32_t baud_rate)
+    {
+        size_t low_bits = 1;
+        while (low_bits < 9 && !(frame & (1 << (low_bits - 1)))) {
+            ++low_bits;
+        }
+        return low_bits * GetUartBitNs(baud_rate);
+    }
+
+    // What a bit-banged slot did with the line, from BeginSlot to EndSlot
+    struct PinSlot {
+        uint64_t low_ns = 0;
+        uint64_t first_read_ns = 0; // From the start of the slot, 0 if the line wasn't read
+        uint64_t length_ns = 0;
+    };
+
+    // Takes the place of the GPIO: time only moves in DelayUs, and the line reads high unless held
+    class RecordingPin : public OneWirePin {
+        uint64_t _now_ns = 0;
+        uint64_t _slot_start_ns = 0;
+        uint64_t _held_at_ns = 0;
+        bool _is_held = false;
+        PinSlot _slot;
+        std::vector<PinSlot> _slots;
+    public:
+        void Hold() override {
+            if (!_is_held) {
+                _is_held = true;
+                _held_at_ns = _now_ns;
+            }
+        }
+        void Release() override {
+            if (_is_held) {
+                _is_held = false;
+                _slot.low_ns += _now_ns - _held_at_ns;
+            }
+        }
+        [[nodiscard]] bool Read() override {
+            if (_slot.first_read_ns == 0) {
+                _slot.first_read_ns = _now_ns - _slot_start_ns;
+            }
+            return !_is_held;
+        }
+        void DelayUs(uint32_t us) override { _now_ns += us * 1000ULL; }
+
+        void BeginSlot() override {
+            _slot = PinSlot();
+            _slot_start_ns = _now_ns;
+        }
+        void EndSlot() override {
+            _slot.length_ns = _now_ns - _slot_start_ns;
+            _slots.push_back(_slot);
+        }
+
+        [[nodiscard]] const std::vector<PinSlot>& GetSlots() const { return _slots; }
+    };
+}
+
+TEST(RmtResetPulse)
+{
+    const auto captured = Capture([](OneWireRmtBackend& backend) { backend.Reset(); });
+    CHECK_EQUAL(1u, captured.writes.size());
+    if (captured.writes.size() != 1) {
+        return;
+    }
+    CHECK_EQUAL(1u, captured.writes[0].items.size());
+    const auto& item = captured.writes[0].items[0];
+    CHECK(IsLowThenHigh(item));
+    CHECK(IsValidReset(GetLowNs(item, captured.tick_ns)));
+    // Released long enough for the whole presence window
+    CHECK(item.duration1 * captured.tick_ns >= RESET_LOW_MIN_US * 1000ULL);
+}
+
+TEST(RmtWriteSlots)
+{
+    const auto captured = Capture([](OneWireRmtBackend& backend) {
+        backend.WriteByte(0xA5);
+        backend.WriteBit(false);
+        backend.WriteBit(true);
+    });
+    CHECK_EQUAL(3u, captured.writes.size());
+    if (captured.writes.size() != 3) {
+        return;
+    }
+
+    // LSB first: 0xA5 is 1, 0, 1, 0, 0, 1, 0, 1
+    const auto& byte_items = captured.writes[0].items;
+    CHECK_EQUAL(8u, byte_items.size());
+    const auto& zero = captured.writes[1].items.at(0);
+    const auto& one = captured.writes[2].items.at(0);
+    for (size_t i = 0; i < byte_items.size(); i++) {
+        const auto& expected = (0xA5 >> i) & 1 ? one : zero;
+        CHECK_EQUAL(expected.val, byte_items[i].val);
+    }
+
+    CHECK(IsLowThenHigh(zero));
+    CHECK(IsLowThenHigh(one));
+    CHECK(IsValidWriteSlot(GetLowNs(zero, captured.tick_ns), GetLowNs(one, captured.tick_ns), GetSlotNs(zero, captured.tick_ns)));
+    CHECK(IsValidWriteSlot(GetLowNs(zero, captured.tick_ns), GetLowNs(one, captured.tick_ns), GetSlotNs(one, captured.tick_ns)));
+    // Released for at least the recovery time before the next slot
+    CHECK(zero.duration1 * captured.tick_ns >= RECOVERY_US * 1000ULL);
+}
+
+TEST(RmtReadSlots)
+{
+    const auto captured = Capture([](OneWireRmtBackend& backend) {
+        backend.ReadBit();
+        backend.ReadByte();
+    });
+    CHECK_EQUAL(2u, captured.writes.size());
+    if (captured.writes.size() != 2) {
+        return;
+    }
+    CHECK_EQUAL(1u, captured.writes[0].items.size());
+    CHECK_EQUAL(8u, captured.writes[1].items.size());
+
+    for (const auto& write : captured.writes) {
+        for (const auto& item : write.items) {
+            CHECK(IsLowThenHigh(item));
+            CHECK(IsValidReadSlot(GetLowNs(item, captured.tick_ns), READ_SAMPLE_US * 1000ULL, GetSlotNs(item, captured.tick_ns)));
+            // The capture of a byte must not end between its slots
+            CHECK(item.duration1 < captured.rx_idle_ticks);
+        }
+    }
+}
+
+TEST(UartSlots)
+{
+    // The backend takes a UART port for good, so one backend runs every slot type
+    FakeIdf::SetUartAvailable(true);
+    FakeIdf::ClearUart();
+    {
+        OneWireUartBackend backend(GPIO_NUM_13);
+        CHECK(backend.IsValid());
+        backend.Reset();
+        backend.WriteByte(0xA5);
+        backend.WriteBit(false);
+        backend.WriteBit(true);
+        backend.ReadBit();
+        CHECK_EQUAL(0xFF, backend.ReadByte());
+    }
+    FakeIdf::SetUartAvailable(false);
+
+    const auto& writes = FakeIdf::GetUartWrites();
+    CHECK_EQUAL(6u, writes.size());
+    if (writes.size() != 6) {
+        return;
+    }
+
+    // Reset at its own, lower baud rate. The frame's high bits are the presence window.
+    const auto& reset = writes[0];
+    CHECK_EQUAL(1u, reset.bytes.size());
+    const uint64_t reset_low_ns = GetUartLowNs(reset.bytes.at(0), reset.baud_rate);
+    CHECK(IsValidReset(reset_low_ns));
+    CHECK(UART_FRAME_BITS * GetUartBitNs(reset.baud_rate) - reset_low_ns >= RESET_LOW_MIN_US * 1000ULL);
+
+    // LSB first: 0xA5 is 1, 0, 1, 0, 0, 1, 0, 1
+    const auto& byte_frames = writes[1].bytes;
+    CHECK_EQUAL(8u, byte_frames.size());
+    const uint8_t zero = writes[2].bytes.at(0);
+    const uint8_t one = writes[3].bytes.at(0);
+    for (size_t i = 0; i < byte_frames.size(); i++) {
+        CHECK_EQUAL((0xA5 >> i) & 1 ? one : zero, byte_frames[i]);
+    }
+    const uint32_t baud_rate = writes[1].baud_rate;
+    const uint64_t slot_ns = UART_FRAME_BITS * GetUartBitNs(baud_rate);
+    CHECK(IsValidWriteSlot(GetUartLowNs(zero, baud_rate), GetUartLowNs(one, baud_rate), slot_ns));
+    // The stop bit is the recovery time before the next frame
+    CHECK(GetUartBitNs(baud_rate) >= RECOVERY_US * 1000ULL);
+
+    // Reads are 1 slots, the UART samples the first data bit at its centre
+    for (size_t i = 4; i < 6; i++) {
+        CHECK_EQUAL(baud_rate, writes[i].baud_rate);
+        for (const uint8_t frame : writes[i].bytes) {
+            CHECK_EQUAL(one, frame);
+            CHECK(IsValidReadSlot(GetUartLowNs(frame, baud_rate), 3 * GetUartBitNs(baud_rate) / 2, slot_ns));
+        }
+    }
+    CHECK_EQUAL(8u, writes[5].bytes.size());
+}
+
+TEST(BitBangSlots)
+{
+    auto pin = std::make_shared<RecordingPin>();
+    OneWireBitBangBackend backend(pin);
+    // Nothing answers, so the reset is the pulse and the wait for presence
+    CHECK(!backend.Reset());
+    backend.WriteBit(false);
+    backend.WriteBit(true);
+    backend.ReadBit();
+
+    const auto& slots = pin->GetSlots();
+    CHECK_EQUAL(4u, slots.size());
+    if (slots.size() != 4) {
+        return;
+    }
+
+    CHECK(IsValidReset(slots[0].low_ns));
+    CHECK(slots[0].first_read_ns >= slots[0].low_ns + PRESENCE_WAIT_US * 1000ULL);
+    CHECK(slots[0].length_ns - slots[0].low_ns >= RESET_LOW_MIN_US * 1000ULL);
+
+    const auto& zero = slots[1];
+    const auto& one = slots[2];
+    CHECK(IsValidWriteSlot(zero.low_ns, one.low_ns, zero.length_ns - RECOVERY_US * 1000ULL));
+    CHECK(IsValidWriteSlot(zero.low_ns, one.low_ns, one.length_ns - RECOVERY_US * 1000ULL));
+    CHECK_EQUAL(0u, zero.first_read_ns);
+
+    const auto& read = slots[3];
+    CHECK(IsValidReadSlot(read.low_ns, read.first_read_ns, read.length_ns - RECOVERY_US * 1000ULL));
+}
@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <memory>
+
+#include "TestHarness.hpp"
+#include "FakeIdf.hpp"
+
+#include "esp_timer.h"
+
+#include "DS18B20Bus.hpp"
+#include "OneWireBitBangBackend.hpp"
+#include "OneWireBus.hpp"
+#include "OneWireSimulator.hpp"
+#include "VirtualDS18B20.hpp"
+
+namespace {
+    // A simulated bus whose time also moves while the drivers wait on the fake clock
+    struct SimulatedBus {
+        std::shared_ptr<OneWireSimulator> simulator = std::make_shared<OneWireSimulator>();
+        std::shared_ptr<OneWireBus> bus;
+
+        SimulatedBus() {
+            bus = std::make_shared<OneWireBus>(std::make_unique<OneWireBitBangBackend>(simulator));
+            auto simulator_ptr = simulator;
+            FakeIdf::SetDelayHook([simulator_ptr](int64_t us) { simulator_ptr->AdvanceTimeUs(us); });
+        }
+        ~SimulatedBus() {
+            FakeIdf::SetDelayHook(nullptr);
+        }
+
+        std::shared_ptr<VirtualDS18B20> AddSensor(uint64_t serial_number, double temperature) {
+            auto sensor = std::make_shared<VirtualDS18B20>(serial_number, [temperature](uint64_t) { return temperature; });
+            simulator->AddDevice(sensor);
+            return sensor;
+        }
+    };
+
+    OneWireBus::RomCode ToRomCode(const VirtualOneWireDevice::RomBytes& rom)
+    {
+        OneWireBus::RomCode rom_code;
+        rom_code.family_code = rom[0];
+        std::copy(rom.begin() + 1, rom.begin() + 7, rom_code.bytes.begin());
+        rom_code.crc = rom[7];
+        return rom_code;
+    }
+
+    bool Contains(const std::vector<OneWireBus::RomCode>& found, const std::shared_ptr<VirtualDS18B20>& sensor)
+    {
+        return std::find(found.begin(), found.end(), ToRomCode(sensor->GetRom())) != found.end();
+    }
+
+    Temperature FindReading(const std::vector<DS18B20Bus::Reading>& readings, const std::shared_ptr<VirtualDS18B20>& sensor)
+    {
+        for (const auto& reading : readings) {
+            if (reading.rom_code == ToRomCode(sensor->GetRom())) {
+                return reading.temperature;
+            }
+        }
+        return Temperature::Invalid();
+    }
+}
+
+TEST(SearchRomFindsEveryDevice)
+{
+    SimulatedBus sim;
+    // Serials that share long prefixes, so the search has to back up through several forks
+    const auto first = sim.AddSensor(0x000000000001, 20.);
+    const auto second = sim.AddSensor(0x000000000003, 20.);
+    const auto third = sim.AddSensor(0x800000000001, 20.);
+    const auto fourth = sim.AddSensor(0x123456789ABC, 20.);
+
+    std::vector<OneWireBus::RomCode> found;
+    CHECK(sim.bus->Search(found));
+    CHECK_EQUAL(4u, found.size());
+    for (const auto& sensor : {first, second, third, fourth}) {
+        CHECK(Contains(found, sensor));
+    }
+    for (const auto& rom_code : found) {
+        CHECK(OneWireBus::CheckCrc(rom_code));
+    }
+    CHECK_EQUAL(0, sim.simulator->GetStats().timing_violations);
+}
+
+TEST(SearchRomWithNothingOnTheBus)
+{
+    SimulatedBus sim;
+    std::vector<OneWireBus::RomCode> found;
+    CHECK(sim.bus->Search(found));
+    CHECK(found.empty());
+}
+
+TEST(SearchRomSkipsMissingDevice)
+{
+    SimulatedBus sim;
+    const auto present = sim.AddSensor(0x000000000010, 20.);
+    const auto missing = sim.AddSensor(0x000000000020, 20.);
+    VirtualOneWireDevice::Faults faults;
+    faults.is_missing = true;
+    missing->SetFaults(faults);
+
+    std::vector<OneWireBus::RomCode> found;
+    CHECK(sim.bus->Search(found));
+    CHECK_EQUAL(1u, found.size());
+    CHECK(Contains(found, present));
+}
+
+TEST(SearchRomFindsNothingOnStuckBus)
+{
+    SimulatedBus sim;
+    sim.AddSensor(0x000000000010, 20.);
+    sim.simulator->SetStuckLow(true);
+
+    // A line that never comes back up after the reset isn't a presence pulse
+    std::vector<OneWireBus::RomCode> found;
+    CHECK(sim.bus->Search(found));
+    CHECK(found.empty());
+}
+
+TEST(AlarmSearchFindsOnlyAlarmingSensors)
+{
+    SimulatedBus sim;
+    const auto cold = sim.AddSensor(0x000000000001, 20.);
+    const auto fine = sim.AddSensor(0x000000000002, 30.);
+    const auto hot = sim.AddSensor(0x000000000003, 40.);
+    DS18B20Bus sensors(sim.bus);
+    CHECK_EQUAL(3u, sensors.GetSensorCount());
+
+    // Nothing is flagged before a conversion has compared against the new thresholds
+    CHECK(sensors.SetAlarmThresholds(Temperature::FromDegrees(25), Temperature::FromDegrees(35)));
+    const auto all = sensors.ReadAll();
+    CHECK_EQUAL(3u, all.size());
+    CHECK(FindReading(all, fine) == Temperature::FromDegrees(30));
+
+    std::vector<OneWireBus::RomCode> alarming;
+    CHECK(sim.bus->Search(alarming, OneWireBus::ALARM_SEARCH));
+    CHECK_EQUAL(2u, alarming.size());
+    CHECK(Contains(alarming, cold));
+    CHECK(Contains(alarming, hot));
+    CHECK(!Contains(alarming, fine));
+
+    const auto readings = sensors.ReadAlarming();
+    CHECK_EQUAL(2u, readings.size());
+    CHECK(FindReading(readings, cold) == Temperature::FromDegrees(20));
+    CHECK(FindReading(readings, hot) == Temperature::FromDegrees(40));
+    CHECK_EQUAL(0, sim.simulator->GetStats().timing_violations);
+}
+
+TEST(AlarmSearchWithNothingAlarming)
+{
+    SimulatedBus sim;
+    sim.AddSensor(0x000000000001, 30.);
+    DS18B20Bus sensors(sim.bus);
+    CHECK(sensors.SetAlarmThresholds(Temperature::FromDegrees(25), Temperature::FromDegrees(35)));
+    CHECK_EQUAL(1u, sensors.ReadAll().size());
+
+    std::vector<OneWireBus::RomCode> alarming;
+    CHECK(sim.bus->Search(alarming, OneWireBus::ALARM_SEARCH));
+    CHECK(alarming.empty());
+    CHECK(sensors.ReadAlarming().empty());
+}
+
+TEST(ReadAllGivesUpOnUnfinishedConversion)
+{
+    SimulatedBus sim;
+    const auto stuck = sim.AddSensor(0x000000000001, 20.);
+    const auto fine = sim.AddSensor(0x000000000002, 30.);
+    DS18B20Bus sensors(sim.bus);
+    CHECK(sensors.SetResolution(DS18B20::Resolution_T::RES_12_BIT));
+    stuck->SetConversionDelayUs(60000000);
+
+    // The bus reads busy until every sensor is done, so neither reading can be trusted
+    const int64_t start_us = esp_timer_get_time();
+    const auto readings = sensors.ReadAll();
+    const int64_t waited_us = esp_timer_get_time() - start_us;
+    CHECK_EQUAL(2u, readings.size());
+    for (const auto& reading : readings) {
+        CHECK(!reading.IsValid());
+    }
+    const int64_t conversion_us = DS18B20::GetConversionTime(DS18B20::Resolution_T::RES_12_BIT).count();
+    CHECK(waited_us >= 2 * conversion_us);
+    CHECK(waited_us <= 2 * conversion_us + 20000);
+
+    // Back to normal once the sensor finishes in time again
+    stuck->SetConversionDelayUs(-1);
+    sim.simulator->AdvanceTimeUs(60000000);
+    const auto recovered = sensors.ReadAll();
+    CHECK_EQUAL(2u, recovered.size());
+    CHECK(FindReading(recovered, stuck) == Temperature::FromDegrees(20));
+    CHECK(FindReading(recovered, fine) == Temperature::FromDegrees(30));
+}
+
+TEST(ReadTemperatureGivesUpOnStuckBus)
+{
+    SimulatedBus sim;
+    const auto sensor = sim.AddSensor(0x000000000001, 20.);
+    DS18B20Bus sensors(sim.bus);
+    CHECK_EQUAL(1u, sensors.GetSensorCount());
+
+    // Shorted after the conversion was started, the wait has to come back instead of polling forever
+    DS18B20 single(sim.bus, ToRomCode(sensor->GetRom()));
+    CHECK(single.StartConversion());
+    sim.simulator->SetStuckLow(true);
+    CHECK(!DS18B20::WaitForConversion(*sim.bus, single.GetResolution()));
+    CHECK(!single.ReadTemperature().IsValid());
+}
+
+TEST(SettingsStayOutOfEeprom)
+{
+    SimulatedBus sim;
+    const auto sensor = sim.AddSensor(0x000000000001, 20.);
+    DS18B20Bus sensors(sim.bus);
+    CHECK(sensors.SetResolution(DS18B20::Resolution_T::RES_9_BIT));
+    CHECK(sensors.SetAlarmThresholds(Temperature::FromDegrees(25), Temperature::FromDegrees(35)));
+    CHECK_EQUAL(35, sensor->GetScratchpad()[2]);
+    CHECK_EQUAL(25, sensor->GetScratchpad()[3]);
+    CHECK_EQUAL(0x1F, sensor->GetScratchpad()[4]);
+
+    // The adaptive resolution must not become the power-on one, so nothing was copied to EEPROM
+    sensor->PowerOnReset();
+    CHECK_EQUAL(0x4B, sensor->GetScratchpad()[2]);
+    CHECK_EQUAL(0x46, sensor->GetScratchpad()[3]);
+    CHECK_EQUAL(0x7F, sensor->GetScratchpad()[4]);
+}
+
+TEST(AlarmSearchUsesEachSensorsBand)
+{
+    SimulatedBus sim;
+    const auto narrow = sim.AddSensor(0x000000000001, 30.);
+    const auto wide = sim.AddSensor(0x000000000002, 30.);
+    DS18B20Bus sensors(sim.bus);
+
+    // E.g. a rule at 28C on one probe while the thresholds only flag 35C
+    const auto narrow_rom = ToRomCode(narrow->GetRom());
+    CHECK(sensors.SetAlarmThresholds([narrow_rom](const DS18B20::RomCode& rom_code) {
+        return rom_code == narrow_rom ? std::make_pair(Temperature::FromDegrees(10), Temperature::FromDegrees(28))
+                                      : std::make_pair(Temperature::FromDegrees(10), Temperature::FromDegrees(35));
+    }));
+    CHECK_EQUAL(28, narrow->GetScratchpad()[2]);
+    CHECK_EQUAL(35, wide->GetScratchpad()[2]);
+    CHECK_EQUAL(2u, sensors.ReadAll().size());
+
+    const auto readings = sensors.ReadAlarming();
+    CHECK_EQUAL(1u, readings.size());
+    CHECK(FindReading(readings, narrow) == Temperature::FromDegrees(30));
+}
+
+TEST(CorruptedScratchpadReadsInvalid)
+{
+    SimulatedBus sim;
+    const auto sensor = sim.AddSensor(0x000000000001, 23.5);
+    DS18B20 single(sim.bus, ToRomCode(sensor->GetRom()));
+    CHECK(single.ReadTemperature() == Temperature::FromFloat(23.5f));
+
+    // Every bit the sensor sends is flipped, so the CRC can't match
+    VirtualOneWireDevice::Faults faults;
+    faults.bit_flip_probability = 1.;
+    sensor->SetFaults(faults);
+    CHECK(!single.ReadConvertedTemperature().IsValid());
+
+    // With the odd bit flipped a read is either the true value or invalid, never garbage that passed the CRC
+    faults.bit_flip_probability = 0.005;
+    sensor->SetFaults(faults);
+    size_t invalid_count = 0;
+    for (int i = 0; i < 500; i++) {
+        const auto temperature = single.ReadConvertedTemperature();
+        if (!temperature.IsValid()) {
+            ++invalid_count;
+            continue;
+        }
+        CHECK(temperature == Temperature::FromFloat(23.5f));
+    }
+    CHECK(invalid_count > 0);
+    CHECK(invalid_count < 500);
+}
+
+TEST(PowerOnValueIsReportedRaw)
+{
+    SimulatedBus sim;
+    const auto sensor = sim.AddSensor(0x000000000001, 23.5);
+    DS18B20 single(sim.bus, ToRomCode(sensor->GetRom()));
+
+    // Read before any conversion, the register still holds the 85C it powered up with
+    sensor->PowerOnReset();
+    const auto temperature = single.ReadConvertedTemperature();
+    CHECK(temperature.IsValid());
+    CHECK_EQUAL(VirtualDS18B20::POWER_ON_RAW, temperature.GetSixteenths());
+    CHECK(temperature == Temperature::FromDegrees(85));
+}
@@ -0,0 +1,139 @@
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#include "TestHarness.hpp"
+
+#include "Alarm.hpp"
+#include "AllocationCounter.hpp"
+#include "DataBinding.hpp"
+#include "FakeHttpd.hpp"
+#include "SampleLog.hpp"
+#include "SettingsStore.hpp"
+#include "TempImage.hpp"
+#include "Temperature.hpp"
+#include "TemperatureHistory.hpp"
+#include "TemperatureTrend.hpp"
+#include "WebUI.hpp"
+
+namespace {
+    constexpr int REPEAT_COUNT = 1000;
+
+    // Wired up as app_main does. There is one httpd at a time, so the tests share it.
+    struct Device {
+        TempImage image{"RequestPathAllocationTest_Log", 3};
+        std::shared_ptr<DataSourceSeqLock<Temperature>> temperature_source;
+        std::shared_ptr<DataSourceSeqLock<TemperatureTrend::Fit>> trend_source;
+        std::shared_ptr<SettingsStore> settings;
+        std::shared_ptr<Alarm> alarm;
+        std::shared_ptr<TemperatureHistory> history;
+        std::shared_ptr<SampleLog> sample_log;
+        std::unique_ptr<WebUI> web_ui;
+
+        Device() {
+            temperature_source = std::make_shared<DataSourceSeqLock<Temperature>>(Temperature::FromFloat(21.5f));
+            TemperatureTrend::Fit trend;
+            trend.value = Temperature::FromFloat(21.5f);
+            trend.slope_c_per_s = -0.01f;
+            trend.slope_error_c_per_s = 0.001f;
+            trend.r_squared = 0.9f;
+            trend.sample_count = 60;
+            trend_source = std::make_shared<DataSourceSeqLock<TemperatureTrend::Fit>>(trend);
+            settings = std::make_shared<SettingsStore>("storage");
+            alarm = std::make_shared<Alarm>(settings);
+            history = std::make_shared<TemperatureHistory>();
+            sample_log = std::make_shared<SampleLog>(image.Open());
+            sample_log->Open(0);
+            web_ui = std::make_unique<WebUI>(temperature_source, alarm, alarm, trend_source, history, sample_log);
+        }
+    };
+
+    Device& GetDevice()
+    {
+        static Device device;
+        return device;
+    }
+
+    // Big, so it lives outside the stack like httpd's own buffers
+    FakeHttpd::Response response;
+
+    // Only the steady state counts, the request runs once to warm up first
+    size_t CountAllocations(const FakeHttpd::Request& request)
+    {
+        GetDevice();
+        CHECK(FakeHttpd::Dispatch(request, response));
+        const size_t before = AllocationCounter::GetCount();
+        for (int i = 0; i < REPEAT_COUNT; i++) {
+            FakeHttpd::Dispatch(request, response);
+        }
+        return AllocationCounter::GetCount() - before;
+    }
+
+    std::string_view GetBody()
+    {
+        return {response.body, response.length};
+    }
+}
+
+TEST(GetCurrentTempDoesNotAllocate)
+{
+    FakeHttpd::Request request;
+    request.uri = "/current_temp";
+
+    CHECK_EQUAL(0u, CountAllocations(request));
+    CHECK_EQUAL(200, response.status);
+    CHECK(GetBody() == "21.5");
+}
+
+TEST(GetThresholdsDoesNotAllocate)
+{
+    FakeHttpd::Request request;
+    request.uri = "/thresholds";
+
+    CHECK_EQUAL(0u, CountAllocations(request));
+    CHECK_EQUAL(200, response.status);
+    CHECK(GetBody().find(R"("low":)") != std::string_view::npos);
+}
+
+TEST(GetEtaDoesNotAllocate)
+{
+    FakeHttpd::Request request;
+    request.uri = "/eta";
+
+    CHECK_EQUAL(0u, CountAllocations(request));
+    CHECK_EQUAL(200, response.status);
+    CHECK(GetBody().rfind(R"({"rate":)", 0) == 0);
+}
+
+TEST(PostThresholdsDoesNotAllocate)
+{
+    // Changing the thresholds recompiles the rule table, which allocates. The page posts the
+    // thresholds in force on every save, and that has to stay off the heap.
+    static const char BODY[] = R"({"low":"4.5","high":"30"})";
+    FakeHttpd::Request request;
+    request.method = HTTP_POST;
+    request.uri = "/thresholds";
+    request.body = BODY;
+    request.body_length = sizeof(BODY) - 1;
+    GetDevice().alarm->SetThresholds({Temperature::FromFloat(4.5f), Temperature::FromDegrees(30)});
+
+    CHECK_EQUAL(0u, CountAllocations(request));
+    CHECK_EQUAL(200, response.status);
+
+    FakeHttpd::Request get;
+    get.uri = "/thresholds";
+    CHECK(FakeHttpd::Dispatch(get, response));
+    CHECK(GetBody() == R"({"low":"4.5","high":"30"})");
+}
+
+TEST(CountingSeesAllocations)
+{
+    // Guards the tests above against a counter that never counts
+    const size_t before = AllocationCounter::GetCount();
+    for (int i = 0; i < REPEAT_COUNT; i++) {
+        int* volatile pointer = new int(1);
+        delete pointer;
+    }
+    CHECK_EQUAL(static_cast<size_t>(REPEAT_COUNT), AllocationCounter::GetCount() - before);
+}
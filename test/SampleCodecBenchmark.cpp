@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Benchmark.hpp"
+
+#include "SampleCodec.hpp"
+
+namespace {
+    constexpr size_t SAMPLE_COUNT = 24 * 60 * 60; // A day at 1Hz
+    constexpr size_t REPEAT_COUNT = 20;
+    constexpr size_t RAW_SAMPLE_SIZE = 8; // A SampleLog record
+    constexpr double PI = 3.14159265358979323846;
+
+    // A room drifting a couple of degrees over the day with a 12-bit sensor's noise, and now and then
+    // a missed reading so the timestamps aren't perfectly regular
+    std::vector<SampleDecoder::Sample> MakeTrace()
+    {
+        std::mt19937 random(42);
+        std::uniform_int_distribution<int> noise(-1, 1);
+        std::uniform_int_distribution<int> missed(0, 499);
+        std::vector<SampleDecoder::Sample> trace;
+        trace.reserve(SAMPLE_COUNT);
+        int64_t timestamp = 1700000000;
+        for (size_t i = 0; i < SAMPLE_COUNT; i++) {
+            const double degrees = 21. + 2. * std::sin(static_cast<double>(i) * 2. * PI / SAMPLE_COUNT);
+            trace.push_back({timestamp, static_cast<int16_t>(std::lround(degrees * 16.) + noise(random))});
+            timestamp += missed(random) == 0 ? 2 : 1;
+        }
+        return trace;
+    }
+
+    void Encode(const std::vector<SampleDecoder::Sample>& trace, SampleEncoder& encoder, std::vector<SampleBlock>& blocks)
+    {
+        blocks.clear();
+        encoder.Reset();
+        for (const auto& sample : trace) {
+            if (!encoder.Append(sample.timestamp, sample.value)) {
+                blocks.push_back(encoder.GetBlock());
+                encoder.Reset();
+                encoder.Append(sample.timestamp, sample.value);
+            }
+        }
+        if (!encoder.IsEmpty()) {
+            blocks.push_back(encoder.GetBlock());
+        }
+    }
+}
+
+int main()
+{
+    const auto trace = MakeTrace();
+    SampleEncoder encoder;
+    std::vector<SampleBlock> blocks;
+    blocks.reserve(SAMPLE_COUNT / 64);
+
+    const auto encode = Benchmark::Measure(REPEAT_COUNT, [&]() { Encode(trace, encoder, blocks); });
+
+    // What HistoryExport sends for each block: the two counts, then the bytes the bits take up
+    size_t byte_count = 0;
+    for (const auto& block : blocks) {
+        byte_count += sizeof(block.sample_count) + sizeof(block.bit_count) + (block.bit_count + 7) / 8;
+    }
+
+    size_t mismatch_count = 0;
+    const auto decode = Benchmark::Measure(REPEAT_COUNT, [&]() {
+        size_t index = 0;
+        mismatch_count = 0;
+        for (const auto& block : blocks) {
+            SampleDecoder decoder(block);
+            SampleDecoder::Sample sample;
+            while (decoder.Next(sample)) {
+                const bool is_match = index < trace.size() && sample.timestamp == trace[index].timestamp &&
+                                      sample.value == trace[index].value;
+                mismatch_count += is_match ? 0 : 1;
+                ++index;
+            }
+        }
+        mismatch_count += trace.size() - std::min(index, trace.size());
+    });
+
+    printf("%zu samples in %zu blocks\n", trace.size(), blocks.size());
+    printf("bytes/sample: %.3f (raw %zu)\n", static_cast<double>(byte_count) / trace.size(), RAW_SAMPLE_SIZE);
+    printf("encode ns/sample: %.2f\n", encode.ns / trace.size());
+    printf("decode ns/sample: %.2f\n", decode.ns / trace.size());
+    if (mismatch_count != 0) {
+        printf("%zu samples did not decode to what was encoded\n", mismatch_count);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "TestHarness.hpp"
+
+#include "SampleCodec.hpp"
+
+namespace {
+    using Sample = SampleDecoder::Sample;
+
+    // Appends until the block is full, returns what went in
+    std::vector<Sample> Encode(SampleEncoder& encoder, const std::vector<Sample>& samples)
+    {
+        std::vector<Sample> encoded;
+        for (const auto& sample : samples) {
+            if (!encoder.Append(sample.timestamp, sample.value)) {
+                break;
+            }
+            encoded.push_back(sample);
+        }
+        return encoded;
+    }
+
+    bool RoundTrips(const std::vector<Sample>& samples)
+    {
+        SampleEncoder encoder;
+        const auto encoded = Encode(encoder, samples);
+        std::vector<Sample> decoded;
+        if (encoded.size() != samples.size() || !SampleDecoder::DecodeBlock(encoder.GetBlock(), decoded)
+            || decoded.size() != samples.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < samples.size(); i++) {
+            if (decoded[i].timestamp != samples[i].timestamp || decoded[i].value != samples[i].value) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST(SteadySeriesIsCompact)
+{
+    SampleEncoder encoder;
+    std::vector<Sample> samples;
+    for (int i = 0; i < 100; i++) {
+        samples.push_back({1000 + i, static_cast<int16_t>(600 + i % 3)});
+    }
+    CHECK_EQUAL(samples.size(), Encode(encoder, samples).size());
+    // The second sample sets the spacing, after that a 1 bit timestamp code and at most a 6 bit value code
+    CHECK(encoder.GetBlock().bit_count <= 80 + 15 + 98 * 7);
+    CHECK(RoundTrips(samples));
+}
+
+TEST(FirstSampleKeepsFullRange)
+{
+    CHECK(RoundTrips({{std::numeric_limits<int64_t>::min(), std::numeric_limits<int16_t>::min()}}));
+    CHECK(RoundTrips({{std::numeric_limits<int64_t>::max(), std::numeric_limits<int16_t>::max()}}));
+    CHECK(RoundTrips({{-1, -1}}));
+}
+
+TEST(EdgeValueDeltas)
+{
+    // Swings across the whole int16 range need the widest value code
+    const int16_t min = std::numeric_limits<int16_t>::min();
+    const int16_t max = std::numeric_limits<int16_t>::max();
+    CHECK(RoundTrips({{0, min}, {1, max}, {2, min}, {3, 0}, {4, max}}));
+    // Either side of every code boundary: 4 bits holds zigzag < 16, 8 bits < 256
+    for (int delta : {-129, -128, -127, -9, -8, -7, -1, 1, 7, 8, 9, 127, 128, 129}) {
+        CHECK(RoundTrips({{0, 0}, {1, static_cast<int16_t>(delta)}, {2, 0}}));
+    }
+}
+
+TEST(EdgeTimestampDeltas)
+{
+    // Either side of the 7, 9 and 12 bit codes, and jitter around a steady period
+    for (int64_t jitter : {-2049, -2048, -2047, -257, -256, -255, -65, -64, -63, -1, 1, 63, 64, 65, 255, 256, 257, 2047, 2048, 2049}) {
+        CHECK(RoundTrips({{0, 0}, {1000, 0}, {2000 + jitter, 0}, {3000, 0}}));
+    }
+    // Gaps far beyond the 12 bit code, out of order and repeated timestamps
+    CHECK(RoundTrips({{0, 0}, {1000000000000LL, 1}, {1000000000001LL, 2}, {-5, 3}, {-5, 4}}));
+    CHECK(RoundTrips({{std::numeric_limits<int64_t>::min() / 2, 0}, {std::numeric_limits<int64_t>::max() / 2, 0}}));
+}
+
+TEST(FullBlockIsLeftIntact)
+{
+    // Random walk with jittery timestamps, until the block is full
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> step(-300, 300);
+    std::vector<Sample> samples;
+    int64_t timestamp = 0;
+    int16_t value = 0;
+    for (int i = 0; i < 2000; i++) {
+        timestamp += 1000 + step(random);
+        value = static_cast<int16_t>(value + step(random));
+        samples.push_back({timestamp, value});
+    }
+
+    SampleEncoder encoder;
+    const auto encoded = Encode(encoder, samples);
+    CHECK(encoded.size() < samples.size());
+    CHECK(encoder.GetBlock().bit_count <= SampleBlock::SIZE * 8);
+    CHECK_EQUAL(encoded.size(), static_cast<size_t>(encoder.GetBlock().sample_count));
+
+    // The rejected sample didn't leave anything behind
+    const auto bits_when_full = encoder.GetBlock().bit_count;
+    CHECK(!encoder.Append(samples[encoded.size()].timestamp, samples[encoded.size()].value));
+    CHECK_EQUAL(bits_when_full, encoder.GetBlock().bit_count);
+
+    std::vector<Sample> decoded;
+    CHECK(SampleDecoder::DecodeBlock(encoder.GetBlock(), decoded));
+    CHECK_EQUAL(encoded.size(), decoded.size());
+    for (size_t i = 0; i < decoded.size(); i++) {
+        CHECK_EQUAL(encoded[i].timestamp, decoded[i].timestamp);
+        CHECK_EQUAL(encoded[i].value, decoded[i].value);
+    }
+
+    // Reset starts an empty block
+    encoder.Reset();
+    CHECK(encoder.IsEmpty());
+    CHECK(RoundTrips({{5, 5}}));
+}
+
+TEST(CorruptBlockIsRejected)
+{
+    SampleEncoder encoder;
+    for (int i = 0; i < 10; i++) {
+        encoder.Append(i * 1000, static_cast<int16_t>(i * 100));
+    }
+
+    // Cut short, or claiming more samples than were written
+    SampleBlock truncated = encoder.GetBlock();
+    truncated.bit_count -= 3;
+    std::vector<Sample> decoded;
+    CHECK(!SampleDecoder::DecodeBlock(truncated, decoded));
+    CHECK(decoded.size() < 10);
+
+    SampleBlock overcounted = encoder.GetBlock();
+    overcounted.sample_count = 1000;
+    overcounted.bit_count = 0xFFFF;
+    decoded.clear();
+    CHECK(!SampleDecoder::DecodeBlock(overcounted, decoded));
+
+    SampleBlock empty;
+    empty.data.fill(0);
+    decoded.clear();
+    CHECK(SampleDecoder::DecodeBlock(empty, decoded));
+    CHECK(decoded.empty());
+}
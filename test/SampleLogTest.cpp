@@ -0,0 +1,185 @@
+#include <memory>
+#include <vector>
+
+#include "TestHarness.hpp"
+
+#include "SampleLog.hpp"
+#include "TempImage.hpp"
+
+namespace {
+    constexpr size_t SECTOR_COUNT = 3;
+    constexpr size_t HEADER_SIZE = 16;
+    constexpr size_t RECORD_SIZE = 8;
+
+    struct Replayed {
+        int64_t timestamp_us;
+        Temperature temperature;
+    };
+
+    std::vector<Replayed> ReplayAll(SampleLog& log)
+    {
+        std::vector<Replayed> replayed;
+        log.Replay([&replayed](int64_t timestamp_us, Temperature temperature) {
+            replayed.push_back({timestamp_us, temperature});
+        });
+        return replayed;
+    }
+
+    std::vector<SampleLog::Entry> ReadAll(SampleLog& log, uint32_t from_log_time_s)
+    {
+        std::vector<SampleLog::Entry> entries;
+        auto cursor = log.Seek(from_log_time_s);
+        SampleLog::Entry batch[7];
+        size_t count;
+        while ((count = log.Read(cursor, batch, 7)) > 0) {
+            entries.insert(entries.end(), batch, batch + count);
+        }
+        return entries;
+    }
+
+    Temperature SampleTemperature(size_t i)
+    {
+        return Temperature::FromSixteenths(static_cast<int16_t>(300 + i % 50));
+    }
+
+    // Fills whole seconds from 1 s on
+    void AppendSamples(SampleLog& log, size_t first, size_t count)
+    {
+        for (size_t i = first; i < first + count; i++) {
+            log.Append(static_cast<int64_t>(i + 1) * 1000000, SampleTemperature(i));
+        }
+    }
+
+    size_t GetRecordOffset(size_t sector, size_t slot)
+    {
+        return sector * FlashStorage::SECTOR_SIZE + HEADER_SIZE + slot * RECORD_SIZE;
+    }
+}
+
+TEST(SampleLogReplaysAfterReopen)
+{
+    TempImage image("SampleLogTest_Reopen", SECTOR_COUNT);
+    {
+        SampleLog log(image.Open());
+        CHECK(log.Open(0));
+        AppendSamples(log, 0, 10);
+        // A second sample within the same second is dropped
+        CHECK(log.Append(10500000, Temperature::FromDegrees(99)));
+        CHECK_EQUAL(10u, ReplayAll(log).size());
+    }
+
+    // Carries on right after the last record, so the old samples come back before this boot
+    SampleLog log(image.Open());
+    CHECK(log.Open(0));
+    CHECK_EQUAL(11, log.GetTimeOffsetS());
+    const auto replayed = ReplayAll(log);
+    CHECK_EQUAL(10u, replayed.size());
+    for (size_t i = 0; i < replayed.size(); i++) {
+        CHECK_EQUAL(static_cast<int64_t>(i) * 1000000 - 10000000, replayed[i].timestamp_us);
+        CHECK(replayed[i].temperature == SampleTemperature(i));
+    }
+
+    CHECK(log.Append(0, Temperature::FromDegrees(20)));
+    const auto entries = ReadAll(log, 0);
+    CHECK_EQUAL(11u, entries.size());
+    CHECK_EQUAL(11u, entries.back().log_time_s);
+}
+
+TEST(SampleLogWrapsOverOldestSector)
+{
+    TempImage image("SampleLogTest_Wrap", SECTOR_COUNT);
+    const size_t overflow = 100;
+    const size_t appended = SECTOR_COUNT * SampleLog::RECORDS_PER_SECTOR + overflow;
+    {
+        SampleLog log(image.Open());
+        CHECK(log.Open(0));
+        AppendSamples(log, 0, appended);
+    }
+
+    SampleLog log(image.Open());
+    CHECK(log.Open(0));
+    // The first sector was taken over by the newest records
+    const size_t kept = (SECTOR_COUNT - 1) * SampleLog::RECORDS_PER_SECTOR + overflow;
+    const auto replayed = ReplayAll(log);
+    CHECK_EQUAL(kept, replayed.size());
+    CHECK(replayed.front().temperature == SampleTemperature(SampleLog::RECORDS_PER_SECTOR));
+    CHECK(replayed.back().temperature == SampleTemperature(appended - 1));
+    for (size_t i = 1; i < replayed.size(); i++) {
+        CHECK_EQUAL(replayed[i - 1].timestamp_us + 1000000, replayed[i].timestamp_us);
+    }
+
+    // Log times are the sample's second, so the overwritten ones are gone and the rest are all there
+    const auto entries = ReadAll(log, 0);
+    CHECK_EQUAL(kept, entries.size());
+    CHECK_EQUAL(static_cast<uint32_t>(SampleLog::RECORDS_PER_SECTOR + 1), entries.front().log_time_s);
+
+    const uint32_t from_log_time_s = 1200;
+    const auto tail = ReadAll(log, from_log_time_s);
+    CHECK_EQUAL(appended - from_log_time_s + 1, tail.size());
+    CHECK_EQUAL(from_log_time_s, tail.front().log_time_s);
+}
+
+TEST(SampleLogSkipsTornRecord)
+{
+    TempImage image("SampleLogTest_TornRecord", SECTOR_COUNT);
+    {
+        SampleLog log(image.Open());
+        CHECK(log.Open(0));
+        AppendSamples(log, 0, 5);
+    }
+
+    // Power lost halfway through programming the sixth record
+    {
+        auto storage = image.Open();
+        const uint8_t half_record[RECORD_SIZE / 2] = {0x06, 0x00, 0x00, 0x00};
+        CHECK(storage->Write(GetRecordOffset(0, 5), half_record, sizeof(half_record)));
+    }
+
+    SampleLog log(image.Open());
+    CHECK(log.Open(0));
+    // The torn slot is left alone, the log goes on after it
+    CHECK_EQUAL(6, log.GetTimeOffsetS());
+    CHECK_EQUAL(5u, ReplayAll(log).size());
+    CHECK(log.Append(0, Temperature::FromDegrees(20)));
+    const auto replayed = ReplayAll(log);
+    CHECK_EQUAL(6u, replayed.size());
+    CHECK(replayed.back().temperature == Temperature::FromDegrees(20));
+    CHECK_EQUAL(6u, ReadAll(log, 0).size());
+}
+
+TEST(SampleLogRestartsTornSector)
+{
+    TempImage image("SampleLogTest_TornSector", SECTOR_COUNT);
+    {
+        SampleLog log(image.Open());
+        CHECK(log.Open(0));
+        AppendSamples(log, 0, SampleLog::RECORDS_PER_SECTOR);
+    }
+
+    // Power lost while writing the next sector's header, only the magic made it
+    {
+        auto storage = image.Open();
+        const uint32_t magic = 0x474F4C59;
+        CHECK(storage->Write(FlashStorage::SECTOR_SIZE, &magic, sizeof(magic)));
+    }
+
+    SampleLog log(image.Open());
+    CHECK(log.Open(0));
+    CHECK_EQUAL(SampleLog::RECORDS_PER_SECTOR, ReplayAll(log).size());
+    AppendSamples(log, 0, 3);
+    const auto replayed = ReplayAll(log);
+    CHECK_EQUAL(SampleLog::RECORDS_PER_SECTOR + 3, replayed.size());
+    CHECK_EQUAL(SampleLog::RECORDS_PER_SECTOR + 3, ReadAll(log, 0).size());
+}
+
+TEST(SampleLogFormatsBlankStorage)
+{
+    TempImage image("SampleLogTest_Blank", SECTOR_COUNT);
+    SampleLog log(image.Open());
+    CHECK(log.Open(5000000));
+    CHECK(ReplayAll(log).empty());
+    CHECK(ReadAll(log, 0).empty());
+    // Invalid readings aren't logged
+    CHECK(log.Append(6000000, Temperature::Invalid()));
+    CHECK(ReplayAll(log).empty());
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+// Just enough of a test framework for the host tests. TEST registers a function, CHECK records a
+// failure and carries on, and main (TestMain.cpp) runs every test in the executable and returns
+// non-zero if any check failed, which is what ctest looks at.
+namespace TestHarness {
+    struct Test {
+        const char* name;
+        void (*run)();
+    };
+
+    inline std::vector<Test>& GetTests()
+    {
+        static std::vector<Test> tests;
+        return tests;
+    }
+
+    inline int& GetFailureCount()
+    {
+        static int failure_count = 0;
+        return failure_count;
+    }
+
+    struct Registrar {
+        Registrar(const char* name, void (*run)()) { GetTests().push_back({name, run}); }
+    };
+
+    inline void Fail(const char* file, int line, const char* expression)
+    {
+        ++GetFailureCount();
+        printf("%s:%d: CHECK(%s) failed\n", file, line, expression);
+    }
+}
+
+#define TEST(name)                                                             \
+    static void name();                                                        \
+    static const TestHarness::Registrar name##_registrar(#name, &name);        \
+    static void name()
+
+#define CHECK(condition)                                                       \
+    do {                                                                       \
+        if (!(condition)) {                                                    \
+            TestHarness::Fail(__FILE__, __LINE__, #condition);                 \
+        }                                                                      \
+    } while (0)
+
+#define CHECK_EQUAL(expected, actual) CHECK((expected) == (actual))
@@ -0,0 +1,11 @@
+#include "TestHarness.hpp"
+
+int main()
+{
+    for (const auto& test : TestHarness::GetTests()) {
+        const int failures_before = TestHarness::GetFailureCount();
+        test.run();
+        printf("%s %s\n", TestHarness::GetFailureCount() == failures_before ? "PASS" : "FAIL", test.name);
+    }
+    return TestHarness::GetFailureCount() == 0 ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#include "AllocationCounter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> allocation_count(0);
+
+size_t AllocationCounter::GetCount()
+{
+    return allocation_count.load();
+}
+
+void* operator new(size_t size)
+{
+    ++allocation_count;
+    if (void* pointer = malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    ++allocation_count;
+    return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete[](void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts every operator new in the test executables linking AllocationCounter.cpp, see add_host_test.
+// Tests compare the count before and after the code under test.
+namespace AllocationCounter {
+    size_t GetCount();
+}
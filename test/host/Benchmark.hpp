@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Timing for the host benchmarks. The build machine is no ESP32, so only the ratios between
+// numbers from the same run mean much. Cycles come from the time stamp counter where there is one.
+namespace Benchmark {
+    struct Result {
+        double ns;     // Per iteration
+        double cycles; // Per iteration, 0 without a cycle counter
+    };
+
+    inline uint64_t ReadCycles()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    // Keeps the compiler from dropping a result nothing else reads
+    template <typename T>
+    inline void KeepAlive(const T& value)
+    {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+
+    // Runs body once to warm up, then iteration_count times
+    template <typename Body>
+    Result Measure(size_t iteration_count, Body body)
+    {
+        body();
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t start_cycles = ReadCycles();
+        for (size_t i = 0; i < iteration_count; i++) {
+            body();
+        }
+        const uint64_t cycles = ReadCycles() - start_cycles;
+        const auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return {ns / static_cast<double>(iteration_count), static_cast<double>(cycles) / static_cast<double>(iteration_count)};
+    }
+}
@@ -0,0 +1,71 @@
+#include "FileFlashStorage.hpp"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+FileFlashStorage::FileFlashStorage(const std::string& path, size_t size) : _size(size)
+{
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return;
+    }
+    struct stat status;
+    const bool is_new = fstat(fd, &status) == 0 && status.st_size == 0;
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return;
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return;
+    }
+    _data = static_cast<uint8_t*>(data);
+    if (is_new) {
+        memset(_data, 0xFF, _size);
+    }
+}
+
+FileFlashStorage::~FileFlashStorage()
+{
+    if (_data != nullptr) {
+        munmap(_data, _size);
+    }
+}
+
+bool FileFlashStorage::Read(size_t offset, void* data, size_t size)
+{
+    if (_data == nullptr || offset + size > _size) {
+        return false;
+    }
+    memcpy(data, _data + offset, size);
+    return true;
+}
+
+bool FileFlashStorage::Write(size_t offset, const void* data, size_t size)
+{
+    if (_data == nullptr || offset + size > _size) {
+        return false;
+    }
+
+    // Programming can only clear bits
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        _data[offset + i] &= bytes[i];
+    }
+    return true;
+}
+
+bool FileFlashStorage::EraseSector(size_t offset)
+{
+    if (_data == nullptr || offset % SECTOR_SIZE != 0 || offset + SECTOR_SIZE > _size) {
+        return false;
+    }
+    memset(_data + offset, 0xFF, SECTOR_SIZE);
+    return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "FlashStorage.hpp"
+
+// A partition image in a file, for running SampleLog on a build machine. Behaves like NOR flash:
+// a new image reads 0xFF and writes only clear bits, so torn or repeated writes show up as they would on the device.
+// The file is mapped shared, so images of thousands of sectors stay quick and every instance on a path sees the same bytes.
+class FileFlashStorage : public FlashStorage {
+    uint8_t* _data = nullptr;
+    size_t _size;
+public:
+    // Opens the image at path, creating an erased one of the given size if it doesn't exist
+    FileFlashStorage(const std::string& path, size_t size);
+    ~FileFlashStorage() override;
+
+    FileFlashStorage(const FileFlashStorage&) = delete;
+    FileFlashStorage& operator=(const FileFlashStorage&) = delete;
+
+    [[nodiscard]] bool IsValid() const override { return _data != nullptr; }
+    [[nodiscard]] size_t GetSize() const override { return _size; }
+
+    bool Read(size_t offset, void* data, size_t size) override;
+    bool Write(size_t offset, const void* data, size_t size) override;
+    bool EraseSector(size_t offset) override;
+};
@@ -0,0 +1,65 @@
+#include "OneWireSimulator.hpp"
+
+#include <algorithm>
+
+#include "OneWireTiming.hpp"
+
+using namespace OneWireTiming;
+
+void OneWireSimulator::AddDevice(const std::shared_ptr<VirtualOneWireDevice>& device)
+{
+    _devices.push_back(device);
+}
+
+void OneWireSimulator::RemoveDevice(const std::shared_ptr<VirtualOneWireDevice>& device)
+{
+    _devices.erase(std::remove(_devices.begin(), _devices.end(), device), _devices.end());
+}
+
+void OneWireSimulator::Hold()
+{
+    if (_is_master_holding) {
+        return;
+    }
+    _is_master_holding = true;
+    _hold_start_us = _now_us;
+    for (auto& device : _devices) {
+        device->OnFallingEdge(_now_us);
+    }
+}
+
+void OneWireSimulator::Release()
+{
+    if (!_is_master_holding) {
+        return;
+    }
+    _is_master_holding = false;
+
+    const uint64_t low_us = _now_us - _hold_start_us;
+    if (low_us >= RESET_LOW_MIN_US) {
+        ++_stats.resets;
+    } else {
+        ++_stats.slots;
+        // Between a 1 and a 0, or between a 0 and a reset, no device can tell what was meant
+        if ((low_us > WRITE_1_LOW_MAX_US && low_us < WRITE_0_LOW_MIN_US) || low_us > WRITE_0_LOW_MAX_US) {
+            ++_stats.timing_violations;
+        }
+    }
+
+    for (auto& device : _devices) {
+        device->OnRisingEdge(_now_us, low_us);
+    }
+}
+
+bool OneWireSimulator::Read()
+{
+    if (_is_stuck_low || _is_master_holding) {
+        return false;
+    }
+    return std::none_of(_devices.begin(), _devices.end(), [this](const auto& device) { return device->IsHoldingLow(_now_us); });
+}
+
+void OneWireSimulator::DelayUs(uint32_t us)
+{
+    _now_us += us;
+}
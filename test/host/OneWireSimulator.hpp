@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "OneWirePin.hpp"
+#include "VirtualOneWireDevice.hpp"
+
+// A simulated 1-Wire line with virtual devices on it, for exercising OneWireBus and the DS18B20
+// drivers on a build machine. Plugs in under OneWireBitBangBackend in place of the GPIO pin.
+// Time only moves when the master delays, so runs are deterministic and instant.
+class OneWireSimulator : public OneWirePin {
+public:
+    struct Stats {
+        int resets = 0;
+        int slots = 0;
+        int timing_violations = 0; // Low pulses that are neither a valid slot nor a reset
+    };
+private:
+    std::vector<std::shared_ptr<VirtualOneWireDevice>> _devices;
+    uint64_t _now_us = 0;
+    bool _is_master_holding = false;
+    uint64_t _hold_start_us = 0;
+    bool _is_stuck_low = false;
+    Stats _stats;
+public:
+    OneWireSimulator() = default;
+
+    void AddDevice(const std::shared_ptr<VirtualOneWireDevice>& device);
+    void RemoveDevice(const std::shared_ptr<VirtualOneWireDevice>& device);
+    // Shorted bus, every reset and slot reads low
+    void SetStuckLow(bool is_stuck_low) { _is_stuck_low = is_stuck_low; }
+
+    void AdvanceTimeUs(uint64_t us) { _now_us += us; }
+    [[nodiscard]] uint64_t GetTimeUs() const { return _now_us; }
+    [[nodiscard]] const Stats& GetStats() const { return _stats; }
+
+    void Hold() override;
+    void Release() override;
+    [[nodiscard]] bool Read() override;
+    void DelayUs(uint32_t us) override;
+};
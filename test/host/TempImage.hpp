@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "FileFlashStorage.hpp"
+
+// A fresh, erased partition image of sector_count sectors, deleted again when the test is done.
+// The name has to be unique across the tests, they may run in parallel in the same directory.
+struct TempImage {
+    std::string path;
+    size_t sector_count;
+
+    TempImage(const std::string& name, size_t sector_count) : path(name + ".bin"), sector_count(sector_count) {
+        std::remove(path.c_str());
+    }
+    ~TempImage() {
+        std::remove(path.c_str());
+    }
+
+    TempImage(const TempImage&) = delete;
+    TempImage& operator=(const TempImage&) = delete;
+
+    [[nodiscard]] std::shared_ptr<FileFlashStorage> Open() const {
+        return std::make_shared<FileFlashStorage>(path, sector_count * FlashStorage::SECTOR_SIZE);
+    }
+};
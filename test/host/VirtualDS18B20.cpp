@@ -0,0 +1,139 @@
+#include "VirtualDS18B20.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+static constexpr uint8_t CONVERT_T = 0x44;
+static constexpr uint8_t READ_SCRATCHPAD = 0xBE;
+static constexpr uint8_t WRITE_SCRATCHPAD = 0x4E;
+static constexpr uint8_t COPY_SCRATCHPAD = 0x48;
+static constexpr uint8_t RECALL_EEPROM = 0xB8;
+static constexpr uint8_t READ_POWER_SUPPLY = 0xB4;
+
+static constexpr uint64_t CONVERSION_TIME_12_BIT_US = 750000;
+static constexpr double MIN_TEMP = -55.;
+static constexpr double MAX_TEMP = 125.;
+
+// Factory defaults: TH 75C, TL 70C, 12-bit
+static constexpr std::array<uint8_t, 3> DEFAULT_EEPROM = {0x4B, 0x46, 0x7F};
+
+VirtualDS18B20::VirtualDS18B20(uint64_t serial_number, TemperatureScript temperature_script) : VirtualOneWireDevice(MakeRom(FAMILY_CODE, serial_number)),
+                                                                                               _scratchpad{0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x0C, 0x10, 0x00},
+                                                                                               _eeprom(DEFAULT_EEPROM),
+                                                                                               _temperature_script(std::move(temperature_script))
+{
+    PowerOnReset();
+}
+
+void VirtualDS18B20::PowerOnReset()
+{
+    _is_converting = false;
+    _is_alarming = false;
+    _state = State::IDLE;
+    std::copy(_eeprom.begin(), _eeprom.end(), _scratchpad.begin() + 2);
+    SetRawTemperature(POWER_ON_RAW);
+}
+
+void VirtualDS18B20::SetRawTemperature(int16_t raw)
+{
+    _scratchpad[0] = static_cast<uint8_t>(raw & 0xFF);
+    _scratchpad[1] = static_cast<uint8_t>((raw >> 8) & 0xFF);
+    _scratchpad[8] = Crc8(_scratchpad.data(), 8);
+}
+
+int VirtualDS18B20::GetResolutionBits() const
+{
+    return 9 + ((_scratchpad[4] >> 5) & 0x03);
+}
+
+uint64_t VirtualDS18B20::GetConversionTimeUs() const
+{
+    if (_conversion_delay_us >= 0) {
+        return _conversion_delay_us;
+    }
+    return CONVERSION_TIME_12_BIT_US >> (12 - GetResolutionBits());
+}
+
+void VirtualDS18B20::UpdateConversion(uint64_t now_us)
+{
+    if (!_is_converting || now_us < _conversion_done_us) {
+        return;
+    }
+    _is_converting = false;
+
+    const double clamped = std::min(std::max(_converted_temperature, MIN_TEMP), MAX_TEMP);
+    auto raw = static_cast<int16_t>(std::lround(clamped * 16.));
+    // Undefined low bits read as 0 below 12-bit resolution
+    raw &= ~((1 << (12 - GetResolutionBits())) - 1);
+    SetRawTemperature(raw);
+
+    // Alarm compares the integer part against TH/TL
+    const auto whole_degrees = static_cast<int8_t>(raw >> 4);
+    _is_alarming = whole_degrees >= static_cast<int8_t>(_scratchpad[2]) || whole_degrees <= static_cast<int8_t>(_scratchpad[3]);
+}
+
+void VirtualDS18B20::OnFunctionCommand(uint8_t command, uint64_t now_us)
+{
+    UpdateConversion(now_us);
+    _function_command = command;
+    _data_index = 0;
+
+    switch (command) {
+        case CONVERT_T:
+            _is_converting = true;
+            _conversion_done_us = now_us + GetConversionTimeUs();
+            _converted_temperature = _temperature_script ? _temperature_script(now_us) : 25.;
+            _state = State::FUNCTION_STATUS;
+            break;
+        case READ_SCRATCHPAD:
+            for (auto byte : _scratchpad) {
+                SendByte(byte);
+            }
+            break;
+        case WRITE_SCRATCHPAD:
+            _state = State::FUNCTION_DATA;
+            break;
+        case COPY_SCRATCHPAD:
+            std::copy(_scratchpad.begin() + 2, _scratchpad.begin() + 5, _eeprom.begin());
+            break;
+        case RECALL_EEPROM:
+            std::copy(_eeprom.begin(), _eeprom.end(), _scratchpad.begin() + 2);
+            _scratchpad[8] = Crc8(_scratchpad.data(), 8);
+            break;
+        case READ_POWER_SUPPLY:
+            // Externally powered
+            SendBit(true);
+            break;
+        default:
+            break;
+    }
+}
+
+void VirtualDS18B20::OnFunctionData(uint8_t data, uint64_t /*now_us*/)
+{
+    if (_function_command != WRITE_SCRATCHPAD) {
+        return;
+    }
+
+    // TH, TL, then config. Only the resolution bits of config are writable.
+    if (_data_index < 2) {
+        _scratchpad[2 + _data_index] = data;
+    } else {
+        _scratchpad[4] = (data & 0x60) | 0x1F;
+        _state = State::IDLE;
+    }
+    ++_data_index;
+    _scratchpad[8] = Crc8(_scratchpad.data(), 8);
+}
+
+bool VirtualDS18B20::GetStatusBit(uint64_t now_us)
+{
+    UpdateConversion(now_us);
+    return !_is_converting;
+}
+
+bool VirtualDS18B20::IsAlarming(uint64_t now_us)
+{
+    UpdateConversion(now_us);
+    return _is_alarming;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <functional>
+
+#include "VirtualOneWireDevice.hpp"
+
+// Simulated DS18B20 for OneWireSimulator. The temperature comes from a script of simulated time,
+// conversions take the datasheet time for the configured resolution unless overridden.
+class VirtualDS18B20 : public VirtualOneWireDevice {
+public:
+    using TemperatureScript = std::function<double(uint64_t now_us)>;
+
+    static constexpr uint8_t FAMILY_CODE = 0x28;
+    static constexpr int16_t POWER_ON_RAW = 0x0550; // 85C, what the register holds until the first conversion
+private:
+    std::array<uint8_t, 9> _scratchpad;
+    std::array<uint8_t, 3> _eeprom; // TH, TL, config
+    TemperatureScript _temperature_script;
+    int64_t _conversion_delay_us = -1;
+
+    bool _is_converting = false;
+    uint64_t _conversion_done_us = 0;
+    double _converted_temperature = 0.;
+    bool _is_alarming = false;
+
+    uint8_t _function_command = 0;
+    int _data_index = 0;
+
+    void SetRawTemperature(int16_t raw);
+    void UpdateConversion(uint64_t now_us);
+    [[nodiscard]] int GetResolutionBits() const;
+protected:
+    void OnFunctionCommand(uint8_t command, uint64_t now_us) override;
+    void OnFunctionData(uint8_t data, uint64_t now_us) override;
+    bool GetStatusBit(uint64_t now_us) override;
+    bool IsAlarming(uint64_t now_us) override;
+public:
+    VirtualDS18B20(uint64_t serial_number, TemperatureScript temperature_script);
+
+    void SetTemperatureScript(TemperatureScript temperature_script) { _temperature_script = std::move(temperature_script); }
+    // Negative restores the datasheet conversion time
+    void SetConversionDelayUs(int64_t delay_us) { _conversion_delay_us = delay_us; }
+    [[nodiscard]] uint64_t GetConversionTimeUs() const;
+
+    // Brownout: the scratchpad is reloaded from EEPROM and the temperature reads 85C
+    void PowerOnReset();
+
+    [[nodiscard]] const std::array<uint8_t, 9>& GetScratchpad() const { return _scratchpad; }
+};
@@ -0,0 +1,214 @@
+#include "VirtualOneWireDevice.hpp"
+
+#include "OneWireTiming.hpp"
+
+// Slave side timings, typical values from the DS18B20 datasheet
+static constexpr uint64_t PRESENCE_WAIT_US = 30;
+static constexpr uint64_t PRESENCE_US = 120;
+static constexpr uint64_t SAMPLE_US = 30; // Master writes a 0 if it still holds the line at this point
+static constexpr uint64_t TX_0_HOLD_US = 30;
+
+static constexpr uint8_t READ_ROM = 0x33;
+static constexpr uint8_t MATCH_ROM = 0x55;
+static constexpr uint8_t SKIP_ROM = 0xCC;
+static constexpr uint8_t SEARCH_ROM = 0xF0;
+static constexpr uint8_t ALARM_SEARCH = 0xEC;
+
+VirtualOneWireDevice::VirtualOneWireDevice(const RomBytes& rom) : _rom(rom), _random(Crc8(rom.data(), rom.size()) + 1)
+{
+
+}
+
+bool VirtualOneWireDevice::GetRomBit(int bit) const
+{
+    return _rom[bit / 8] & (1 << (bit % 8));
+}
+
+void VirtualOneWireDevice::HoldLow(uint64_t from_us, uint64_t duration_us)
+{
+    _hold_from_us = from_us;
+    _hold_until_us = from_us + duration_us;
+}
+
+bool VirtualOneWireDevice::IsHoldingLow(uint64_t now_us) const
+{
+    return now_us >= _hold_from_us && now_us < _hold_until_us;
+}
+
+void VirtualOneWireDevice::SendBit(bool bit)
+{
+    _tx_bits.push_back(bit);
+}
+
+void VirtualOneWireDevice::SendByte(uint8_t byte)
+{
+    for (int i = 0; i < 8; i++) {
+        SendBit(byte & (1 << i));
+    }
+}
+
+void VirtualOneWireDevice::OnFallingEdge(uint64_t now_us)
+{
+    _is_tx_slot = false;
+    if (_faults.is_missing) {
+        return;
+    }
+
+    bool bit;
+    if (!_tx_bits.empty()) {
+        bit = _tx_bits.front();
+        _tx_bits.pop_front();
+        if (_faults.bit_flip_probability > 0. &&
+            std::uniform_real_distribution<double>(0., 1.)(_random) < _faults.bit_flip_probability) {
+            bit = !bit;
+        }
+    } else if (_state == State::FUNCTION_STATUS) {
+        bit = GetStatusBit(now_us);
+    } else {
+        return;
+    }
+
+    _is_tx_slot = true;
+    if (!bit) {
+        HoldLow(now_us, TX_0_HOLD_US);
+    }
+}
+
+void VirtualOneWireDevice::OnRisingEdge(uint64_t now_us, uint64_t low_us)
+{
+    if (_faults.is_missing) {
+        return;
+    }
+
+    if (low_us >= OneWireTiming::RESET_LOW_MIN_US) {
+        _tx_bits.clear();
+        _is_tx_slot = false;
+        _rx_byte = 0;
+        _rx_bit_count = 0;
+        _state = State::ROM_COMMAND;
+        HoldLow(now_us + PRESENCE_WAIT_US, PRESENCE_US);
+        OnReset(now_us);
+        return;
+    }
+
+    if (_is_tx_slot) {
+        _is_tx_slot = false;
+        return;
+    }
+
+    if (_state != State::IDLE && _state != State::FUNCTION_STATUS) {
+        OnBitReceived(low_us < SAMPLE_US, now_us);
+    }
+}
+
+void VirtualOneWireDevice::StartSearch()
+{
+    _state = State::SEARCH_ROM;
+    _search_bit = 0;
+    SendBit(GetRomBit(0));
+    SendBit(!GetRomBit(0));
+}
+
+void VirtualOneWireDevice::OnBitReceived(bool bit, uint64_t now_us)
+{
+    if (_state == State::SEARCH_ROM) {
+        // Master picked the branch, drop out if it isn't ours
+        if (bit != GetRomBit(_search_bit)) {
+            _state = State::IDLE;
+        } else if (++_search_bit == 64) {
+            _state = State::FUNCTION_COMMAND;
+        } else {
+            SendBit(GetRomBit(_search_bit));
+            SendBit(!GetRomBit(_search_bit));
+        }
+        return;
+    }
+
+    _rx_byte |= (static_cast<uint8_t>(bit) << _rx_bit_count);
+    if (++_rx_bit_count == 8) {
+        const uint8_t byte = _rx_byte;
+        _rx_byte = 0;
+        _rx_bit_count = 0;
+        OnByteReceived(byte, now_us);
+    }
+}
+
+void VirtualOneWireDevice::OnByteReceived(uint8_t byte, uint64_t now_us)
+{
+    switch (_state) {
+        case State::ROM_COMMAND:
+            switch (byte) {
+                case READ_ROM:
+                    for (auto rom_byte : _rom) {
+                        SendByte(rom_byte);
+                    }
+                    _state = State::FUNCTION_COMMAND;
+                    break;
+                case MATCH_ROM:
+                    _state = State::MATCH_ROM;
+                    _match_index = 0;
+                    _is_match = true;
+                    break;
+                case SKIP_ROM:
+                    _state = State::FUNCTION_COMMAND;
+                    break;
+                case SEARCH_ROM:
+                    StartSearch();
+                    break;
+                case ALARM_SEARCH:
+                    if (IsAlarming(now_us)) {
+                        StartSearch();
+                    } else {
+                        _state = State::IDLE;
+                    }
+                    break;
+                default:
+                    _state = State::IDLE;
+                    break;
+            }
+            break;
+        case State::MATCH_ROM:
+            _is_match = _is_match && byte == _rom[_match_index];
+            if (++_match_index == static_cast<int>(_rom.size())) {
+                _state = _is_match ? State::FUNCTION_COMMAND : State::IDLE;
+            }
+            break;
+        case State::FUNCTION_COMMAND:
+            _state = State::IDLE;
+            OnFunctionCommand(byte, now_us);
+            break;
+        case State::FUNCTION_DATA:
+            OnFunctionData(byte, now_us);
+            break;
+        default:
+            break;
+    }
+}
+
+uint8_t VirtualOneWireDevice::Crc8(const uint8_t* data, size_t size)
+{
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        uint8_t byte = data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            const bool mix = (crc ^ byte) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8C;
+            }
+            byte >>= 1;
+        }
+    }
+    return crc;
+}
+
+VirtualOneWireDevice::RomBytes VirtualOneWireDevice::MakeRom(uint8_t family_code, uint64_t serial_number)
+{
+    RomBytes rom;
+    rom[0] = family_code;
+    for (int i = 0; i < 6; i++) {
+        rom[i + 1] = static_cast<uint8_t>(serial_number >> (8 * i));
+    }
+    rom[7] = Crc8(rom.data(), 7);
+    return rom;
+}
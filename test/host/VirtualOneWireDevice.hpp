@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+
+// Slave side of the 1-Wire protocol for devices living on a OneWireSimulator: reset/presence,
+// slot decoding and the ROM command layer (Read/Match/Skip ROM, Search ROM, Alarm Search).
+// Subclasses implement the function commands.
+class VirtualOneWireDevice {
+public:
+    using RomBytes = std::array<uint8_t, 8>; // Family code, 6 byte serial number, CRC
+
+    struct Faults {
+        bool is_missing = false; // Ignores resets and slots, as if unplugged
+        double bit_flip_probability = 0.; // Applied to every bit the device sends
+    };
+protected:
+    enum class State {
+        IDLE, // Ignores slots until the next reset
+        ROM_COMMAND,
+        MATCH_ROM,
+        SEARCH_ROM,
+        FUNCTION_COMMAND,
+        FUNCTION_DATA, // Bytes following a function command, handed to OnFunctionData
+        FUNCTION_STATUS // Answers read slots with GetStatusBit, e.g. conversion in progress
+    };
+
+    State _state = State::IDLE;
+private:
+    RomBytes _rom;
+    Faults _faults;
+    std::minstd_rand _random;
+
+    std::deque<bool> _tx_bits;
+    bool _is_tx_slot = false;
+    uint8_t _rx_byte = 0;
+    int _rx_bit_count = 0;
+    int _match_index = 0;
+    bool _is_match = false;
+    int _search_bit = 0;
+
+    uint64_t _hold_from_us = 0;
+    uint64_t _hold_until_us = 0;
+
+    [[nodiscard]] bool GetRomBit(int bit) const;
+    void HoldLow(uint64_t from_us, uint64_t duration_us);
+    void StartSearch();
+    void OnBitReceived(bool bit, uint64_t now_us);
+    void OnByteReceived(uint8_t byte, uint64_t now_us);
+protected:
+    void SendBit(bool bit);
+    void SendByte(uint8_t byte);
+
+    virtual void OnReset(uint64_t /*now_us*/) {}
+    // Called with the state set to IDLE, switch to FUNCTION_DATA or FUNCTION_STATUS to keep talking
+    virtual void OnFunctionCommand(uint8_t command, uint64_t now_us) = 0;
+    virtual void OnFunctionData(uint8_t /*data*/, uint64_t /*now_us*/) {}
+    // False pulls the read slot low
+    virtual bool GetStatusBit(uint64_t /*now_us*/) { return true; }
+    // Whether the device takes part in an Alarm Search
+    virtual bool IsAlarming(uint64_t /*now_us*/) { return false; }
+public:
+    explicit VirtualOneWireDevice(const RomBytes& rom);
+    virtual ~VirtualOneWireDevice() = default;
+
+    [[nodiscard]] const RomBytes& GetRom() const { return _rom; }
+    void SetFaults(const Faults& faults) { _faults = faults; }
+    [[nodiscard]] const Faults& GetFaults() const { return _faults; }
+
+    // Edges driven by the bus master, low_us is how long the master held the line
+    void OnFallingEdge(uint64_t now_us);
+    void OnRisingEdge(uint64_t now_us, uint64_t low_us);
+    [[nodiscard]] bool IsHoldingLow(uint64_t now_us) const;
+
+    static uint8_t Crc8(const uint8_t* data, size_t size);
+    static RomBytes MakeRom(uint8_t family_code, uint64_t serial_number);
+};
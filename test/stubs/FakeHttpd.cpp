@@ -0,0 +1,322 @@
+#include "FakeHttpd.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+namespace {
+    constexpr size_t MAX_HANDLERS = 32;
+    constexpr size_t MAX_QUEUED_WORK = 8;
+
+    struct Server {
+        httpd_config_t config;
+        httpd_uri_t handlers[MAX_HANDLERS];
+        size_t handler_count = 0;
+        struct {
+            httpd_work_fn_t work;
+            void* arg;
+        } queued_work[MAX_QUEUED_WORK];
+        size_t queued_work_count = 0;
+        bool is_running = false;
+    };
+
+    // What a request's aux points to
+    struct Exchange {
+        const FakeHttpd::Request* request;
+        FakeHttpd::Response* response;
+        size_t body_offset;
+    };
+
+    Server s_server;
+
+    // Without a uri_match_fn httpd compares the whole path
+    bool MatchExactly(const char* reference_uri, const char* uri_to_match, size_t match_upto)
+    {
+        return strlen(reference_uri) == match_upto && strncmp(reference_uri, uri_to_match, match_upto) == 0;
+    }
+
+    Exchange& GetExchange(httpd_req_t* r)
+    {
+        return *static_cast<Exchange*>(r->aux);
+    }
+
+    void AppendBody(FakeHttpd::Response& response, const char* data, size_t size)
+    {
+        const size_t count = std::min(size, sizeof(response.body) - response.length);
+        memcpy(response.body + response.length, data, count);
+        response.length += count;
+        response.is_truncated = response.is_truncated || count < size;
+    }
+
+    size_t GetLength(const char* buf, ssize_t buf_len)
+    {
+        if (buf == nullptr) {
+            return 0;
+        }
+        return buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : static_cast<size_t>(buf_len);
+    }
+
+    // Copies src into val, ESP_ERR_HTTPD_RESULT_TRUNC if it had to be cut short
+    esp_err_t CopyValue(const char* src, size_t length, char* val, size_t val_size)
+    {
+        if (val_size == 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        const size_t count = std::min(length, val_size - 1);
+        memcpy(val, src, count);
+        val[count] = '\0';
+        return count < length ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+    }
+}
+
+const char* FakeHttpd::Response::GetHeader(const char* name) const
+{
+    for (size_t i = 0; i < header_count; i++) {
+        if (strcasecmp(headers[i].name, name) == 0) {
+            return headers[i].value;
+        }
+    }
+    return nullptr;
+}
+
+bool FakeHttpd::Dispatch(const Request& request, Response& response)
+{
+    if (!s_server.is_running || strlen(request.uri) > HTTPD_MAX_URI_LEN) {
+        return false;
+    }
+
+    const size_t match_upto = strcspn(request.uri, "?");
+    const auto match = s_server.config.uri_match_fn != nullptr ? s_server.config.uri_match_fn : &MatchExactly;
+    for (size_t i = 0; i < s_server.handler_count; i++) {
+        const auto& handler = s_server.handlers[i];
+        if (handler.method != request.method || !match(handler.uri, request.uri, match_upto)) {
+            continue;
+        }
+
+        Exchange exchange = {&request, &response, 0};
+        httpd_req_t req = {};
+        req.handle = &s_server;
+        req.method = request.method;
+        strcpy(req.uri, request.uri);
+        req.content_len = request.body_length;
+        req.aux = &exchange;
+        req.user_ctx = handler.user_ctx;
+        response = Response();
+        response.result = handler.handler(&req);
+        return true;
+    }
+    return false;
+}
+
+void FakeHttpd::RunQueuedWork()
+{
+    for (size_t i = 0; i < s_server.queued_work_count; i++) {
+        s_server.queued_work[i].work(s_server.queued_work[i].arg);
+    }
+    s_server.queued_work_count = 0;
+}
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config)
+{
+    if (s_server.is_running) {
+        return ESP_FAIL;
+    }
+    s_server = Server();
+    s_server.config = *config;
+    s_server.is_running = true;
+    *handle = &s_server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    auto* server = static_cast<Server*>(handle);
+    if (server != &s_server || !s_server.is_running) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_server.config.global_user_ctx_free_fn != nullptr) {
+        s_server.config.global_user_ctx_free_fn(s_server.config.global_user_ctx);
+    }
+    s_server.is_running = false;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler)
+{
+    auto* server = static_cast<Server*>(handle);
+    if (server->handler_count >= std::min<size_t>(server->config.max_uri_handlers, MAX_HANDLERS)) {
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+    server->handlers[server->handler_count++] = *uri_handler;
+    return ESP_OK;
+}
+
+bool httpd_uri_match_wildcard(const char* uri_template, const char* uri_to_match, size_t match_upto)
+{
+    // A trailing '*' matches anything after it, a trailing '?' makes the character before it optional
+    const size_t template_length = strlen(uri_template);
+    if (template_length > 0 && uri_template[template_length - 1] == '*') {
+        return match_upto >= template_length - 1 && strncmp(uri_template, uri_to_match, template_length - 1) == 0;
+    }
+    if (template_length > 1 && uri_template[template_length - 1] == '?') {
+        const size_t required = template_length - 2;
+        return (match_upto == required || match_upto == required + 1) &&
+               strncmp(uri_template, uri_to_match, match_upto) == 0;
+    }
+    return match_upto == template_length && strncmp(uri_template, uri_to_match, match_upto) == 0;
+}
+
+void* httpd_get_global_user_ctx(httpd_handle_t handle)
+{
+    return static_cast<Server*>(handle)->config.global_user_ctx;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void* arg)
+{
+    auto* server = static_cast<Server*>(handle);
+    if (server->queued_work_count == MAX_QUEUED_WORK) {
+        return ESP_FAIL;
+    }
+    server->queued_work[server->queued_work_count++] = {work, arg};
+    return ESP_OK;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+    auto* server = static_cast<Server*>(handle);
+    if (server->config.close_fn != nullptr) {
+        server->config.close_fn(handle, sockfd);
+    }
+    return ESP_OK;
+}
+
+int httpd_req_to_sockfd(httpd_req_t* r)
+{
+    return GetExchange(r).request->sockfd;
+}
+
+int httpd_req_recv(httpd_req_t* r, char* buf, size_t buf_len)
+{
+    auto& exchange = GetExchange(r);
+    const size_t remaining = exchange.request->body_length - exchange.body_offset;
+    const size_t count = std::min({remaining, buf_len, exchange.request->receive_size});
+    memcpy(buf, exchange.request->body + exchange.body_offset, count);
+    exchange.body_offset += count;
+    return static_cast<int>(count);
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* r, const char* field, char* val, size_t val_size)
+{
+    const char* value = strcasecmp(field, "If-None-Match") == 0 ? GetExchange(r).request->if_none_match : nullptr;
+    if (value == nullptr) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return CopyValue(value, strlen(value), val, val_size);
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t* r)
+{
+    const char* query = strchr(r->uri, '?');
+    return query == nullptr ? 0 : strlen(query + 1);
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* r, char* buf, size_t buf_len)
+{
+    const char* query = strchr(r->uri, '?');
+    if (query == nullptr) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return CopyValue(query + 1, strlen(query + 1), buf, buf_len);
+}
+
+esp_err_t httpd_query_key_value(const char* qry, const char* key, char* val, size_t val_size)
+{
+    const size_t key_length = strlen(key);
+    const char* pair = qry;
+    while (pair != nullptr && *pair != '\0') {
+        const char* end = strchr(pair, '&');
+        const size_t pair_length = end == nullptr ? strlen(pair) : static_cast<size_t>(end - pair);
+        if (pair_length > key_length && strncmp(pair, key, key_length) == 0 && pair[key_length] == '=') {
+            return CopyValue(pair + key_length + 1, pair_length - key_length - 1, val, val_size);
+        }
+        pair = end == nullptr ? nullptr : end + 1;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t* r, const char* status)
+{
+    GetExchange(r).response->status = atoi(status);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t* r, const char* type)
+{
+    GetExchange(r).response->content_type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t* r, const char* field, const char* value)
+{
+    auto& response = *GetExchange(r).response;
+    if (response.header_count == FakeHttpd::Response::MAX_HEADER_COUNT) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    auto& header = response.headers[response.header_count++];
+    header.name = field;
+    return CopyValue(value, strlen(value), header.value, sizeof(header.value));
+}
+
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t buf_len)
+{
+    auto& response = *GetExchange(r).response;
+    if (response.status == 0) {
+        response.status = 200;
+    }
+    AppendBody(response, buf, GetLength(buf, buf_len));
+    response.is_complete = true;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t* r, const char* buf, ssize_t buf_len)
+{
+    auto& response = *GetExchange(r).response;
+    if (response.status == 0) {
+        response.status = 200;
+    }
+    const size_t length = GetLength(buf, buf_len);
+    AppendBody(response, buf, length);
+    ++response.chunk_count;
+    response.is_complete = length == 0;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t* req, httpd_err_code_t error, const char* msg)
+{
+    static const int STATUS_CODES[] = {400, 404, 408, 500};
+    GetExchange(req).response->status = STATUS_CODES[error];
+    httpd_resp_send(req, msg, HTTPD_RESP_USE_STRLEN);
+    return ESP_FAIL;
+}
+
+esp_err_t httpd_resp_send_404(httpd_req_t* r)
+{
+    return httpd_resp_send_err(r, HTTPD_404_NOT_FOUND, "Not Found");
+}
+
+esp_err_t httpd_ws_send_frame(httpd_req_t* /*req*/, httpd_ws_frame_t* /*pkt*/)
+{
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t* /*req*/, httpd_ws_frame_t* pkt, size_t /*max_len*/)
+{
+    pkt->len = 0;
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t /*hd*/, int /*fd*/, httpd_ws_frame_t* /*frame*/)
+{
+    return ESP_OK;
+}
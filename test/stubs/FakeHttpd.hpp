@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_http_server.h"
+
+// The server behind the esp_http_server.h stubs. There is one at a time, started with httpd_start
+// like on the device. Requests and responses live in fixed buffers, so a dispatch allocates only
+// what the handler does.
+namespace FakeHttpd {
+    struct Request {
+        httpd_method_t method = HTTP_GET;
+        const char* uri = "/"; // Query included
+        const char* body = "";
+        size_t body_length = 0;
+        size_t receive_size = 8; // Most httpd_req_recv hands out at once, bodies come in pieces
+        const char* if_none_match = nullptr;
+        int sockfd = 60;
+    };
+
+    struct Response {
+        static constexpr size_t MAX_BODY_SIZE = 8192;
+        static constexpr size_t MAX_HEADER_COUNT = 8;
+        static constexpr size_t MAX_HEADER_SIZE = 64;
+
+        struct Header {
+            const char* name;
+            char value[MAX_HEADER_SIZE];
+        };
+
+        esp_err_t result = ESP_OK; // What the handler returned
+        int status = 0; // 0 until something was sent
+        const char* content_type = "text/html";
+        Header headers[MAX_HEADER_COUNT];
+        size_t header_count = 0;
+        char body[MAX_BODY_SIZE];
+        size_t length = 0;
+        size_t chunk_count = 0; // 0 unless sent with httpd_resp_send_chunk
+        bool is_complete = false; // Sent in one go, or the closing empty chunk came
+        bool is_truncated = false;
+
+        // nullptr if the handler didn't set it
+        [[nodiscard]] const char* GetHeader(const char* name) const;
+    };
+
+    // Hands request to the first registered route whose method matches and whose uri matches with
+    // the server's uri_match_fn, the query left out, as httpd does. False if the server isn't
+    // running or no route matches.
+    bool Dispatch(const Request& request, Response& response);
+
+    // Runs the work httpd_queue_work queued, as the httpd task would between requests
+    void RunQueuedWork();
+}
@@ -0,0 +1,265 @@
+#include "FakeIdf.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "driver/uart.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "nvs_flash.h"
+#include "nvs_handle.hpp"
+
+static std::atomic<int64_t> s_now_us(0);
+static std::function<void(int64_t)> s_on_delay;
+static std::vector<rmt_config_t> s_rmt_configs;
+static std::vector<FakeIdf::RmtWrite> s_rmt_writes;
+static bool s_is_uart_available = false;
+static uint32_t s_uart_baud_rates[UART_NUM_MAX];
+static std::vector<FakeIdf::UartWrite> s_uart_writes;
+static int s_ring_buffer;
+static int s_timer;
+
+void FakeIdf::SetTimeUs(int64_t now_us)
+{
+    s_now_us = now_us;
+}
+
+void FakeIdf::AdvanceTimeUs(int64_t us)
+{
+    s_now_us += us;
+    if (s_on_delay) {
+        s_on_delay(us);
+    }
+}
+
+void FakeIdf::SetDelayHook(std::function<void(int64_t us)> on_delay)
+{
+    s_on_delay = std::move(on_delay);
+}
+
+const std::vector<rmt_config_t>& FakeIdf::GetRmtConfigs()
+{
+    return s_rmt_configs;
+}
+
+const std::vector<FakeIdf::RmtWrite>& FakeIdf::GetRmtWrites()
+{
+    return s_rmt_writes;
+}
+
+void FakeIdf::ClearRmt()
+{
+    s_rmt_configs.clear();
+    s_rmt_writes.clear();
+}
+
+void FakeIdf::SetUartAvailable(bool is_available)
+{
+    s_is_uart_available = is_available;
+}
+
+const std::vector<FakeIdf::UartWrite>& FakeIdf::GetUartWrites()
+{
+    return s_uart_writes;
+}
+
+void FakeIdf::ClearUart()
+{
+    s_uart_writes.clear();
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return s_now_us;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    FakeIdf::AdvanceTimeUs(static_cast<int64_t>(ticks) * portTICK_PERIOD_MS * 1000);
+}
+
+void ets_delay_us(uint32_t us)
+{
+    FakeIdf::AdvanceTimeUs(us);
+}
+
+// Timers never fire, tests call what they would have run themselves
+esp_err_t esp_timer_create(const esp_timer_create_args_t*, esp_timer_handle_t* out_handle)
+{
+    *out_handle = reinterpret_cast<esp_timer_handle_t>(&s_timer);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t, uint64_t)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t, gpio_mode_t)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t, uint32_t)
+{
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t)
+{
+    return 1;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t, gpio_pull_mode_t)
+{
+    return ESP_OK;
+}
+
+esp_err_t rmt_config(const rmt_config_t* config)
+{
+    s_rmt_configs.push_back(*config);
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t, size_t, int)
+{
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t)
+{
+    return ESP_OK;
+}
+
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t, RingbufHandle_t* buf_handle)
+{
+    *buf_handle = &s_ring_buffer;
+    return ESP_OK;
+}
+
+esp_err_t rmt_set_rx_idle_thresh(rmt_channel_t, uint16_t)
+{
+    return ESP_OK;
+}
+
+esp_err_t rmt_rx_start(rmt_channel_t, bool)
+{
+    return ESP_OK;
+}
+
+esp_err_t rmt_rx_stop(rmt_channel_t)
+{
+    return ESP_OK;
+}
+
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t* items, int item_num, bool)
+{
+    s_rmt_writes.push_back({channel, std::vector<rmt_item32_t>(items, items + item_num)});
+    return ESP_OK;
+}
+
+void* xRingbufferReceive(RingbufHandle_t, size_t* size, TickType_t)
+{
+    *size = 0;
+    return nullptr;
+}
+
+void vRingbufferReturnItem(RingbufHandle_t, void*)
+{
+}
+
+// Without SetUartAvailable there is no UART on the host, OneWireBus falls back to bit-banging
+esp_err_t uart_driver_install(uart_port_t, int, int, int, QueueHandle_t*, int)
+{
+    return s_is_uart_available ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t uart_driver_delete(uart_port_t)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t* uart_config)
+{
+    if (!s_is_uart_available) {
+        return ESP_FAIL;
+    }
+    s_uart_baud_rates[uart_num] = static_cast<uint32_t>(uart_config->baud_rate);
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t, int, int, int, int)
+{
+    return s_is_uart_available ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t uart_set_baudrate(uart_port_t uart_num, uint32_t baudrate)
+{
+    if (!s_is_uart_available) {
+        return ESP_FAIL;
+    }
+    s_uart_baud_rates[uart_num] = baudrate;
+    return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t)
+{
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void* src, size_t size)
+{
+    if (!s_is_uart_available) {
+        return -1;
+    }
+    const auto* bytes = static_cast<const uint8_t*>(src);
+    s_uart_writes.push_back({uart_num, s_uart_baud_rates[uart_num], std::vector<uint8_t>(bytes, bytes + size)});
+    return static_cast<int>(size);
+}
+
+// Nothing holds the line, every frame reads back as it was sent
+int uart_read_bytes(uart_port_t uart_num, void* buf, uint32_t length, TickType_t)
+{
+    if (!s_is_uart_available || s_uart_writes.empty() || s_uart_writes.back().port != uart_num) {
+        return -1;
+    }
+    const auto& echo = s_uart_writes.back().bytes;
+    const size_t size = std::min<size_t>(length, echo.size());
+    memcpy(buf, echo.data(), size);
+    return static_cast<int>(size);
+}
+
+uint32_t esp_random(void)
+{
+    return 0x5EED1234;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_ERR_NVS_NOT_INITIALIZED;
+}
+
+std::unique_ptr<nvs::NVSHandle> nvs::open_nvs_handle(const char* /*ns_name*/, nvs_open_mode_t /*open_mode*/, esp_err_t* err)
+{
+    if (err != nullptr) {
+        *err = ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    return nullptr;
+}
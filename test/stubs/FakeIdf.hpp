@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "driver/rmt.h"
+#include "driver/uart.h"
+
+// State behind the stubbed ESP-IDF functions, for tests to drive and inspect
+namespace FakeIdf {
+    // esp_timer_get_time() reads this clock, vTaskDelay() and ets_delay_us() move it forward and
+    // then call the delay hook with how far, e.g. to advance a OneWireSimulator along with it
+    void SetTimeUs(int64_t now_us);
+    void AdvanceTimeUs(int64_t us);
+    void SetDelayHook(std::function<void(int64_t us)> on_delay);
+
+    struct RmtWrite {
+        rmt_channel_t channel;
+        std::vector<rmt_item32_t> items;
+    };
+
+    // Every rmt_config and rmt_write_items call since the last ClearRmt. Nothing is ever
+    // captured, reads through the RMT time out.
+    const std::vector<rmt_config_t>& GetRmtConfigs();
+    const std::vector<RmtWrite>& GetRmtWrites();
+    void ClearRmt();
+
+    struct UartWrite {
+        uart_port_t port;
+        uint32_t baud_rate;
+        std::vector<uint8_t> bytes;
+    };
+
+    // Off by default: the UART driver fails to install and OneWireBus falls back to bit-banging.
+    // When on, every uart_write_bytes call is captured and reads echo it back, as on an idle bus.
+    void SetUartAvailable(bool is_available);
+    const std::vector<UartWrite>& GetUartWrites();
+    void ClearUart();
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// Stands in for the one copy_html.py generates in src/, with a single small page
+
+#include "WebAsset.hpp"
+
+static const uint8_t ASSET_BODY_0[] = {'<', 'p', '>', 'Y', 'o', 'g', 'A', 'l', 'a', 'r', 'm', '<', '/', 'p', '>'};
+
+static const WebAsset WEB_ASSETS[] = {
+    {"/index.html", "text/html", "\"0123456789abcdef\"", false, ASSET_BODY_0, sizeof(ASSET_BODY_0)},
+    {"/", "text/html", "\"0123456789abcdef\"", false, ASSET_BODY_0, sizeof(ASSET_BODY_0)},
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "driver/gpio.h"
+#include "freertos/ringbuf.h"
+
+typedef enum {
+    RMT_CHANNEL_0,
+    RMT_CHANNEL_MAX = 8
+} rmt_channel_t;
+
+typedef enum {
+    RMT_MODE_TX,
+    RMT_MODE_RX
+} rmt_mode_t;
+
+typedef enum {
+    RMT_IDLE_LEVEL_LOW,
+    RMT_IDLE_LEVEL_HIGH
+} rmt_idle_level_t;
+
+typedef struct {
+    union {
+        struct {
+            uint32_t duration0 : 15;
+            uint32_t level0 : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1 : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+typedef struct {
+    bool loop_en;
+    bool carrier_en;
+    rmt_idle_level_t idle_level;
+    bool idle_output_en;
+} rmt_tx_config_t;
+
+typedef struct {
+    bool filter_en;
+    uint8_t filter_ticks_thresh;
+    uint16_t idle_threshold;
+} rmt_rx_config_t;
+
+typedef struct {
+    rmt_mode_t rmt_mode;
+    rmt_channel_t channel;
+    gpio_num_t gpio_num;
+    uint8_t clk_div;
+    uint8_t mem_block_num;
+    union {
+        rmt_tx_config_t tx_config;
+        rmt_rx_config_t rx_config;
+    };
+} rmt_config_t;
+
+esp_err_t rmt_config(const rmt_config_t* config);
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags);
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel);
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t channel, RingbufHandle_t* buf_handle);
+esp_err_t rmt_set_rx_idle_thresh(rmt_channel_t channel, uint16_t thresh);
+esp_err_t rmt_rx_start(rmt_channel_t channel, bool rx_idx_rst);
+esp_err_t rmt_rx_stop(rmt_channel_t channel);
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t* items, int item_num, bool wait_tx_done);
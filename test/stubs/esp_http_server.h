@@ -0,0 +1,123 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF HTTP server, implemented in FakeHttpd.cpp. There is no socket:
+// tests hand requests to the registered handlers and read back the response (see FakeHttpd.hpp).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "freertos/FreeRTOS.h"
+
+#define ESP_ERR_HTTPD_BASE 0xb000
+#define ESP_ERR_HTTPD_HANDLERS_FULL (ESP_ERR_HTTPD_BASE + 1)
+#define ESP_ERR_HTTPD_INVALID_REQ (ESP_ERR_HTTPD_BASE + 3)
+#define ESP_ERR_HTTPD_RESULT_TRUNC (ESP_ERR_HTTPD_BASE + 4)
+#define ESP_ERR_HTTPD_RESP_HDR (ESP_ERR_HTTPD_BASE + 5)
+
+#define HTTPD_SOCK_ERR_FAIL -1
+#define HTTPD_SOCK_ERR_INVALID -2
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+
+#define HTTPD_MAX_URI_LEN 512
+#define HTTPD_RESP_USE_STRLEN -1
+
+typedef void* httpd_handle_t;
+
+// The values http_parser uses
+typedef enum {
+    HTTP_DELETE = 0,
+    HTTP_GET = 1,
+    HTTP_HEAD = 2,
+    HTTP_POST = 3,
+    HTTP_PUT = 4
+} httpd_method_t;
+
+typedef enum {
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_404_NOT_FOUND,
+    HTTPD_408_REQ_TIMEOUT,
+    HTTPD_500_INTERNAL_SERVER_ERROR
+} httpd_err_code_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int method;
+    char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    void* aux;
+    void* user_ctx;
+} httpd_req_t;
+
+typedef esp_err_t (*httpd_uri_handler_t)(httpd_req_t* r);
+
+typedef struct httpd_uri {
+    const char* uri;
+    httpd_method_t method;
+    httpd_uri_handler_t handler;
+    void* user_ctx;
+    bool is_websocket;
+} httpd_uri_t;
+
+typedef void (*httpd_free_ctx_fn_t)(void* ctx);
+typedef void (*httpd_close_func_t)(httpd_handle_t hd, int sockfd);
+typedef bool (*httpd_uri_match_func_t)(const char* reference_uri, const char* uri_to_match, size_t match_upto);
+typedef void (*httpd_work_fn_t)(void* arg);
+
+typedef struct httpd_config {
+    unsigned task_priority;
+    size_t stack_size;
+    uint16_t server_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    void* global_user_ctx;
+    httpd_free_ctx_fn_t global_user_ctx_free_fn;
+    httpd_close_func_t close_fn;
+    httpd_uri_match_func_t uri_match_fn;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() {5, 4096, 80, 7, 8, nullptr, nullptr, nullptr, nullptr}
+
+typedef enum {
+    HTTPD_WS_TYPE_CONTINUE = 0x0,
+    HTTPD_WS_TYPE_TEXT = 0x1,
+    HTTPD_WS_TYPE_BINARY = 0x2,
+    HTTPD_WS_TYPE_CLOSE = 0x8,
+    HTTPD_WS_TYPE_PING = 0x9,
+    HTTPD_WS_TYPE_PONG = 0xA
+} httpd_ws_type_t;
+
+typedef struct httpd_ws_frame {
+    bool final;
+    bool fragmented;
+    httpd_ws_type_t type;
+    uint8_t* payload;
+    size_t len;
+} httpd_ws_frame_t;
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri_handler);
+bool httpd_uri_match_wildcard(const char* uri_template, const char* uri_to_match, size_t match_upto);
+void* httpd_get_global_user_ctx(httpd_handle_t handle);
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void* arg);
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd);
+
+int httpd_req_to_sockfd(httpd_req_t* r);
+int httpd_req_recv(httpd_req_t* r, char* buf, size_t buf_len);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* r, const char* field, char* val, size_t val_size);
+size_t httpd_req_get_url_query_len(httpd_req_t* r);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* r, char* buf, size_t buf_len);
+esp_err_t httpd_query_key_value(const char* qry, const char* key, char* val, size_t val_size);
+
+esp_err_t httpd_resp_set_status(httpd_req_t* r, const char* status);
+esp_err_t httpd_resp_set_type(httpd_req_t* r, const char* type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t* r, const char* field, const char* value);
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t* r, const char* buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_err(httpd_req_t* req, httpd_err_code_t error, const char* msg);
+esp_err_t httpd_resp_send_404(httpd_req_t* r);
+
+esp_err_t httpd_ws_send_frame(httpd_req_t* req, httpd_ws_frame_t* pkt);
+esp_err_t httpd_ws_recv_frame(httpd_req_t* req, httpd_ws_frame_t* pkt, size_t max_len);
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t* frame);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+// A fixed value on the host, see FakeIdf.cpp
+uint32_t esp_random(void);
@@ -0,0 +1,36 @@
+#pragma once
+
+// Host stand-ins for the ESP-IDF declarations the tested sources use, implemented in FakeIdf.cpp
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERROR_CHECK(x) (void)(x)
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+#define configTICK_RATE_HZ 100 // CONFIG_FREERTOS_HZ in sdkconfig
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdTRUE 1
+#define pdFALSE 0
+
+// Tests run on threads, a critical section only has to keep the compiler happy
+typedef struct {
+    int owner;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+#define IRAM_ATTR
+
+typedef void* QueueHandle_t;
+
+void ets_delay_us(uint32_t us);
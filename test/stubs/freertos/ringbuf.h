@@ -0,0 +1,8 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* RingbufHandle_t;
+
+void* xRingbufferReceive(RingbufHandle_t ring_buffer, size_t* size, TickType_t ticks_to_wait);
+void vRingbufferReturnItem(RingbufHandle_t ring_buffer, void* item);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+// Advances the fake clock, see FakeIdf.hpp
+void vTaskDelay(TickType_t ticks);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "nvs.h"
+
+// NVS is never initialised on the host: handles don't open, so settings and rules only live in RAM
+namespace nvs {
+    enum class ItemType : uint8_t {
+        U8 = 0x01,
+        U64 = 0x08,
+        SZ = 0x21,
+        BLOB = 0x42,
+        ANY = 0xff
+    };
+
+    class NVSHandle {
+    public:
+        virtual ~NVSHandle() = default;
+
+        template <typename T>
+        esp_err_t set_item(const char* key, T value) { return set_typed_item(key, &value, sizeof(value)); }
+        template <typename T>
+        esp_err_t get_item(const char* key, T& value) { return get_typed_item(key, &value, sizeof(value)); }
+
+        virtual esp_err_t set_typed_item(const char* key, const void* value, size_t size) = 0;
+        virtual esp_err_t get_typed_item(const char* key, void* value, size_t size) = 0;
+        virtual esp_err_t set_blob(const char* key, const void* blob, size_t len) = 0;
+        virtual esp_err_t get_blob(const char* key, void* out_blob, size_t len) = 0;
+        virtual esp_err_t get_item_size(ItemType datatype, const char* key, size_t& size) = 0;
+        virtual esp_err_t erase_item(const char* key) = 0;
+        virtual esp_err_t commit() = 0;
+    };
+
+    // Always fails with ESP_ERR_NVS_NOT_INITIALIZED
+    std::unique_ptr<NVSHandle> open_nvs_handle(const char* ns_name, nvs_open_mode_t open_mode, esp_err_t* err = nullptr);
+}